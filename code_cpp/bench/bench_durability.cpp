@@ -0,0 +1,73 @@
+// 持久化策略基准：每次写入 fsync / 组提交 / 退出时 fsync
+// 用法: ./bin/bench_durability.exe [追加条数，默认 2000] [组提交间隔 ms，默认 20]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "../src/Record.h"
+#include "../src/StorageWriter.h"
+
+namespace {
+
+struct Result {
+    double totalMs;
+    double avgAppendUs;
+    double maxAppendUs;
+    std::size_t persisted;
+};
+
+Result run(StorageWriter::Durability durability, std::size_t count, std::chrono::milliseconds interval) {
+    const std::string dir = "tmp_bench_durability";
+    std::filesystem::remove_all(dir);
+    Result result {0.0, 0.0, 0.0, 0};
+    const auto start = std::chrono::steady_clock::now();
+    {
+        StorageWriter writer(dir);
+        writer.setDurability(durability, interval);
+        double sumUs = 0.0;
+        for (std::size_t i = 0; i < count; ++i) {
+            Record r("REC" + std::to_string(i), "2025-11-12", 12.5, Record::Type::Expense, "餐饮", "午餐");
+            const auto before = std::chrono::steady_clock::now();
+            writer.append(r);
+            const double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - before).count();
+            sumUs += us;
+            result.maxAppendUs = std::max(result.maxAppendUs, us);
+        }
+        writer.flush();
+        result.avgAppendUs = count > 0 ? sumUs / count : 0.0;
+    }
+    result.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    result.persisted = Storage(dir).loadRecords().size();
+    std::filesystem::remove_all(dir);
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 2000;
+    const std::chrono::milliseconds interval(argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 20);
+
+    struct Policy {
+        const char *name;
+        StorageWriter::Durability durability;
+    };
+    const Policy policies[] = {
+        {"every-write ", StorageWriter::Durability::EveryWrite},
+        {"group-commit", StorageWriter::Durability::GroupCommit},
+        {"on-exit     ", StorageWriter::Durability::OnExit},
+    };
+
+    std::cout << "appends: " << count << ", group interval: " << interval.count() << " ms\n";
+    bool ok = true;
+    for (const auto &policy : policies) {
+        const auto r = run(policy.durability, count, interval);
+        std::cout << policy.name << "  total " << r.totalMs << " ms, append avg " << r.avgAppendUs
+                  << " us / max " << r.maxAppendUs << " us, persisted " << r.persisted << "\n";
+        ok = ok && r.persisted == count;
+    }
+    return ok ? 0 : 1;
+}
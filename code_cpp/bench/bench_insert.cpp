@@ -0,0 +1,97 @@
+// 插入性能基准：逐条 push_back + 全量排序（旧实现）vs RecordStore 逐条插入 vs User::addRecords 批量导入，
+// 以及界面上的“补记一条、再看首页”：每次 addRecord 之后紧跟一次 recentRecords
+// 用法: ./bin/bench_insert.exe [条数，默认 1000000] [旧实现条数，默认 5000] [补记条数，默认 1000]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/Record.h"
+#include "../src/RecordStore.h"
+#include "../src/User.h"
+
+namespace {
+
+std::vector<Record> syntheticRecords(std::size_t count) {
+    static const char *categories[] = {"餐饮", "交通", "购物", "工资", "其他"};
+    std::mt19937 rng(42);
+    std::vector<Record> out;
+    out.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        // 日期随机打乱，模拟导入顺序与账本顺序不一致
+        const unsigned month = rng() % 12 + 1;
+        const unsigned day = rng() % 28 + 1;
+        std::string date = "2025-" + std::string(month < 10 ? "0" : "") + std::to_string(month) + "-" +
+                           std::string(day < 10 ? "0" : "") + std::to_string(day);
+        out.emplace_back("REC" + std::to_string(1762949262636000ULL + i), date, static_cast<double>(i % 5000) / 10.0,
+                         i % 7 == 0 ? Record::Type::Income : Record::Type::Expense, categories[i % 5], "");
+    }
+    return out;
+}
+
+template <typename F>
+double timeMs(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::size_t legacyCount = std::min<std::size_t>(count, argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 5000);
+    const std::size_t backdatedCount = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1000;
+    const auto records = syntheticRecords(count);
+
+    const double legacyMs = timeMs([&] {
+        std::vector<Record> ledger;
+        for (std::size_t i = 0; i < legacyCount; ++i) {
+            ledger.push_back(records[i]);
+            std::sort(ledger.begin(), ledger.end(), Record::less);
+        }
+    });
+
+    std::size_t ordered = 0;
+    const double storeMs = timeMs([&] {
+        RecordStore store;
+        for (const auto &record : records) {
+            store.insert(record);
+        }
+        ordered = store.order().size();
+    });
+
+    const std::string dir = "tmp_bench_insert";
+    std::filesystem::remove_all(dir);
+    std::size_t imported = 0;
+    double batchMs = 0.0;
+    double backdatedMs = 0.0;
+    std::size_t shown = 0;
+    {
+        User user("bench", "bench", dir);
+        batchMs = timeMs([&] {
+            user.addRecords(records, false);
+            imported = user.getRecords().size();
+        });
+        // 补记的都是旧日期，每一条都落在有序序列的中间
+        const auto backdated = syntheticRecords(count + backdatedCount);
+        backdatedMs = timeMs([&] {
+            for (std::size_t i = count; i < backdated.size(); ++i) {
+                user.addRecord(backdated[i], false);
+                shown += user.recentRecords(10).size();
+            }
+        });
+    }
+    std::filesystem::remove_all(dir);
+
+    std::cout << "legacy push_back + sort: " << legacyMs << " ms for " << legacyCount << " records\n";
+    std::cout << "RecordStore::insert:     " << storeMs << " ms for " << ordered << " records\n";
+    std::cout << "User::addRecords:        " << batchMs << " ms for " << imported << " records\n";
+    std::cout << "addRecord + recentRecords: " << backdatedMs << " ms for " << backdatedCount
+              << " backdated records (" << (backdatedCount ? backdatedMs * 1000.0 / backdatedCount : 0.0)
+              << " us each, " << imported << " already in the ledger)\n";
+    return ordered == count && imported == count && shown == backdatedCount * 10 ? 0 : 1;
+}
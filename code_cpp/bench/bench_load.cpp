@@ -0,0 +1,204 @@
+// 加载性能基准：旧的 getline + splitTSV + stod 路径 vs 基于 mmap 的零拷贝解析
+// 用法: ./bin/bench_load.exe [行数，默认 1000000]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#endif
+#include "../src/Record.h"
+#include "../src/RecordStore.h"
+#include "../src/Storage.h"
+
+namespace {
+
+// 重构前的 Record：六个字段各自持有一个堆字符串（金额为 double）
+class LegacyRecord {
+public:
+    enum class Type { Income, Expense };
+
+    LegacyRecord() : amount_(0.0), type_(Type::Expense) {}
+    LegacyRecord(std::string id, std::string date, double amount, Type type, std::string category, std::string note)
+        : id_(std::move(id)), date_(std::move(date)), amount_(amount), type_(type), category_(std::move(category)),
+          note_(std::move(note)) {}
+
+    static LegacyRecord fromTSV(const std::string &line);
+
+private:
+    std::string id_;
+    std::string date_;
+    double amount_;
+    Type type_;
+    std::string category_;
+    std::string note_;
+};
+
+// 以下三个函数逐字复制自重构前的 Record.cpp / Storage.cpp
+std::string ensureUtf8(const std::string &text) {
+#ifdef _WIN32
+    if (text.empty()) return text;
+
+    int testLen = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text.c_str(), -1, nullptr, 0);
+    if (testLen > 0) {
+        return text; // already valid UTF-8
+    }
+
+    int wideLen = MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, nullptr, 0);
+    if (wideLen <= 0) {
+        return text;
+    }
+    std::wstring wide(static_cast<size_t>(wideLen - 1), L'\0');
+    MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, wide.data(), wideLen);
+
+    int utf8Len = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, nullptr, 0, nullptr, nullptr);
+    if (utf8Len <= 0) {
+        return text;
+    }
+    std::string utf8(static_cast<size_t>(utf8Len - 1), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, utf8.data(), utf8Len, nullptr, nullptr);
+    return utf8;
+#else
+    return text;
+#endif
+}
+
+std::vector<std::string> splitTSV(const std::string &s) {
+    std::vector<std::string> out;
+    std::string cur;
+    for (char c : s) {
+        if (c == '\t') {
+            out.push_back(cur);
+            cur.clear();
+        } else {
+            cur.push_back(c);
+        }
+    }
+    out.push_back(cur);
+    return out;
+}
+
+LegacyRecord LegacyRecord::fromTSV(const std::string &line) {
+    auto parts = splitTSV(line);
+    if (parts.size() < 6) throw std::runtime_error("bad record line");
+    std::string id = parts[0];
+    std::string date = parts[1];
+    double amount = 0.0;
+    try {
+        amount = std::stod(parts[2]);
+    } catch (...) { amount = 0.0; }
+    Type t = (parts[3] == "I") ? Type::Income : Type::Expense;
+    std::string category = ensureUtf8(parts[4]);
+    std::string note = ensureUtf8(parts[5]);
+    return LegacyRecord(id, date, amount, t, category, note);
+}
+
+std::vector<LegacyRecord> legacyLoad(const std::string &path) {
+    std::vector<LegacyRecord> out;
+    std::ifstream ifs(path);
+    if (!ifs) {
+        return out;
+    }
+    std::string line;
+    while (std::getline(ifs, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        try {
+            out.push_back(LegacyRecord::fromTSV(line));
+        } catch (const std::exception &e) {
+            std::cerr << "Warning: failed to parse record line: " << e.what() << std::endl;
+        }
+    }
+    return out;
+}
+
+// 真实账本里的备注大多互不相同：事由 + 地点 + 单号之类的编号，只有少数是重复的短备注
+void writeSyntheticNote(std::ofstream &ofs, std::size_t i) {
+    static const char *common[] = {"", "午餐", "地铁通勤", "疯狂星期四吃kfc", "超市采购日用品"};
+    static const char *what[] = {"和同事聚餐", "打车回家", "网购", "交电费", "买咖啡", "看电影", "给妈妈买礼物",
+                                 "周末加班餐补", "修自行车", "买书", "健身房续卡", "充话费", "理发"};
+    static const char *where[] = {"在公司楼下", "在万达广场", "在淘宝", "在学校门口", "在便利店", "在火车站",
+                                  "在小区附近", "在美团", "在京东", "在菜市场", "在机场"};
+    if (i % 10 == 0) {
+        ofs << common[(i / 10) % 5];
+        return;
+    }
+    ofs << what[i % 13] << where[(i / 13) % 11] << " 订单" << (i * 7919 % 100000007);
+    if (i % 3 == 0) {
+        ofs << "，AA 给了" << (i % 9 + 2) << "个人";
+    }
+}
+
+void writeSyntheticLedger(const std::string &path, std::size_t lines) {
+    static const char *categories[] = {"餐饮", "交通", "购物", "工资", "其他"};
+    std::ofstream ofs(path, std::ios::trunc);
+    for (std::size_t i = 0; i < lines; ++i) {
+        ofs << "REC" << (1762949262636000ULL + i) << '\t'
+            << "2025-" << (i % 12 < 9 ? "0" : "") << (i % 12 + 1) << '-' << (i % 28 < 9 ? "0" : "") << (i % 28 + 1) << '\t'
+            << (i % 5000) << '.' << (i % 100) << '\t'
+            << (i % 7 == 0 ? 'I' : 'E') << '\t'
+            << categories[i % 5] << '\t';
+        writeSyntheticNote(ofs, i);
+        ofs << '\n';
+    }
+}
+
+template <typename F>
+double timeMs(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 三条路径轮流各跑 kRuns 次、各取最快一次，机器负载的起伏对它们一视同仁
+constexpr int kRuns = 5;
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    const std::string dir = "tmp_bench_load";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    const std::string path = (std::filesystem::path(dir) / "records.txt").string();
+    writeSyntheticLedger(path, lines);
+
+    Storage storage(dir);
+    std::size_t legacyCount = 0;
+    std::size_t vectorCount = 0;
+    std::size_t newCount = 0;
+    // 先各跑一次预热页缓存
+    legacyLoad(path);
+    double legacyMs = 0.0;
+    double vectorMs = 0.0;
+    double newMs = 0.0;
+    for (int run = 0; run < kRuns; ++run) {
+        const double legacy = timeMs([&] { legacyCount = legacyLoad(path).size(); });
+        const double vector = timeMs([&] { vectorCount = storage.loadRecords().size(); });
+        // User 实际走的路径：直接解析进 RecordStore 的列，备注只拷进它的字符串堆
+        const double store = timeMs([&] {
+            RecordStore loaded;
+            storage.loadRecords(loaded);
+            newCount = loaded.size();
+        });
+        legacyMs = run == 0 ? legacy : std::min(legacyMs, legacy);
+        vectorMs = run == 0 ? vector : std::min(vectorMs, vector);
+        newMs = run == 0 ? store : std::min(newMs, store);
+    }
+
+    std::cout << "lines: " << lines << " (best of " << kRuns << " runs)\n";
+    std::cout << "legacy getline/splitTSV/stod: " << legacyMs << " ms (" << legacyCount << " records)\n";
+    std::cout << "mmap parser -> vector<Record>: " << vectorMs << " ms (" << vectorCount << " records)\n";
+    std::cout << "mmap parser -> RecordStore:   " << newMs << " ms (" << newCount << " records)\n";
+    std::cout << "speedup: " << (newMs > 0.0 ? legacyMs / newMs : 0.0) << "x\n";
+
+    std::filesystem::remove_all(dir);
+    return legacyCount == newCount && vectorCount == newCount ? 0 : 1;
+}
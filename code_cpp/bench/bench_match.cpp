@@ -0,0 +1,126 @@
+// 无索引关键字扫描基准：逐条 find vs SubstringMatcher（标量 / SSE2 / AVX2）vs 连续的备注堆 StringHeap
+// 用法: ./bin/bench_match.exe [条数，默认 1000000]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../src/Record.h"
+#include "../src/RecordStore.h"
+#include "../src/Search.h"
+#include "../src/StringArena.h"
+#include "../src/StringPool.h"
+#include "../src/SubstringMatcher.h"
+
+namespace {
+
+// 备注大多互不相同（带商户和单号），接近真实账本
+std::vector<Record> syntheticRecords(std::size_t count) {
+    static const char *categories[] = {"餐饮", "交通", "购物", "工资", "其他"};
+    static const char *words[] = {"午餐", "晚餐", "地铁", "打车", "咖啡", "超市", "水果", "电影", "房租",
+                                  "外卖", "奶茶", "加油", "停车", "快递", "聚餐", "生日", "Taxi", "Coffee"};
+    constexpr std::size_t wordCount = sizeof(words) / sizeof(words[0]);
+    std::mt19937 rng(7);
+    std::vector<Record> out;
+    out.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string note = words[rng() % wordCount];
+        note += words[rng() % wordCount];
+        note += " #" + std::to_string(rng() % 100000000);
+        if (i % 1000 == 0) {
+            note += " 订单" + std::to_string(i);
+        }
+        out.emplace_back("REC" + std::to_string(1762949262636000ULL + i), "2025-06-15", 12.5,
+                         Record::Type::Expense, categories[i % 5], note);
+    }
+    return out;
+}
+
+template <typename F>
+double timeMs(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const char *isaName(SubstringMatcher::Isa isa) {
+    switch (isa) {
+        case SubstringMatcher::Isa::Avx2:
+            return "avx2";
+        case SubstringMatcher::Isa::Sse2:
+            return "sse2";
+        default:
+            return "scalar";
+    }
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    RecordStore store;
+    store.insert(syntheticRecords(count));
+    store.order();
+    const auto &categories = store.categories();
+    std::cout << "records: " << count << ", cpu: " << isaName(SubstringMatcher::best()) << "\n";
+
+    bool consistent = true;
+    const SubstringMatcher::Isa isas[] = {SubstringMatcher::Isa::Scalar, SubstringMatcher::Isa::Sse2,
+                                          SubstringMatcher::Isa::Avx2};
+    for (const std::string keyword : {"订单777000", "Coffee", "聚餐生日", "#4242"}) {
+        // 改造前的实现：每条记录两个独立分配的字符串各 find 一次
+        std::size_t expected = 0;
+        const double baselineMs = timeMs([&] {
+            for (const auto slot : store.order()) {
+                if (store.note(slot).find(keyword) != std::string::npos ||
+                    StringPool::categories().get(categories[slot]).find(keyword) != std::string::npos) {
+                    ++expected;
+                }
+            }
+        });
+        std::cout << "[" << keyword << "] " << expected << " matches\n";
+        std::cout << "  find per record: " << baselineMs << " ms\n";
+
+        for (const auto isa : isas) {
+            if (isa > SubstringMatcher::best()) {
+                continue;
+            }
+            const SubstringMatcher matcher(keyword, isa);
+            std::size_t perRecord = 0;
+            const double recordMs = timeMs([&] {
+                for (const auto slot : store.order()) {
+                    if (matcher.contains(store.note(slot)) ||
+                        matcher.contains(StringPool::categories().get(categories[slot]))) {
+                        ++perRecord;
+                    }
+                }
+            });
+            std::vector<std::uint8_t> hits;
+            std::size_t arena = 0;
+            const double arenaMs = timeMs([&] {
+                store.notes().match(matcher, hits);
+                std::vector<std::uint8_t> categoryHits;
+                StringArena::categories().match(matcher, categoryHits);
+                for (const auto slot : store.order()) {
+                    if (hits[slot] != 0 || categoryHits[categories[slot]] != 0) {
+                        ++arena;
+                    }
+                }
+            });
+            consistent = consistent && perRecord == expected && arena == expected;
+            std::cout << "  " << isaName(isa) << " per record: " << recordMs << " ms, note heap + column: " << arenaMs
+                      << " ms\n";
+        }
+
+        Search search;
+        search.setKeyword(keyword);
+        std::size_t found = 0;
+        const double searchMs = timeMs([&] { found = search.searchByKeyword(store).size(); });
+        consistent = consistent && found == expected;
+        std::cout << "  Search::searchByKeyword(store): " << searchMs << " ms\n";
+    }
+    std::cout << "note heap bytes: " << store.notes().bytes() << "\n";
+    std::cout << (consistent ? "results consistent\n" : "RESULTS DIFFER\n");
+    return consistent ? 0 : 1;
+}
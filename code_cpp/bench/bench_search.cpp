@@ -0,0 +1,177 @@
+// 搜索基准：RecordStore 列扫描 vs NgramIndex 倒排索引 / CategoryIndex 分类位图 / RollupCube 汇总 / BalanceIndex 区间 / GroupBy 单遍分组 / 金额分位数草图
+// 用法: ./bin/bench_search.exe [条数，默认 1000000]
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../src/BalanceIndex.h"
+#include "../src/CategoryIndex.h"
+#include "../src/Date.h"
+#include "../src/GroupBy.h"
+#include "../src/NgramIndex.h"
+#include "../src/Record.h"
+#include "../src/RecordStore.h"
+#include "../src/RollupCube.h"
+#include "../src/Search.h"
+#include "../src/SketchIndex.h"
+#include "../src/Statistics.h"
+
+namespace {
+
+std::vector<Record> syntheticRecords(std::size_t count) {
+    static const char *categories[] = {"餐饮", "交通", "购物", "工资", "其他"};
+    static const char *words[] = {"午餐", "晚餐", "早餐", "地铁", "打车", "咖啡", "超市", "水果", "电影",
+                                  "房租", "话费", "外卖", "奶茶", "加油", "停车", "书店", "药店", "快递",
+                                  "同事", "聚餐", "公司", "楼下", "周末", "朋友", "生日", "礼物", "Taxi"};
+    constexpr std::size_t wordCount = sizeof(words) / sizeof(words[0]);
+    std::mt19937 rng(42);
+    std::vector<Record> out;
+    out.reserve(count);
+    for (std::size_t i = 0; i < count; ++i) {
+        std::string note;
+        const unsigned length = rng() % 3 + 1;
+        for (unsigned w = 0; w < length; ++w) {
+            note += words[rng() % wordCount];
+        }
+        // 少量独特备注，模拟按订单号、人名检索
+        if (i % 1000 == 0) {
+            note += "订单" + std::to_string(i);
+        }
+        const unsigned month = rng() % 12 + 1;
+        const unsigned day = rng() % 28 + 1;
+        std::string date = "2025-" + std::string(month < 10 ? "0" : "") + std::to_string(month) + "-" +
+                           std::string(day < 10 ? "0" : "") + std::to_string(day);
+        // 少见分类，模拟选择性高的分类筛选
+        const char *category = i % 500 == 0 ? "医疗" : categories[i % 5];
+        const double amount = 0.01 * static_cast<double>(rng() % 20000 + 1);
+        out.emplace_back("REC" + std::to_string(1762949262636000ULL + i), date, amount,
+                         Record::Type::Expense, category, note);
+    }
+    return out;
+}
+
+template <typename F>
+double timeMs(F &&f) {
+    const auto start = std::chrono::steady_clock::now();
+    f();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    const std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    RecordStore store;
+    store.insert(syntheticRecords(count));
+    store.order();
+
+    NgramIndex index;
+    const double buildMs = timeMs([&] { index.sync(store); });
+    std::cout << "index build: " << buildMs << " ms for " << count << " records, " << index.gramCount()
+              << " grams\n";
+
+    bool consistent = true;
+    const std::string keywords[] = {"订单777000", "聚餐生日", "打车回", "Taxi", "咖啡"};
+    for (const auto &keyword : keywords) {
+        Search search;
+        search.setKeyword(keyword);
+        std::size_t scanned = 0;
+        std::size_t indexed = 0;
+        const double scanMs = timeMs([&] { scanned = search.searchByKeyword(store).size(); });
+        const double indexMs = timeMs([&] { indexed = search.searchByKeyword(store, index).size(); });
+        consistent = consistent && scanned == indexed;
+        std::cout << keyword << ": " << indexed << " matches, scan " << scanMs << " ms, index " << indexMs
+                  << " ms\n";
+    }
+
+    CategoryIndex categories;
+    const double bitmapMs = timeMs([&] { categories.sync(store); });
+    std::cout << "category index build: " << bitmapMs << " ms\n";
+    for (const std::string category : {"医疗", "交通"}) {
+        Search search;
+        search.setCategory(category);
+        std::size_t scanned = 0;
+        std::size_t indexed = 0;
+        const double scanMs = timeMs([&] { scanned = search.searchByCategory(store).size(); });
+        const double indexMs = timeMs([&] { indexed = search.searchByCategory(store, categories).size(); });
+        consistent = consistent && scanned == indexed;
+        std::cout << "category " << category << ": " << indexed << " matches, scan " << scanMs << " ms, bitmap "
+                  << indexMs << " ms\n";
+    }
+    RollupCube cube;
+    const double cubeMs = timeMs([&] {
+        for (const auto slot : store.order()) {
+            cube.add(store.get(slot));
+        }
+    });
+    std::cout << "rollup build: " << cubeMs << " ms, " << cube.cellCount() << " cells\n";
+    for (const std::string period : {"2025-03", "2025", "2025-03-15", ""}) {
+        Statistics stats(period, Statistics::Mode::Category);
+        std::size_t scanned = 0;
+        std::size_t indexed = 0;
+        std::size_t rolled = 0;
+        const double scanMs = timeMs([&] { scanned = stats.generateByCategory(store).size(); });
+        const double indexMs = timeMs([&] { indexed = stats.generateByCategory(store, categories).size(); });
+        const double rollupMs = timeMs([&] { rolled = stats.generateByCategory(cube).size(); });
+        consistent = consistent && scanned == indexed && scanned == rolled &&
+                     stats.generateByTime(cube).count == stats.generateByTime(store).count;
+        std::cout << "breakdown \"" << period << "\": scan " << scanMs << " ms, bitmap " << indexMs << " ms, rollup "
+                  << rollupMs << " ms\n";
+    }
+    BalanceIndex balances;
+    const double balanceMs = timeMs([&] { balances.add(store.toRecords()); });
+    std::cout << "balance index build: " << balanceMs << " ms, " << balances.span() << " days\n";
+    for (const auto &range : std::vector<std::pair<std::string, std::string>> {{"2025-02-10", "2025-11-20"},
+                                                                                 {"2025-06-01", "2025-06-07"}}) {
+        Search search;
+        search.setTimeRange(range.first, range.second);
+        std::size_t scanned = 0;
+        std::int64_t indexed = 0;
+        std::int32_t from = 0;
+        std::int32_t to = 0;
+        Date::parsePacked(range.first, from);
+        Date::parsePacked(range.second, to);
+        const double scanMs = timeMs([&] { scanned = search.searchByTime(store).size(); });
+        const double indexMs = timeMs([&] { indexed = balances.between(from, to).count; });
+        consistent = consistent && static_cast<std::int64_t>(scanned) == indexed;
+        std::cout << "range " << range.first << ".." << range.second << ": " << indexed << " records, scan "
+                  << scanMs << " ms, fenwick " << indexMs << " ms\n";
+    }
+    // 十二份月度报表（收支汇总 + 分类占比）：逐月两遍 vs 一次分组
+    std::size_t monthly = 0;
+    const double monthlyMs = timeMs([&] {
+        for (int month = 1; month <= 12; ++month) {
+            const Statistics stats(std::string("2025-") + (month < 10 ? "0" : "") + std::to_string(month));
+            monthly += stats.generateByTime(store).count;
+            stats.generateByCategory(store);
+        }
+    });
+    const GroupBy groups({GroupBy::Dimension::Month, GroupBy::Dimension::Category, GroupBy::Dimension::Type});
+    GroupBy::Table table;
+    const double groupMs = timeMs([&] { table = Statistics("2025").groupBy(store, groups); });
+    std::size_t grouped = 0;
+    for (const auto &row : groups.rows(table)) {
+        grouped += row.cell.count;
+    }
+    consistent = consistent && monthly == grouped;
+    std::cout << "12 monthly reports: per-month " << monthlyMs << " ms, group-by " << groupMs << " ms ("
+              << table.size() << " cells)\n";
+    SketchIndex sketches;
+    const double sketchMs = timeMs([&] { sketches.add(store.toRecords()); });
+    std::cout << "sketch index build: " << sketchMs << " ms\n";
+    for (const std::string period : {"2025-03", "2025"}) {
+        const Statistics stats(period);
+        Statistics::Distribution exact;
+        Statistics::Distribution sketched;
+        const double exactMs = timeMs([&] { exact = stats.generateDistribution(store, "餐饮", Record::Type::Expense); });
+        const double mergedMs = timeMs([&] { sketched = stats.generateDistribution(sketches, "餐饮", Record::Type::Expense); });
+        consistent = consistent && exact.count == sketched.count;
+        std::cout << "distribution \"" << period << "\": exact " << exactMs << " ms (p50 " << exact.median << ", p99 "
+                  << exact.p99 << "), sketches " << mergedMs << " ms (p50 " << sketched.median << ", p99 "
+                  << sketched.p99 << ")\n";
+    }
+    return consistent ? 0 : 1;
+}
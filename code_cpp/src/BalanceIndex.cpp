@@ -0,0 +1,136 @@
+#include "BalanceIndex.h"
+#include <algorithm>
+#include "Date.h"
+
+namespace {
+
+constexpr std::size_t kInitialSpan = 512;
+
+void accumulate(BalanceIndex::Totals &into, const BalanceIndex::Totals &from, std::int64_t sign) {
+    into.income += sign * from.income;
+    into.expense += sign * from.expense;
+    into.count += sign * from.count;
+}
+
+std::size_t lowBit(std::size_t i) { return i & (~i + 1); }
+
+} // namespace
+
+void BalanceIndex::add(const Record &record) { apply(record, 1); }
+
+void BalanceIndex::add(const std::vector<Record> &records) {
+    // Covering the extremes first grows the tree at most twice per batch.
+    std::int32_t first = 0;
+    std::int32_t last = -1;
+    for (const auto &record : records) {
+        const std::int32_t date = record.getDateValue();
+        if (date >= 0) {
+            first = last < 0 ? date : std::min(first, date);
+            last = std::max(last, date);
+        }
+    }
+    if (last >= 0) {
+        cover(Date::packedToDayNumber(first));
+        cover(Date::packedToDayNumber(last));
+    }
+    for (const auto &record : records) {
+        apply(record, 1);
+    }
+}
+
+void BalanceIndex::remove(const Record &record) { apply(record, -1); }
+
+void BalanceIndex::clear() {
+    base_ = 0;
+    tree_.clear();
+    malformed_.clear();
+}
+
+BalanceIndex::Totals BalanceIndex::between(std::int32_t from, std::int32_t to) const {
+    if (from > to) {
+        return Totals {};
+    }
+    Totals totals = prefix(Date::packedToDayNumber(to));
+    accumulate(totals, prefix(Date::packedToDayNumber(from) - 1), -1);
+    return totals;
+}
+
+BalanceIndex::Totals BalanceIndex::asOf(std::int32_t date) const { return prefix(Date::packedToDayNumber(date)); }
+
+std::vector<BalanceIndex::Totals> BalanceIndex::curve(std::int32_t first, std::int32_t last,
+                                                      std::int32_t stepDays) const {
+    std::vector<Totals> points;
+    const std::int32_t end = Date::packedToDayNumber(last);
+    for (std::int32_t day = Date::packedToDayNumber(first); day <= end; day += std::max(stepDays, 1)) {
+        points.push_back(prefix(day));
+    }
+    return points;
+}
+
+std::size_t BalanceIndex::span() const { return tree_.empty() ? 0 : tree_.size() - 1; }
+
+void BalanceIndex::apply(const Record &record, std::int64_t sign) {
+    Totals delta;
+    (record.getType() == Record::Type::Income ? delta.income : delta.expense) = record.getCents();
+    delta.count = 1;
+    const std::int32_t date = record.getDateValue();
+    if (date < 0) {
+        auto &totals = malformed_[date];
+        accumulate(totals, delta, sign);
+        if (totals.count == 0) {
+            malformed_.erase(date);
+        }
+        return;
+    }
+    const std::int32_t day = Date::packedToDayNumber(date);
+    cover(day);
+    for (std::size_t i = static_cast<std::size_t>(day - base_) + 1; i < tree_.size(); i += lowBit(i)) {
+        accumulate(tree_[i], delta, sign);
+    }
+}
+
+void BalanceIndex::cover(std::int32_t day) {
+    const std::size_t size = span();
+    if (size != 0 && day >= base_ && static_cast<std::size_t>(day - base_) < size) {
+        return;
+    }
+    if (size == 0) {
+        base_ = day - static_cast<std::int32_t>(kInitialSpan / 2);
+        tree_.assign(kInitialSpan + 1, Totals {});
+        return;
+    }
+    // Back to per-day values (the inverse of the linear build below), then
+    // re-root with at least as much room again on the side that grew.
+    for (std::size_t i = size; i >= 1; --i) {
+        const std::size_t parent = i + lowBit(i);
+        if (parent <= size) {
+            accumulate(tree_[parent], tree_[i], -1);
+        }
+    }
+    const std::int32_t first = std::min(base_, day);
+    const std::int32_t last = std::max(base_ + static_cast<std::int32_t>(size) - 1, day);
+    const std::size_t grown = std::max(static_cast<std::size_t>(last - first) + 1, size * 2);
+    const std::int32_t base = day < base_ ? last - static_cast<std::int32_t>(grown) + 1 : first;
+    std::vector<Totals> tree(grown + 1);
+    std::copy(tree_.begin() + 1, tree_.end(), tree.begin() + 1 + (base_ - base));
+    for (std::size_t i = 1; i <= grown; ++i) {
+        const std::size_t parent = i + lowBit(i);
+        if (parent <= grown) {
+            accumulate(tree[parent], tree[i], 1);
+        }
+    }
+    base_ = base;
+    tree_ = std::move(tree);
+}
+
+BalanceIndex::Totals BalanceIndex::prefix(std::int32_t day) const {
+    Totals totals;
+    if (tree_.empty() || day < base_) {
+        return totals;
+    }
+    std::size_t i = std::min(static_cast<std::size_t>(day - base_) + 1, tree_.size() - 1);
+    for (; i > 0; i -= lowBit(i)) {
+        accumulate(totals, tree_[i], 1);
+    }
+    return totals;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Record.h"
+
+// Income and expense per calendar day in a Fenwick tree over day numbers:
+// totals for any date range and the balance as of any date cost O(log D)
+// for a ledger spanning D days, and so does every write, backdated or not.
+// Malformed dates have no place on the axis and are kept per date value,
+// for callers to compare as text.
+class BalanceIndex {
+public:
+    struct Totals {
+        std::int64_t income = 0; // cents
+        std::int64_t expense = 0;
+        std::int64_t count = 0;
+        std::int64_t balance() const { return income - expense; }
+    };
+
+    void add(const Record &record);
+    void add(const std::vector<Record> &records);
+    void remove(const Record &record); // must have been added
+    void clear();
+
+    // Well-formed records dated in [from, to] (packed YYYYMMDD, inclusive).
+    Totals between(std::int32_t from, std::int32_t to) const;
+    // Well-formed records dated on or before `date` (packed).
+    Totals asOf(std::int32_t date) const;
+    // asOf() at `first` and every `stepDays` after it up to `last`.
+    std::vector<Totals> curve(std::int32_t first, std::int32_t last, std::int32_t stepDays) const;
+
+    // visit(date, totals) for each malformed date value (< 0).
+    template <typename Visit>
+    void forEachMalformed(Visit &&visit) const {
+        for (const auto &entry : malformed_) {
+            visit(entry.first, entry.second);
+        }
+    }
+
+    std::size_t span() const; // days covered by the tree
+
+private:
+    void apply(const Record &record, std::int64_t sign);
+    // Grows the tree so that `day` has a node; O(D) when it does.
+    void cover(std::int32_t day);
+    Totals prefix(std::int32_t day) const; // day numbers <= day
+
+    std::int32_t base_ = 0;   // day number of node 1
+    std::vector<Totals> tree_; // tree_[0] unused
+    std::unordered_map<std::int32_t, Totals> malformed_;
+};
@@ -0,0 +1,338 @@
+#include "BinaryLedger.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include "Date.h"
+#include "StringPool.h"
+
+namespace {
+
+// Integers are stored in host (little-endian) byte order; columns start on
+// 8-byte boundaries so they can be read in place from the mapping.
+constexpr char kMagic[8] = {'L', 'D', 'G', 'R', 'C', 'O', 'L', '1'};
+constexpr std::uint32_t kVersion = 2;
+constexpr std::int32_t kNoDay = std::numeric_limits<std::int32_t>::min();
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t headerSize;
+    std::uint64_t recordCount;
+    std::uint64_t categoryCount;
+    std::uint64_t dateExceptionCount;
+    std::uint64_t daysOffset;
+    std::uint64_t centsOffset;
+    std::uint64_t typesOffset;
+    std::uint64_t categoriesOffset;
+    std::uint64_t idsOffset;
+    std::uint64_t notesOffset;
+    std::uint64_t categoryTableOffset;
+    std::uint64_t dateExceptionsOffset;
+    std::uint64_t heapOffset;
+    std::uint64_t heapSize;
+    // Version 2 on: ids are a u64 column; a text id is stored as kTextId
+    // plus its index in the text id table.
+    std::uint64_t textIdCount;
+    std::uint64_t textIdTableOffset;
+};
+
+// Version 1 headers end here, and their id column holds a Span per row.
+constexpr std::uint32_t kHeaderSizeV1 = offsetof(Header, textIdCount);
+
+// Position of a string inside the heap.
+struct Span {
+    std::uint32_t offset;
+    std::uint32_t length;
+};
+
+// Dates that are not valid YYYY-MM-DD keep their text in the heap.
+struct DateException {
+    std::uint64_t index;
+    Span text;
+};
+
+std::uint64_t align8(std::uint64_t v) {
+    return (v + 7) & ~std::uint64_t {7};
+}
+
+template <typename T>
+T load(const char *p) {
+    T v;
+    std::memcpy(&v, p, sizeof(T));
+    return v;
+}
+
+class HeapBuilder {
+public:
+    bool add(std::string_view s, Span &span) {
+        if (heap_.size() + s.size() > std::numeric_limits<std::uint32_t>::max()) {
+            return false;
+        }
+        span.offset = static_cast<std::uint32_t>(heap_.size());
+        span.length = static_cast<std::uint32_t>(s.size());
+        heap_ += s;
+        return true;
+    }
+    const std::string &bytes() const { return heap_; }
+
+private:
+    std::string heap_;
+};
+
+template <typename T>
+void writeColumn(std::ofstream &ofs, const std::vector<T> &column, std::uint64_t offset) {
+    ofs.seekp(static_cast<std::streamoff>(offset));
+    if (!column.empty()) {
+        ofs.write(reinterpret_cast<const char *>(column.data()),
+                  static_cast<std::streamsize>(column.size() * sizeof(T)));
+    }
+}
+
+} // namespace
+
+bool BinaryLedger::isBinary(const char *data, std::size_t size) {
+    return size >= sizeof(kMagic) && std::memcmp(data, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool BinaryLedger::write(const std::string &path, const std::vector<Record> &records) {
+    const std::size_t n = records.size();
+    std::vector<std::int32_t> days(n);
+    std::vector<std::int64_t> cents(n);
+    std::vector<std::uint8_t> types(n);
+    std::vector<std::uint32_t> categoryIds(n);
+    std::vector<std::uint64_t> ids(n);
+    std::vector<Span> notes(n);
+    std::vector<Span> categoryTable;
+    std::vector<Span> textIdTable;
+    std::vector<DateException> dateExceptions;
+    std::unordered_map<std::uint32_t, std::uint32_t> categoryIndex; // pool id -> table index
+    std::unordered_map<std::uint64_t, std::uint64_t> textIdIndex;   // id value -> table index
+    std::unordered_map<std::string_view, Span> noteSpans;           // views into `records`
+    HeapBuilder heap;
+
+    for (std::size_t i = 0; i < n; ++i) {
+        const auto &r = records[i];
+        if (r.getDateValue() >= 0) {
+            days[i] = Date::packedToDayNumber(r.getDateValue());
+        } else {
+            days[i] = kNoDay;
+            DateException ex {i, {}};
+            if (!heap.add(r.getDate(), ex.text)) {
+                return false;
+            }
+            dateExceptions.push_back(ex);
+        }
+        cents[i] = r.getCents();
+        types[i] = r.getType() == Record::Type::Income ? 'I' : 'E';
+
+        auto it = categoryIndex.find(r.getCategoryId());
+        if (it == categoryIndex.end()) {
+            Span span {};
+            if (!heap.add(r.getCategory(), span)) {
+                return false;
+            }
+            it = categoryIndex.emplace(r.getCategoryId(), static_cast<std::uint32_t>(categoryTable.size())).first;
+            categoryTable.push_back(span);
+        }
+        categoryIds[i] = it->second;
+
+        ids[i] = r.getIdValue();
+        if (ids[i] & Record::kTextId) {
+            auto text = textIdIndex.find(ids[i]);
+            if (text == textIdIndex.end()) {
+                Span span {};
+                if (!heap.add(r.getId(), span)) {
+                    return false;
+                }
+                text = textIdIndex.emplace(ids[i], textIdTable.size()).first;
+                textIdTable.push_back(span);
+            }
+            ids[i] = Record::kTextId | text->second;
+        }
+
+        const auto note = noteSpans.find(r.getNote());
+        if (note != noteSpans.end()) {
+            notes[i] = note->second;
+        } else if (!heap.add(r.getNote(), notes[i])) {
+            return false;
+        } else {
+            noteSpans.emplace(r.getNote(), notes[i]);
+        }
+    }
+
+    Header h {};
+    std::memcpy(h.magic, kMagic, sizeof(kMagic));
+    h.version = kVersion;
+    h.headerSize = sizeof(Header);
+    h.recordCount = n;
+    h.categoryCount = categoryTable.size();
+    h.dateExceptionCount = dateExceptions.size();
+    h.daysOffset = align8(sizeof(Header));
+    h.centsOffset = align8(h.daysOffset + n * sizeof(std::int32_t));
+    h.typesOffset = align8(h.centsOffset + n * sizeof(std::int64_t));
+    h.categoriesOffset = align8(h.typesOffset + n * sizeof(std::uint8_t));
+    h.idsOffset = align8(h.categoriesOffset + n * sizeof(std::uint32_t));
+    h.notesOffset = align8(h.idsOffset + n * sizeof(std::uint64_t));
+    h.categoryTableOffset = align8(h.notesOffset + n * sizeof(Span));
+    h.dateExceptionsOffset = align8(h.categoryTableOffset + categoryTable.size() * sizeof(Span));
+    h.textIdCount = textIdTable.size();
+    h.textIdTableOffset = align8(h.dateExceptionsOffset + dateExceptions.size() * sizeof(DateException));
+    h.heapOffset = align8(h.textIdTableOffset + textIdTable.size() * sizeof(Span));
+    h.heapSize = heap.bytes().size();
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        return false;
+    }
+    ofs.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    writeColumn(ofs, days, h.daysOffset);
+    writeColumn(ofs, cents, h.centsOffset);
+    writeColumn(ofs, types, h.typesOffset);
+    writeColumn(ofs, categoryIds, h.categoriesOffset);
+    writeColumn(ofs, ids, h.idsOffset);
+    writeColumn(ofs, notes, h.notesOffset);
+    writeColumn(ofs, categoryTable, h.categoryTableOffset);
+    writeColumn(ofs, dateExceptions, h.dateExceptionsOffset);
+    writeColumn(ofs, textIdTable, h.textIdTableOffset);
+    ofs.seekp(static_cast<std::streamoff>(h.heapOffset));
+    ofs.write(heap.bytes().data(), static_cast<std::streamsize>(heap.bytes().size()));
+    ofs.close();
+    return static_cast<bool>(ofs);
+}
+
+namespace {
+
+// Decodes every row and hands it to onRecord(Record&&); stops when it returns false.
+template <typename F>
+bool forEachRow(const char *data, std::size_t size, F &&onRecord) {
+    if (!BinaryLedger::isBinary(data, size) || size < kHeaderSizeV1) {
+        return false;
+    }
+    Header h {};
+    std::memcpy(&h, data, kHeaderSizeV1);
+    const bool idsAsText = h.version == 1 && h.headerSize == kHeaderSizeV1;
+    if (!idsAsText) {
+        if (h.version != kVersion || h.headerSize != sizeof(Header) || size < sizeof(Header)) {
+            return false;
+        }
+        h = load<Header>(data);
+    }
+    const std::uint64_t n = h.recordCount;
+    const auto fits = [size](std::uint64_t offset, std::uint64_t count, std::uint64_t width) {
+        return offset <= size && count <= (size - offset) / width;
+    };
+    if (!fits(h.daysOffset, n, sizeof(std::int32_t)) || !fits(h.centsOffset, n, sizeof(std::int64_t)) ||
+        !fits(h.typesOffset, n, sizeof(std::uint8_t)) || !fits(h.categoriesOffset, n, sizeof(std::uint32_t)) ||
+        !fits(h.idsOffset, n, idsAsText ? sizeof(Span) : sizeof(std::uint64_t)) ||
+        !fits(h.notesOffset, n, sizeof(Span)) || !fits(h.textIdTableOffset, h.textIdCount, sizeof(Span)) ||
+        !fits(h.categoryTableOffset, h.categoryCount, sizeof(Span)) ||
+        !fits(h.dateExceptionsOffset, h.dateExceptionCount, sizeof(DateException)) ||
+        !fits(h.heapOffset, h.heapSize, 1)) {
+        return false;
+    }
+    const char *heap = data + h.heapOffset;
+    const auto text = [heap, &h](const Span &s, std::string_view &dst) {
+        if (static_cast<std::uint64_t>(s.offset) + s.length > h.heapSize) {
+            return false;
+        }
+        dst = std::string_view(heap + s.offset, s.length);
+        return true;
+    };
+
+    // Category names are interned straight from the mapping; nothing is
+    // copied unless the pool has not seen the name before.
+    std::string_view view;
+    std::vector<std::uint32_t> categories(h.categoryCount);
+    for (std::uint64_t i = 0; i < h.categoryCount; ++i) {
+        if (!text(load<Span>(data + h.categoryTableOffset + i * sizeof(Span)), view)) {
+            return false;
+        }
+        categories[i] = StringPool::categories().intern(view);
+    }
+    // Text ids and malformed dates go through lookup, so that a scan under
+    // a StringPool::Scratch keeps them out of the pool. A text id is
+    // encoded once unless the Scratch holds it: that value lasts one visit.
+    std::unordered_map<std::uint64_t, std::string_view> dateTexts;
+    for (std::uint64_t i = 0; i < h.dateExceptionCount; ++i) {
+        const auto ex = load<DateException>(data + h.dateExceptionsOffset + i * sizeof(DateException));
+        if (!text(ex.text, view)) {
+            return false;
+        }
+        dateTexts[ex.index] = view;
+    }
+    std::vector<std::string_view> textIds(h.textIdCount);
+    for (std::uint64_t i = 0; i < h.textIdCount; ++i) {
+        if (!text(load<Span>(data + h.textIdTableOffset + i * sizeof(Span)), textIds[i])) {
+            return false;
+        }
+    }
+    std::vector<std::uint64_t> textIdValues(h.textIdCount, 0); // 0: not encoded yet
+
+    std::string_view note;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        const auto day = load<std::int32_t>(data + h.daysOffset + i * sizeof(std::int32_t));
+        const auto cents = load<std::int64_t>(data + h.centsOffset + i * sizeof(std::int64_t));
+        const auto type = load<std::uint8_t>(data + h.typesOffset + i);
+        const auto categoryId = load<std::uint32_t>(data + h.categoriesOffset + i * sizeof(std::uint32_t));
+        if (categoryId >= categories.size() || !text(load<Span>(data + h.notesOffset + i * sizeof(Span)), note)) {
+            return false;
+        }
+        std::uint64_t id = 0;
+        if (idsAsText) {
+            if (!text(load<Span>(data + h.idsOffset + i * sizeof(Span)), view)) {
+                return false;
+            }
+            id = Record::lookupId(view);
+        } else {
+            id = load<std::uint64_t>(data + h.idsOffset + i * sizeof(std::uint64_t));
+            if (id & Record::kTextId) {
+                const std::uint64_t index = id & ~Record::kTextId;
+                if (index >= textIds.size()) {
+                    return false;
+                }
+                id = textIdValues[index];
+                if (id == 0) {
+                    id = Record::lookupId(textIds[index]);
+                    if ((id & StringPool::kScratchBit) == 0) {
+                        textIdValues[index] = id;
+                    }
+                }
+            }
+        }
+        std::int32_t date = 0;
+        if (day != kNoDay) {
+            date = Date::dayNumberToPacked(day);
+        } else {
+            const auto it = dateTexts.find(i);
+            date = Record::lookupDate(it != dateTexts.end() ? it->second : std::string_view());
+        }
+        if (!onRecord(Record::fromColumns(id, date, cents,
+                                          type == 'I' ? Record::Type::Income : Record::Type::Expense,
+                                          categories[categoryId], note))) {
+            break;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+bool BinaryLedger::read(const char *data, std::size_t size, std::vector<Record> &out) {
+    if (isBinary(data, size) && size >= sizeof(Header)) {
+        // Bounded by the file size so a corrupt header cannot force a huge allocation.
+        const auto n = load<Header>(data).recordCount;
+        out.reserve(out.size() + static_cast<std::size_t>(std::min<std::uint64_t>(n, size / 16)));
+    }
+    return forEachRow(data, size, [&out](Record &&record) {
+        out.push_back(std::move(record));
+        return true;
+    });
+}
+
+bool BinaryLedger::scan(const char *data, std::size_t size, const std::function<bool(const Record &)> &visit) {
+    return forEachRow(data, size, [&visit](Record &&record) { return visit(record); });
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "Record.h"
+
+// Columnar on-disk ledger: fixed-width columns (day number, amount in cents,
+// type byte, category id, record id) plus a string heap for notes, category
+// names and the ids that are not numeric. Designed to be read straight out
+// of a memory mapping: numeric and generated ids are read from the id column
+// as they are, and equal notes share one heap string. Version 1 files, which
+// kept every id as heap text, are still read.
+class BinaryLedger {
+public:
+    static bool isBinary(const char *data, std::size_t size);
+    static bool write(const std::string &path, const std::vector<Record> &records);
+    static bool read(const char *data, std::size_t size, std::vector<Record> &out);
+    // Streams rows without keeping them; returns false if the file is corrupt.
+    static bool scan(const char *data, std::size_t size, const std::function<bool(const Record &)> &visit);
+};
@@ -0,0 +1,361 @@
+#include "Bitmap.h"
+#include <algorithm>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace {
+
+constexpr std::size_t kWords = 65536 / 64;
+
+} // namespace
+
+unsigned Bitmap::lowestBit(std::uint64_t word) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward64(&index, word);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+unsigned Bitmap::popcount(std::uint64_t word) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    return static_cast<unsigned>(__popcnt64(word));
+#else
+    return static_cast<unsigned>(__builtin_popcountll(word));
+#endif
+}
+
+std::size_t Bitmap::find(std::uint16_t key) const {
+    const auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+    if (it == keys_.end() || *it != key) {
+        return keys_.size();
+    }
+    return static_cast<std::size_t>(it - keys_.begin());
+}
+
+void Bitmap::add(std::uint32_t value) {
+    const auto key = static_cast<std::uint16_t>(value >> 16);
+    const auto low = static_cast<std::uint16_t>(value & 0xFFFFu);
+    // Values mostly arrive in ascending order, so try the last container first.
+    std::size_t c = keys_.size();
+    if (!keys_.empty() && keys_.back() == key) {
+        c = keys_.size() - 1;
+    } else {
+        const auto it = std::lower_bound(keys_.begin(), keys_.end(), key);
+        c = static_cast<std::size_t>(it - keys_.begin());
+        if (it == keys_.end() || *it != key) {
+            keys_.insert(it, key);
+            containers_.insert(containers_.begin() + static_cast<std::ptrdiff_t>(c), Container());
+        }
+    }
+    Container &container = containers_[c];
+    if (container.kind == Kind::Runs) {
+        toBits(container);
+    }
+    if (container.kind == Kind::Bits) {
+        std::uint64_t &word = container.words[low / 64];
+        const std::uint64_t bit = std::uint64_t {1} << (low % 64);
+        if ((word & bit) == 0) {
+            word |= bit;
+            ++container.cardinality;
+        }
+        normalize(container);
+        return;
+    }
+    auto &values = container.values;
+    if (values.empty() || values.back() < low) {
+        values.push_back(low);
+    } else {
+        const auto it = std::lower_bound(values.begin(), values.end(), low);
+        if (*it == low) {
+            return;
+        }
+        values.insert(it, low);
+    }
+    ++container.cardinality;
+    if (container.cardinality > kArrayMax) {
+        toBits(container);
+    }
+}
+
+void Bitmap::remove(std::uint32_t value) {
+    const std::size_t c = find(static_cast<std::uint16_t>(value >> 16));
+    if (c == keys_.size()) {
+        return;
+    }
+    Container &container = containers_[c];
+    const auto low = static_cast<std::uint16_t>(value & 0xFFFFu);
+    if (container.kind == Kind::Runs) {
+        toBits(container);
+    }
+    if (container.kind == Kind::Bits) {
+        std::uint64_t &word = container.words[low / 64];
+        const std::uint64_t bit = std::uint64_t {1} << (low % 64);
+        if (word & bit) {
+            word &= ~bit;
+            --container.cardinality;
+        }
+        normalize(container);
+    } else {
+        auto &values = container.values;
+        const auto it = std::lower_bound(values.begin(), values.end(), low);
+        if (it == values.end() || *it != low) {
+            return;
+        }
+        values.erase(it);
+        --container.cardinality;
+    }
+    if (container.cardinality == 0) {
+        keys_.erase(keys_.begin() + static_cast<std::ptrdiff_t>(c));
+        containers_.erase(containers_.begin() + static_cast<std::ptrdiff_t>(c));
+    }
+}
+
+bool Bitmap::contains(std::uint32_t value) const {
+    const std::size_t c = find(static_cast<std::uint16_t>(value >> 16));
+    return c != keys_.size() && contains(containers_[c], static_cast<std::uint16_t>(value & 0xFFFFu));
+}
+
+void Bitmap::clear() {
+    keys_.clear();
+    containers_.clear();
+}
+
+bool Bitmap::empty() const { return keys_.empty(); }
+
+std::uint64_t Bitmap::cardinality() const {
+    std::uint64_t total = 0;
+    for (const auto &container : containers_) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+std::size_t Bitmap::sizeInBytes() const {
+    std::size_t bytes = keys_.size() * sizeof(std::uint16_t);
+    for (const auto &container : containers_) {
+        bytes += sizeof(Container) + container.values.size() * sizeof(std::uint16_t) +
+                 container.words.size() * sizeof(std::uint64_t);
+    }
+    return bytes;
+}
+
+Bitmap Bitmap::operator&(const Bitmap &other) const {
+    Bitmap out;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < keys_.size() && j < other.keys_.size()) {
+        if (keys_[i] < other.keys_[j]) {
+            ++i;
+        } else if (other.keys_[j] < keys_[i]) {
+            ++j;
+        } else {
+            Container both = intersect(containers_[i], other.containers_[j]);
+            if (both.cardinality > 0) {
+                out.keys_.push_back(keys_[i]);
+                out.containers_.push_back(std::move(both));
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return out;
+}
+
+Bitmap &Bitmap::operator|=(const Bitmap &other) {
+    for (std::size_t j = 0; j < other.keys_.size(); ++j) {
+        const std::size_t c = find(other.keys_[j]);
+        if (c == keys_.size()) {
+            const auto it = std::lower_bound(keys_.begin(), keys_.end(), other.keys_[j]);
+            containers_.insert(containers_.begin() + (it - keys_.begin()), other.containers_[j]);
+            keys_.insert(it, other.keys_[j]);
+            continue;
+        }
+        Container &mine = containers_[c];
+        toBits(mine);
+        const Container theirs = bitsOf(other.containers_[j]);
+        mine.cardinality = 0;
+        for (std::size_t w = 0; w < kWords; ++w) {
+            mine.words[w] |= theirs.words[w];
+            mine.cardinality += popcount(mine.words[w]);
+        }
+        normalize(mine);
+    }
+    return *this;
+}
+
+std::uint64_t Bitmap::andCardinality(const Bitmap &other) const {
+    std::uint64_t total = 0;
+    std::size_t i = 0;
+    std::size_t j = 0;
+    while (i < keys_.size() && j < other.keys_.size()) {
+        if (keys_[i] < other.keys_[j]) {
+            ++i;
+        } else if (other.keys_[j] < keys_[i]) {
+            ++j;
+        } else {
+            total += intersectCount(containers_[i], other.containers_[j]);
+            ++i;
+            ++j;
+        }
+    }
+    return total;
+}
+
+void Bitmap::runOptimize() {
+    for (auto &container : containers_) {
+        if (container.kind == Kind::Runs) {
+            continue;
+        }
+        std::vector<std::uint16_t> runs;
+        const auto extend = [&runs](std::uint32_t v) {
+            if (!runs.empty() && runs[runs.size() - 2] + std::uint32_t {runs.back()} + 1 == v) {
+                ++runs.back();
+            } else {
+                runs.push_back(static_cast<std::uint16_t>(v));
+                runs.push_back(0);
+            }
+        };
+        if (container.kind == Kind::Array) {
+            for (const auto low : container.values) {
+                extend(low);
+            }
+        } else {
+            for (std::size_t w = 0; w < kWords; ++w) {
+                for (std::uint64_t word = container.words[w]; word != 0; word &= word - 1) {
+                    extend(static_cast<std::uint32_t>(w * 64 + lowestBit(word)));
+                }
+            }
+        }
+        // Keep whichever representation is smaller.
+        const std::size_t current = container.kind == Kind::Bits ? kWords * sizeof(std::uint64_t)
+                                                                 : container.values.size() * sizeof(std::uint16_t);
+        if (runs.size() * sizeof(std::uint16_t) < current) {
+            container.kind = Kind::Runs;
+            container.values = std::move(runs);
+            container.words.clear();
+            container.words.shrink_to_fit();
+        }
+    }
+}
+
+bool Bitmap::contains(const Container &container, std::uint16_t low) {
+    switch (container.kind) {
+        case Kind::Array:
+            return std::binary_search(container.values.begin(), container.values.end(), low);
+        case Kind::Bits:
+            return (container.words[low / 64] >> (low % 64)) & 1u;
+        case Kind::Runs: {
+            // Last run starting at or before `low`.
+            std::size_t lo = 0;
+            std::size_t hi = container.values.size() / 2;
+            while (lo < hi) {
+                const std::size_t mid = (lo + hi) / 2;
+                if (container.values[mid * 2] <= low) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo > 0 && low - container.values[(lo - 1) * 2] <= container.values[(lo - 1) * 2 + 1];
+        }
+    }
+    return false;
+}
+
+Bitmap::Container Bitmap::bitsOf(const Container &container) {
+    Container out;
+    out.kind = Kind::Bits;
+    out.cardinality = container.cardinality;
+    if (container.kind == Kind::Bits) {
+        out.words = container.words;
+        return out;
+    }
+    out.words.assign(kWords, 0);
+    if (container.kind == Kind::Array) {
+        for (const auto low : container.values) {
+            out.words[low / 64] |= std::uint64_t {1} << (low % 64);
+        }
+    } else {
+        for (std::size_t r = 0; r < container.values.size(); r += 2) {
+            const std::uint32_t start = container.values[r];
+            for (std::uint32_t v = start; v <= start + container.values[r + 1]; ++v) {
+                out.words[v / 64] |= std::uint64_t {1} << (v % 64);
+            }
+        }
+    }
+    return out;
+}
+
+void Bitmap::toBits(Container &container) {
+    if (container.kind != Kind::Bits) {
+        container = bitsOf(container);
+        container.values.clear();
+        container.values.shrink_to_fit();
+    }
+}
+
+void Bitmap::normalize(Container &container) {
+    if (container.kind != Kind::Bits || container.cardinality > kArrayMax) {
+        return;
+    }
+    std::vector<std::uint16_t> values;
+    values.reserve(container.cardinality);
+    for (std::size_t w = 0; w < kWords; ++w) {
+        for (std::uint64_t word = container.words[w]; word != 0; word &= word - 1) {
+            values.push_back(static_cast<std::uint16_t>(w * 64 + lowestBit(word)));
+        }
+    }
+    container.kind = Kind::Array;
+    container.values = std::move(values);
+    container.words.clear();
+    container.words.shrink_to_fit();
+}
+
+Bitmap::Container Bitmap::intersect(const Container &a, const Container &b) {
+    Container out;
+    if (a.kind == Kind::Array || b.kind == Kind::Array) {
+        const Container &small = a.kind == Kind::Array ? a : b;
+        const Container &large = a.kind == Kind::Array ? b : a;
+        for (const auto low : small.values) {
+            if (contains(large, low)) {
+                out.values.push_back(low);
+            }
+        }
+        out.cardinality = static_cast<std::uint32_t>(out.values.size());
+        return out;
+    }
+    out = bitsOf(a);
+    const Container other = b.kind == Kind::Bits ? Container() : bitsOf(b);
+    const auto &words = b.kind == Kind::Bits ? b.words : other.words;
+    out.cardinality = 0;
+    for (std::size_t w = 0; w < kWords; ++w) {
+        out.words[w] &= words[w];
+        out.cardinality += popcount(out.words[w]);
+    }
+    normalize(out);
+    return out;
+}
+
+std::uint32_t Bitmap::intersectCount(const Container &a, const Container &b) {
+    if (a.kind == Kind::Array || b.kind == Kind::Array) {
+        const Container &small = a.kind == Kind::Array ? a : b;
+        const Container &large = a.kind == Kind::Array ? b : a;
+        std::uint32_t count = 0;
+        for (const auto low : small.values) {
+            count += contains(large, low) ? 1u : 0u;
+        }
+        return count;
+    }
+    if (a.kind == Kind::Bits && b.kind == Kind::Bits) {
+        std::uint32_t count = 0;
+        for (std::size_t w = 0; w < kWords; ++w) {
+            count += popcount(a.words[w] & b.words[w]);
+        }
+        return count;
+    }
+    return intersect(a, b).cardinality;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Compressed set of 32-bit integers in the style of Roaring bitmaps. Values
+// are split by their high 16 bits into containers, each holding the low 16
+// bits as whichever is smallest:
+//   Array - sorted values, up to kArrayMax of them,
+//   Bits  - a 65536-bit bitset, for dense containers,
+//   Runs  - [start, length - 1] pairs, produced by runOptimize().
+// Intersections work container by container, so sparse sets skip most of
+// the dense one and dense pairs are ANDed a word at a time.
+class Bitmap {
+public:
+    static constexpr std::uint32_t kArrayMax = 4096;
+
+    void add(std::uint32_t value);
+    void remove(std::uint32_t value);
+    bool contains(std::uint32_t value) const;
+    void clear();
+    bool empty() const;
+    std::uint64_t cardinality() const;
+    std::size_t sizeInBytes() const;
+
+    Bitmap operator&(const Bitmap &other) const;
+    Bitmap &operator|=(const Bitmap &other);
+    std::uint64_t andCardinality(const Bitmap &other) const; // without building the result
+    // Turns containers that are mostly long runs into run containers.
+    void runOptimize();
+
+    // Calls visit(value) for every value in ascending order.
+    template <typename Visit>
+    void forEach(Visit &&visit) const {
+        for (std::size_t c = 0; c < containers_.size(); ++c) {
+            const std::uint32_t high = std::uint32_t {keys_[c]} << 16;
+            const Container &container = containers_[c];
+            switch (container.kind) {
+                case Kind::Array:
+                    for (const auto low : container.values) {
+                        visit(high | low);
+                    }
+                    break;
+                case Kind::Bits:
+                    for (std::size_t w = 0; w < container.words.size(); ++w) {
+                        for (std::uint64_t word = container.words[w]; word != 0; word &= word - 1) {
+                            visit(high | static_cast<std::uint32_t>(w * 64 + lowestBit(word)));
+                        }
+                    }
+                    break;
+                case Kind::Runs:
+                    for (std::size_t r = 0; r < container.values.size(); r += 2) {
+                        const std::uint32_t start = container.values[r];
+                        for (std::uint32_t v = start; v <= start + container.values[r + 1]; ++v) {
+                            visit(high | v);
+                        }
+                    }
+                    break;
+            }
+        }
+    }
+
+private:
+    enum class Kind : std::uint8_t { Array, Bits, Runs };
+    struct Container {
+        Kind kind = Kind::Array;
+        std::uint32_t cardinality = 0;
+        std::vector<std::uint16_t> values; // Array: sorted values; Runs: start, length - 1
+        std::vector<std::uint64_t> words;  // Bits: 1024 words
+    };
+
+    static unsigned lowestBit(std::uint64_t word);
+    static unsigned popcount(std::uint64_t word);
+    static bool contains(const Container &container, std::uint16_t low);
+    static void toBits(Container &container);
+    static void normalize(Container &container); // Bits -> Array when sparse enough
+    static Container bitsOf(const Container &container);
+    static Container intersect(const Container &a, const Container &b);
+    static std::uint32_t intersectCount(const Container &a, const Container &b);
+    std::size_t find(std::uint16_t key) const; // index in keys_, or keys_.size()
+
+    std::vector<std::uint16_t> keys_; // ascending
+    std::vector<Container> containers_;
+};
@@ -0,0 +1,69 @@
+#include "CategoryIndex.h"
+
+void CategoryIndex::clear() {
+    categories_.clear();
+    months_.clear();
+    malformed_.clear();
+    indexed_ = 0;
+    erased_ = 0;
+}
+
+void CategoryIndex::sync(const RecordStore &store) {
+    const auto &ids = store.ids();
+    const auto &erased = store.erased();
+    if (store.generation() != generation_ || ids.size() < indexed_ || erased.size() < erased_) {
+        clear(); // the store was cleared and refilled, or compacted
+        generation_ = store.generation();
+    }
+    const auto &categories = store.categories();
+    const auto &dates = store.dates();
+    const auto &live = store.live();
+    for (std::size_t slot = indexed_; slot < ids.size(); ++slot) {
+        if (!live[slot]) {
+            continue; // erased before it was ever indexed; the loop below skips it too
+        }
+        const auto value = static_cast<std::uint32_t>(slot);
+        categories_[categories[slot]].add(value);
+        monthOf(dates[slot]).add(value);
+    }
+    for (std::size_t i = erased_; i < erased.size(); ++i) {
+        const auto slot = erased[i];
+        if (slot >= indexed_) {
+            continue;
+        }
+        auto it = categories_.find(categories[slot]);
+        if (it != categories_.end()) {
+            it->second.remove(slot);
+            if (it->second.empty()) {
+                categories_.erase(it);
+            }
+        }
+        monthOf(dates[slot]).remove(slot);
+    }
+    indexed_ = ids.size();
+    erased_ = erased.size();
+}
+
+const Bitmap *CategoryIndex::category(std::uint32_t category) const {
+    const auto it = categories_.find(category);
+    return it == categories_.end() ? nullptr : &it->second;
+}
+
+const std::unordered_map<std::uint32_t, Bitmap> &CategoryIndex::categories() const { return categories_; }
+
+bool CategoryIndex::monthRange(std::int32_t first, std::int32_t last, Bitmap &out) const {
+    out.clear();
+    if (first <= 0 || first % 100 != 1 || last % 100 != 31 || last < first) {
+        return false;
+    }
+    for (auto it = months_.lower_bound(first / 100); it != months_.end() && it->first <= last / 100; ++it) {
+        out |= it->second;
+    }
+    return true;
+}
+
+const Bitmap &CategoryIndex::malformedDates() const { return malformed_; }
+
+Bitmap &CategoryIndex::monthOf(std::int32_t date) {
+    return date < 0 ? malformed_ : months_[date / 100];
+}
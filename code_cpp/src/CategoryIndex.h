@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <unordered_map>
+#include "Bitmap.h"
+#include "RecordStore.h"
+
+// Bitmaps of store slots per category and per month, kept in step with a
+// RecordStore: sync() adds the slots appended since the previous call and
+// removes the ones erased since. A category filter is one bitmap; a
+// category x period breakdown is an AND per category. A compaction of the
+// store renumbers every slot, so it rebuilds the bitmaps.
+class CategoryIndex {
+public:
+    void clear();
+    void sync(const RecordStore &store);
+
+    const Bitmap *category(std::uint32_t category) const; // nullptr if no live slot has it
+    const std::unordered_map<std::uint32_t, Bitmap> &categories() const;
+    // Slots dated in the whole months first..last (packed YYYYMMDD, first
+    // on a 1st and last on a 31st); false if the range is not month-aligned.
+    bool monthRange(std::int32_t first, std::int32_t last, Bitmap &out) const;
+    const Bitmap &malformedDates() const; // slots whose date is not YYYY-MM-DD
+
+private:
+    Bitmap &monthOf(std::int32_t date);
+
+    std::unordered_map<std::uint32_t, Bitmap> categories_;
+    std::map<std::int32_t, Bitmap> months_; // YYYYMM
+    Bitmap malformed_;
+    std::size_t indexed_ = 0;
+    std::size_t erased_ = 0;
+    std::uint64_t generation_ = 0; // of the store when last synced
+};
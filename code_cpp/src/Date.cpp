@@ -0,0 +1,131 @@
+#include "Date.h"
+#include <chrono>
+#include <ctime>
+
+namespace {
+
+bool readDigits(std::string_view text, std::size_t pos, std::size_t count, int &value) {
+    value = 0;
+    for (std::size_t i = pos; i < pos + count; ++i) {
+        const char c = text[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        value = value * 10 + (c - '0');
+    }
+    return true;
+}
+
+unsigned daysInMonth(int year, unsigned month) {
+    static const unsigned days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    if (month == 2 && (year % 4 == 0 && (year % 100 != 0 || year % 400 == 0))) {
+        return 29;
+    }
+    return days[month - 1];
+}
+
+bool parseCivil(std::string_view text, int &year, int &month, int &day) {
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-') {
+        return false;
+    }
+    if (!readDigits(text, 0, 4, year) || !readDigits(text, 5, 2, month) || !readDigits(text, 8, 2, day)) {
+        return false;
+    }
+    return month >= 1 && month <= 12 && day >= 1 && static_cast<unsigned>(day) <= daysInMonth(year, month);
+}
+
+std::string formatCivil(int year, unsigned month, unsigned day) {
+    char buf[10];
+    buf[0] = static_cast<char>('0' + (year / 1000) % 10);
+    buf[1] = static_cast<char>('0' + (year / 100) % 10);
+    buf[2] = static_cast<char>('0' + (year / 10) % 10);
+    buf[3] = static_cast<char>('0' + year % 10);
+    buf[4] = '-';
+    buf[5] = static_cast<char>('0' + month / 10);
+    buf[6] = static_cast<char>('0' + month % 10);
+    buf[7] = '-';
+    buf[8] = static_cast<char>('0' + day / 10);
+    buf[9] = static_cast<char>('0' + day % 10);
+    return std::string(buf, sizeof(buf));
+}
+
+} // namespace
+
+bool Date::parse(std::string_view text, std::int32_t &dayNumber) {
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    if (!parseCivil(text, year, month, day)) {
+        return false;
+    }
+    dayNumber = fromCivil(year, static_cast<unsigned>(month), static_cast<unsigned>(day));
+    return true;
+}
+
+std::string Date::format(std::int32_t dayNumber) {
+    int year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    toCivil(dayNumber, year, month, day);
+    return formatCivil(year, month, day);
+}
+
+bool Date::parsePacked(std::string_view text, std::int32_t &packed) {
+    int year = 0;
+    int month = 0;
+    int day = 0;
+    if (!parseCivil(text, year, month, day)) {
+        return false;
+    }
+    packed = year * 10000 + month * 100 + day;
+    return true;
+}
+
+std::string Date::formatPacked(std::int32_t packed) {
+    return formatCivil(packed / 10000, static_cast<unsigned>(packed / 100 % 100), static_cast<unsigned>(packed % 100));
+}
+
+std::int32_t Date::packedToDayNumber(std::int32_t packed) {
+    return fromCivil(packed / 10000, static_cast<unsigned>(packed / 100 % 100), static_cast<unsigned>(packed % 100));
+}
+
+std::int32_t Date::dayNumberToPacked(std::int32_t dayNumber) {
+    int year = 0;
+    unsigned month = 0;
+    unsigned day = 0;
+    toCivil(dayNumber, year, month, day);
+    return year * 10000 + static_cast<std::int32_t>(month * 100 + day);
+}
+
+std::int32_t Date::today() {
+    std::time_t time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    std::tm tm {};
+#ifdef _WIN32
+    localtime_s(&tm, &time);
+#else
+    localtime_r(&time, &tm);
+#endif
+    return fromCivil(tm.tm_year + 1900, static_cast<unsigned>(tm.tm_mon + 1), static_cast<unsigned>(tm.tm_mday));
+}
+
+// Howard Hinnant's days_from_civil / civil_from_days.
+std::int32_t Date::fromCivil(int year, unsigned month, unsigned day) {
+    year -= month <= 2;
+    const int era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(year - era * 400);
+    const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int32_t>(doe) - 719468;
+}
+
+void Date::toCivil(std::int32_t dayNumber, int &year, unsigned &month, unsigned &day) {
+    const std::int32_t z = dayNumber + 719468;
+    const std::int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const unsigned doe = static_cast<unsigned>(z - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    day = doy - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yoe) + era * 400 + (month <= 2);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Conversions between "YYYY-MM-DD" text, day numbers (days since 1970-01-01)
+// and packed YYYYMMDD integers. Packed dates order like the text and turn a
+// year or month into a contiguous integer range.
+class Date {
+public:
+    static bool parse(std::string_view text, std::int32_t &dayNumber);
+    static std::string format(std::int32_t dayNumber);
+    static bool parsePacked(std::string_view text, std::int32_t &packed);
+    static std::string formatPacked(std::int32_t packed);
+    static std::int32_t packedToDayNumber(std::int32_t packed);
+    static std::int32_t dayNumberToPacked(std::int32_t dayNumber);
+    static std::int32_t today(); // local time
+
+    static std::int32_t fromCivil(int year, unsigned month, unsigned day);
+    static void toCivil(std::int32_t dayNumber, int &year, unsigned &month, unsigned &day);
+};
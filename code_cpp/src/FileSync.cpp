@@ -0,0 +1,65 @@
+#include "FileSync.h"
+#include <cstdio>
+#include <filesystem>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+bool FileSync::syncFile(const std::string &path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    const bool ok = FlushFileBuffers(file) != 0;
+    CloseHandle(file);
+    return ok;
+#else
+    int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool FileSync::syncDirectory(const std::string &dir) {
+#ifdef _WIN32
+    (void)dir; // MoveFileEx with MOVEFILE_WRITE_THROUGH already covers this
+    return true;
+#else
+    int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+#endif
+}
+
+bool FileSync::replaceFile(const std::string &tmp, const std::string &target) {
+    if (!syncFile(tmp)) {
+        return false;
+    }
+#ifdef _WIN32
+    if (!MoveFileExA(tmp.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        return false;
+    }
+#else
+    if (::rename(tmp.c_str(), target.c_str()) != 0) {
+        return false;
+    }
+#endif
+    return syncDirectory(std::filesystem::path(target).parent_path().string());
+}
+
+std::string FileSync::tempPathFor(const std::string &target) {
+    return target + ".tmp";
+}
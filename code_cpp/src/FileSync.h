@@ -0,0 +1,16 @@
+#pragma once
+
+#include <string>
+
+// Durability helpers: fsync and crash-safe replacement of whole files.
+class FileSync {
+public:
+    // Flushes a file's data to stable storage.
+    static bool syncFile(const std::string &path);
+    // Makes a rename/create/unlink inside `dir` durable.
+    static bool syncDirectory(const std::string &dir);
+    // fsync(tmp), rename(tmp -> target), fsync(parent dir). Readers see either
+    // the old or the new file, never a partial one.
+    static bool replaceFile(const std::string &tmp, const std::string &target);
+    static std::string tempPathFor(const std::string &target);
+};
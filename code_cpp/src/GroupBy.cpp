@@ -0,0 +1,230 @@
+#include "GroupBy.h"
+#include <algorithm>
+#include <stdexcept>
+#include "Date.h"
+#include "StringPool.h"
+
+namespace {
+
+constexpr std::size_t kInitialSlots = 64;
+
+unsigned fieldBits(GroupBy::Dimension dimension) {
+    switch (dimension) {
+    case GroupBy::Dimension::Year:
+        return 14;
+    case GroupBy::Dimension::Month:
+    case GroupBy::Dimension::IsoWeek:
+        return 20;
+    case GroupBy::Dimension::Weekday:
+        return 3;
+    case GroupBy::Dimension::Day:
+        return 27;
+    case GroupBy::Dimension::Category:
+        return 32;
+    case GroupBy::Dimension::Type:
+        return 1;
+    }
+    return 0;
+}
+
+bool isTime(GroupBy::Dimension dimension) {
+    return dimension != GroupBy::Dimension::Category && dimension != GroupBy::Dimension::Type;
+}
+
+} // namespace
+
+void GroupBy::Table::merge(const Table &other) {
+    other.forEach([this](std::uint64_t key, const Cell &cell) {
+        Cell &target = (*this)[key];
+        target.income += cell.income;
+        target.expense += cell.expense;
+        target.count += cell.count;
+    });
+}
+
+std::size_t GroupBy::Table::size() const { return size_; }
+
+void GroupBy::Table::grow() {
+    std::vector<std::uint64_t> keys(std::max(kInitialSlots, keys_.size() * 2), kEmpty);
+    std::vector<Cell> cells(keys.size());
+    const std::size_t mask = keys.size() - 1;
+    unsigned shift = 64;
+    for (std::size_t slots = keys.size(); slots > 1; slots >>= 1) {
+        --shift;
+    }
+    for (std::size_t j = 0; j < keys_.size(); ++j) {
+        if (keys_[j] == kEmpty) {
+            continue;
+        }
+        std::size_t i = slotOf(keys_[j], shift);
+        while (keys[i] != kEmpty) {
+            i = (i + 1) & mask;
+        }
+        keys[i] = keys_[j];
+        cells[i] = cells_[j];
+    }
+    keys_ = std::move(keys);
+    cells_ = std::move(cells);
+    shift_ = shift;
+}
+
+const GroupBy::Cell &GroupBy::Pivot::at(std::size_t row, std::size_t column) const {
+    return cells[row * columns.size() + column];
+}
+
+GroupBy::GroupBy(std::vector<Dimension> dimensions) : dimensions_(std::move(dimensions)) {
+    // A key with every field set must stay below Table's empty marker (all ones).
+    unsigned shift = 0;
+    for (const auto dimension : dimensions_) {
+        for (const auto &existing : fields_) {
+            if (existing.dimension == dimension) {
+                throw std::invalid_argument("group-by dimension repeated");
+            }
+        }
+        const unsigned bits = fieldBits(dimension);
+        if (shift + bits > 63) {
+            throw std::invalid_argument("group-by key wider than 63 bits");
+        }
+        hasTime_ = hasTime_ || isTime(dimension);
+        if (dimension == Dimension::Category) {
+            categoryShift_ = shift;
+        } else if (dimension == Dimension::Type) {
+            typeShift_ = shift;
+        }
+        fields_.push_back({dimension, shift, bits});
+        shift += bits;
+    }
+}
+
+const std::vector<GroupBy::Dimension> &GroupBy::dimensions() const { return dimensions_; }
+
+bool GroupBy::hasTime() const { return hasTime_; }
+
+std::uint64_t GroupBy::timeKey(std::int32_t date) const {
+    if (date < 0) {
+        return 0;
+    }
+    const std::int32_t year = date / 10000;
+    std::int32_t dayNumber = 0;
+    std::int32_t weekday = 0;
+    bool civil = false;
+    std::uint64_t key = 0;
+    for (const auto &field : fields_) {
+        std::int64_t value = 0;
+        switch (field.dimension) {
+        case Dimension::Year:
+            value = year;
+            break;
+        case Dimension::Month:
+            value = date / 100;
+            break;
+        case Dimension::Day:
+            value = date;
+            break;
+        case Dimension::Weekday:
+        case Dimension::IsoWeek:
+            if (!civil) {
+                // 1970-01-01 was a Thursday.
+                dayNumber = Date::packedToDayNumber(date);
+                weekday = ((dayNumber + 3) % 7 + 7) % 7 + 1;
+                civil = true;
+            }
+            if (field.dimension == Dimension::Weekday) {
+                value = weekday;
+            } else {
+                // The ISO week belongs to the year of its Thursday.
+                int isoYear = 0;
+                unsigned month = 0;
+                unsigned day = 0;
+                const std::int32_t thursday = dayNumber - weekday + 4;
+                Date::toCivil(thursday, isoYear, month, day);
+                value = std::int64_t {isoYear} * 100 + (thursday - Date::fromCivil(isoYear, 1, 1)) / 7 + 1;
+            }
+            break;
+        case Dimension::Category:
+        case Dimension::Type:
+            continue;
+        }
+        key |= static_cast<std::uint64_t>(value) << field.shift;
+    }
+    return key;
+}
+
+std::vector<GroupBy::Row> GroupBy::rows(const Table &table) const {
+    std::vector<Row> rows;
+    rows.reserve(table.size());
+    table.forEach([&](std::uint64_t key, const Cell &cell) {
+        Row row;
+        for (const auto &field : fields_) {
+            row.values.push_back(value(field, key));
+        }
+        row.cell = cell;
+        rows.push_back(std::move(row));
+    });
+    std::sort(rows.begin(), rows.end(), [](const Row &a, const Row &b) { return a.values < b.values; });
+    return rows;
+}
+
+GroupBy::Pivot GroupBy::pivot(const Table &table, Dimension row, Dimension column) const {
+    const Field &rowField = field(row);
+    const Field &columnField = field(column);
+    Pivot pivot;
+    table.forEach([&](std::uint64_t key, const Cell &) {
+        pivot.rows.push_back(value(rowField, key));
+        pivot.columns.push_back(value(columnField, key));
+    });
+    for (auto *values : {&pivot.rows, &pivot.columns}) {
+        std::sort(values->begin(), values->end());
+        values->erase(std::unique(values->begin(), values->end()), values->end());
+    }
+    pivot.cells.resize(pivot.rows.size() * pivot.columns.size());
+    table.forEach([&](std::uint64_t key, const Cell &cell) {
+        const auto r = std::lower_bound(pivot.rows.begin(), pivot.rows.end(), value(rowField, key));
+        const auto c = std::lower_bound(pivot.columns.begin(), pivot.columns.end(), value(columnField, key));
+        Cell &target = pivot.cells[static_cast<std::size_t>(r - pivot.rows.begin()) * pivot.columns.size() +
+                                   static_cast<std::size_t>(c - pivot.columns.begin())];
+        target.income += cell.income;
+        target.expense += cell.expense;
+        target.count += cell.count;
+    });
+    return pivot;
+}
+
+std::string GroupBy::label(Dimension dimension, std::int64_t value) {
+    static const char *weekdays[] = {"周一", "周二", "周三", "周四", "周五", "周六", "周日"};
+    if (isTime(dimension) && value == 0) {
+        return "未知";
+    }
+    switch (dimension) {
+    case Dimension::Year:
+        return std::to_string(value);
+    case Dimension::Month:
+        return Date::formatPacked(static_cast<std::int32_t>(value * 100 + 1)).substr(0, 7);
+    case Dimension::IsoWeek: {
+        const std::string week = std::to_string(value % 100);
+        return std::to_string(value / 100) + "-W" + (week.size() < 2 ? "0" : "") + week;
+    }
+    case Dimension::Weekday:
+        return weekdays[(value - 1) % 7];
+    case Dimension::Day:
+        return Date::formatPacked(static_cast<std::int32_t>(value));
+    case Dimension::Category:
+        return StringPool::categories().get(static_cast<std::uint32_t>(value));
+    case Dimension::Type:
+        return value != 0 ? "收入" : "支出";
+    }
+    return std::to_string(value);
+}
+
+std::int64_t GroupBy::value(const Field &field, std::uint64_t key) const {
+    return static_cast<std::int64_t>((key >> field.shift) & ((std::uint64_t {1} << field.bits) - 1));
+}
+
+const GroupBy::Field &GroupBy::field(Dimension dimension) const {
+    for (const auto &candidate : fields_) {
+        if (candidate.dimension == dimension) {
+            return candidate;
+        }
+    }
+    throw std::invalid_argument("pivot on a dimension that is not grouped on");
+}
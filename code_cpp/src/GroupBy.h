@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Aggregation over any combination of dimensions in one pass. Each
+// dimension value occupies a fixed bit field of a 64-bit key, and the cells
+// live in a flat open-addressing table keyed by it, so a pass costs one
+// probe per record whatever the dimensions are. Statistics::groupBy() runs
+// the pass over a period; rows() and pivot() read the table afterwards.
+//
+// Time values of a record with a malformed date are 0 ("未知").
+class GroupBy {
+public:
+    enum class Dimension {
+        Year,     // YYYY
+        Month,    // YYYYMM
+        IsoWeek,  // ISO year * 100 + week
+        Weekday,  // 1 (Monday) .. 7
+        Day,      // packed YYYYMMDD
+        Category, // StringPool::categories() id
+        Type      // 1 for Income, 0 for Expense
+    };
+
+    struct Cell {
+        std::int64_t income = 0; // cents
+        std::int64_t expense = 0;
+        std::size_t count = 0;
+    };
+
+    // Packed key -> Cell, linear probing over a power-of-two array that is
+    // at most half full.
+    class Table {
+    public:
+        Cell &operator[](std::uint64_t key) {
+            if ((size_ + 1) * 2 > keys_.size()) {
+                grow();
+            }
+            const std::size_t mask = keys_.size() - 1;
+            std::size_t i = slotOf(key, shift_);
+            while (keys_[i] != kEmpty && keys_[i] != key) {
+                i = (i + 1) & mask;
+            }
+            if (keys_[i] == kEmpty) {
+                keys_[i] = key;
+                ++size_;
+            }
+            return cells_[i];
+        }
+        void merge(const Table &other);
+        std::size_t size() const;
+        // visit(key, cell) in table order.
+        template <typename Visit>
+        void forEach(Visit &&visit) const {
+            for (std::size_t i = 0; i < keys_.size(); ++i) {
+                if (keys_[i] != kEmpty) {
+                    visit(keys_[i], cells_[i]);
+                }
+            }
+        }
+
+    private:
+        static constexpr std::uint64_t kEmpty = ~std::uint64_t {0};
+
+        // Fibonacci hashing: the top bits of the product depend on every
+        // field of the key, and one multiply is cheaper than a mixing hash.
+        static std::size_t slotOf(std::uint64_t key, unsigned shift) {
+            return static_cast<std::size_t>((key * 0x9e3779b97f4a7c15ULL) >> shift);
+        }
+        void grow();
+
+        std::vector<std::uint64_t> keys_;
+        std::vector<Cell> cells_;
+        std::size_t size_ = 0;
+        unsigned shift_ = 64; // 64 - log2(keys_.size())
+    };
+
+    struct Row {
+        std::vector<std::int64_t> values; // one per dimension, in order
+        Cell cell;
+    };
+
+    // Rows and columns in value order; cells is row-major.
+    struct Pivot {
+        std::vector<std::int64_t> rows;
+        std::vector<std::int64_t> columns;
+        std::vector<Cell> cells;
+        const Cell &at(std::size_t row, std::size_t column) const;
+    };
+
+    // Throws std::invalid_argument if the fields need more than 64 bits,
+    // e.g. Day with IsoWeek and Month together, or a dimension is repeated.
+    explicit GroupBy(std::vector<Dimension> dimensions);
+
+    const std::vector<Dimension> &dimensions() const;
+    bool hasTime() const; // false if timeKey() is always 0
+
+    // The time fields of a record's key depend only on its date; callers
+    // reuse them across the records of one day.
+    std::uint64_t timeKey(std::int32_t date) const;
+    std::uint64_t key(std::uint64_t timeKey, std::uint32_t category, bool income) const {
+        if (categoryShift_ < 64) {
+            timeKey |= std::uint64_t {category} << categoryShift_;
+        }
+        if (typeShift_ < 64 && income) {
+            timeKey |= std::uint64_t {1} << typeShift_;
+        }
+        return timeKey;
+    }
+    static void add(Table &table, std::uint64_t key, bool income, std::int64_t cents) {
+        Cell &cell = table[key];
+        (income ? cell.income : cell.expense) += cents;
+        ++cell.count;
+    }
+
+    std::vector<Row> rows(const Table &table) const; // in value order
+    // Cells summed over the other dimensions; both must be grouped on.
+    Pivot pivot(const Table &table, Dimension row, Dimension column) const;
+
+    static std::string label(Dimension dimension, std::int64_t value);
+
+private:
+    struct Field {
+        Dimension dimension;
+        unsigned shift;
+        unsigned bits;
+    };
+
+    std::int64_t value(const Field &field, std::uint64_t key) const;
+    const Field &field(Dimension dimension) const;
+
+    std::vector<Dimension> dimensions_;
+    std::vector<Field> fields_;
+    // Shifts of the Category and Type fields; 64 when not grouped on.
+    unsigned categoryShift_ = 64;
+    unsigned typeShift_ = 64;
+    bool hasTime_ = false;
+};
@@ -0,0 +1,102 @@
+#include "IdGenerator.h"
+#include <chrono>
+#include <stdexcept>
+
+namespace {
+
+constexpr unsigned kMillisShift = IdGenerator::kNodeBits + IdGenerator::kSequenceBits;
+constexpr std::uint64_t kSequenceMask = (std::uint64_t {1} << IdGenerator::kSequenceBits) - 1;
+constexpr std::uint64_t kValueMask = IdGenerator::kTag - 1;
+constexpr char kCrockford[] = "0123456789ABCDEFGHJKMNPQRSTVWXYZ";
+
+int crockfordValue(char c) {
+    for (int i = 0; i < 32; ++i) {
+        if (kCrockford[i] == c) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+} // namespace
+
+IdGenerator::IdGenerator(std::uint32_t node)
+    : node_(std::uint64_t {node} << kSequenceBits), last_(0) {
+    if (node >> kNodeBits) {
+        throw std::out_of_range("IdGenerator node id out of range");
+    }
+}
+
+std::uint64_t IdGenerator::next() {
+    const std::uint64_t now = nowMillis();
+    std::uint64_t last = last_.load(std::memory_order_relaxed);
+    while (true) {
+        const std::uint64_t lastMillis = last >> kMillisShift;
+        std::uint64_t id = 0;
+        if (now > lastMillis) {
+            id = (now << kMillisShift) | node_;
+        } else if ((last & kSequenceMask) != kSequenceMask) {
+            id = last + 1;
+        } else {
+            id = ((lastMillis + 1) << kMillisShift) | node_;
+        }
+        if (last_.compare_exchange_weak(last, id, std::memory_order_relaxed)) {
+            return id | kTag;
+        }
+    }
+}
+
+std::uint32_t IdGenerator::getNode() const { return static_cast<std::uint32_t>(node_ >> kSequenceBits); }
+
+bool IdGenerator::isGenerated(std::uint64_t id) { return (id >> 62) == 1; }
+
+std::uint64_t IdGenerator::unixMillisOf(std::uint64_t id) { return ((id & kValueMask) >> kMillisShift) + kEpochMillis; }
+
+void IdGenerator::format(std::uint64_t id, char *out) {
+    out[0] = 'I';
+    out[1] = 'D';
+    std::uint64_t value = id & kValueMask;
+    for (std::size_t i = kTextLength; i-- > 2;) {
+        out[i] = kCrockford[value & 31u];
+        value >>= 5;
+    }
+}
+
+std::string IdGenerator::toString(std::uint64_t id) {
+    std::string text(kTextLength, '\0');
+    format(id, &text[0]);
+    return text;
+}
+
+bool IdGenerator::parse(std::string_view text, std::uint64_t &id) {
+    if (text.size() != kTextLength || text[0] != 'I' || text[1] != 'D') {
+        return false;
+    }
+    // 13 digits hold 65 bits; the first one may only carry bits 60 and 61.
+    if (crockfordValue(text[2]) > 3) {
+        return false;
+    }
+    std::uint64_t value = 0;
+    for (std::size_t i = 2; i < kTextLength; ++i) {
+        const int digit = crockfordValue(text[i]);
+        if (digit < 0) {
+            return false;
+        }
+        value = (value << 5) | static_cast<std::uint64_t>(digit);
+    }
+    id = value | kTag;
+    return true;
+}
+
+IdGenerator &IdGenerator::shared() {
+    static IdGenerator generator;
+    return generator;
+}
+
+std::uint64_t IdGenerator::nowMillis() {
+    const auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         std::chrono::system_clock::now().time_since_epoch())
+                         .count();
+    const auto millis = static_cast<std::uint64_t>(now < 0 ? 0 : now);
+    return millis > kEpochMillis ? millis - kEpochMillis : 0;
+}
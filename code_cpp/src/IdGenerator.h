@@ -0,0 +1,50 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Strictly increasing 64-bit record ids:
+//   bit  62      kTag, keeps generated ids apart from "REC<decimal>" ids
+//   bits 61..22  milliseconds since kEpochMillis (2020-01-01, good until 2054)
+//   bits 21..12  node id, for several processes writing one ledger
+//   bits 11..0   sequence within the millisecond
+// next() is a single CAS on the last issued id; it never locks or allocates.
+// When a millisecond's sequence runs out, or the clock steps back, it borrows
+// the following millisecond instead of waiting, so ids keep increasing.
+//
+// Text form: "ID" followed by 13 Crockford base32 digits of the low 62 bits.
+// The width is fixed, so text order matches numeric order.
+class IdGenerator {
+public:
+    static constexpr std::uint64_t kTag = std::uint64_t {1} << 62;
+    static constexpr unsigned kNodeBits = 10;
+    static constexpr unsigned kSequenceBits = 12;
+    static constexpr std::uint64_t kEpochMillis = 1577836800000ULL;
+    static constexpr std::size_t kTextLength = 15;
+
+    explicit IdGenerator(std::uint32_t node = 0); // node < 2^kNodeBits
+    IdGenerator(const IdGenerator &) = delete;
+    IdGenerator &operator=(const IdGenerator &) = delete;
+
+    std::uint64_t next();
+    std::uint32_t getNode() const;
+
+    static bool isGenerated(std::uint64_t id);
+    static std::uint64_t unixMillisOf(std::uint64_t id);
+    // Writes exactly kTextLength characters, without a terminator.
+    static void format(std::uint64_t id, char *out);
+    static std::string toString(std::uint64_t id);
+    // Accepts only the canonical text form produced by format().
+    static bool parse(std::string_view text, std::uint64_t &id);
+
+    static IdGenerator &shared(); // process-wide generator for node 0
+
+private:
+    static std::uint64_t nowMillis();
+
+    const std::uint64_t node_; // already shifted into place
+    std::atomic<std::uint64_t> last_;
+};
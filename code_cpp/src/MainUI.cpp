@@ -1,4 +1,5 @@
 #include "MainUI.h"
+#include <algorithm>
 #include <chrono>
 #include <ctime>
 #include <iomanip>
@@ -6,6 +7,8 @@
 #include <limits>
 #include <sstream>
 #include <utility>
+#include "Date.h"
+#include "IdGenerator.h"
 
 namespace {
 
@@ -31,16 +34,10 @@ std::string nowMonth() {
     return today;
 }
 
-std::string generateRecordId() {
-    static int counter = 0;
-    auto now = std::chrono::system_clock::now().time_since_epoch();
-    auto millis = std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
-    if (counter >= 1000) {
-        counter = 0;
-    }
-    std::ostringstream oss;
-    oss << "REC" << millis << std::setw(3) << std::setfill('0') << counter++;
-    return oss.str();
+RecordCursor::Page newestFirst() {
+    RecordCursor::Page page;
+    page.newestFirst = true;
+    return page;
 }
 
 double parseAmount(const std::string &input) {
@@ -94,7 +91,7 @@ void RecordUI::showRecordForm() {
 }
 
 void RecordUI::selectCategory() {
-    const auto categories = user_.getCategories();
+    const auto &categories = user_.getCategories();
     std::cout << "\n类别选择:\n";
     for (std::size_t i = 0; i < categories.size(); ++i) {
         const bool isActive = categories[i].getName() == selectedCategory_;
@@ -135,7 +132,7 @@ void RecordUI::selectCategory() {
 }
 
 void RecordUI::applyCategorySelection(std::size_t index) {
-    const auto categories = user_.getCategories();
+    const auto &categories = user_.getCategories();
     if (index < categories.size()) {
         selectedCategory_ = categories[index].getName();
     }
@@ -167,8 +164,7 @@ void RecordUI::inputNote() {
 }
 
 void RecordUI::saveRecord() {
-    const std::string recordId = generateRecordId();
-    const Record record(recordId, selectedDate_, amount_, selectedType_, selectedCategory_, note_);
+    const Record record(IdGenerator::shared().next(), selectedDate_, amount_, selectedType_, selectedCategory_, note_);
     user_.addRecord(record, true);
     std::cout << "记录已保存 (" << record.getRecordInfo() << ")\n";
 }
@@ -206,6 +202,80 @@ void StatisticsUI::showCategoryView() {
     displayResults(summary, items);
 }
 
+void StatisticsUI::showRangeView() {
+    std::cout << "\n=== 统计 - 区间与余额 ===\n";
+    std::cout << "起始日期 (YYYY-MM-DD): ";
+    std::string from;
+    std::getline(std::cin, from);
+    std::cout << "结束日期 (YYYY-MM-DD), 默认 " << nowDate() << ": ";
+    std::string to;
+    std::getline(std::cin, to);
+    if (to.empty()) {
+        to = nowDate();
+    }
+    displayResults(user_.rangeTotals(from, to), {});
+    // About a dozen points of the running balance across the range.
+    std::int32_t first = 0;
+    std::int32_t last = 0;
+    if (!Date::parse(from, first) || !Date::parse(to, last) || first > last) {
+        return;
+    }
+    std::cout << "\n余额走势:\n";
+    for (const auto &point : user_.balanceCurve(from, to, std::max((last - first) / 12, 1))) {
+        std::cout << "  " << point.first << "  " << std::fixed << std::setprecision(2) << point.second << "\n";
+    }
+}
+
+void StatisticsUI::showTrendView() {
+    std::cout << "\n=== 统计 - 月度趋势 ===\n";
+    const std::string thisYear = nowMonth().substr(0, 4);
+    std::cout << "输入年份 (YYYY), 默认 " << thisYear << ": ";
+    std::string year;
+    std::getline(std::cin, year);
+    if (year.empty()) {
+        year = thisYear;
+    }
+    // Every month of every category from a single pass over the year.
+    const GroupBy groups({GroupBy::Dimension::Category, GroupBy::Dimension::Month});
+    const auto pivot = groups.pivot(user_.groupStatistics(year, groups), GroupBy::Dimension::Category,
+                                    GroupBy::Dimension::Month);
+    if (pivot.rows.empty()) {
+        std::cout << "没有记录\n";
+        return;
+    }
+    std::cout << "支出 (元)\n" << std::setw(10) << "分类";
+    for (const auto month : pivot.columns) {
+        std::cout << std::setw(10) << GroupBy::label(GroupBy::Dimension::Month, month);
+    }
+    std::cout << "\n" << std::fixed << std::setprecision(2);
+    for (std::size_t r = 0; r < pivot.rows.size(); ++r) {
+        std::cout << "  " << GroupBy::label(GroupBy::Dimension::Category, pivot.rows[r]) << "\n" << std::setw(10) << "";
+        for (std::size_t c = 0; c < pivot.columns.size(); ++c) {
+            std::cout << std::setw(10) << static_cast<double>(pivot.at(r, c).expense) / 100.0;
+        }
+        std::cout << "\n";
+    }
+}
+
+void StatisticsUI::showDistributionView() {
+    std::cout << "\n=== 统计 - 支出金额分布 ===\n";
+    std::cout << "输入期间 (YYYY / YYYY-MM / YYYY-MM-DD, 留空为全部): ";
+    std::string period;
+    std::getline(std::cin, period);
+    std::cout << "输入分类 (留空为全部): ";
+    std::string category;
+    std::getline(std::cin, category);
+    const auto distribution = user_.viewDistribution(period, category, Record::Type::Expense);
+    std::cout << "期间: " << (period.empty() ? "全部" : period) << " | 分类: " << (category.empty() ? "全部" : category)
+              << " | 笔数: " << distribution.count << "\n";
+    if (distribution.count == 0) {
+        return;
+    }
+    std::cout << std::fixed << std::setprecision(2) << "平均: " << distribution.mean
+              << " | 中位数: " << distribution.median << " | P90: " << distribution.p90
+              << " | P99: " << distribution.p99 << " | 最大: " << distribution.max << "\n";
+}
+
 void StatisticsUI::toggleChartSummary() {
     showChart_ = !showChart_;
     std::cout << "图表展示已" << (showChart_ ? "开启" : "关闭") << "\n";
@@ -234,7 +304,7 @@ SearchUI::SearchUI(User &user)
 
 void SearchUI::showSearchForm() {
     std::cout << "\n=== 搜索 ===\n";
-    std::cout << "1. 关键字\n2. 类别\n3. 时间范围\n选择操作 (其他返回): ";
+    std::cout << "1. 关键字\n2. 类别\n3. 时间范围\n4. 组合条件\n选择操作 (其他返回): ";
     std::string input;
     std::getline(std::cin, input);
     if (input == "1") {
@@ -243,6 +313,8 @@ void SearchUI::showSearchForm() {
         filterByCategory();
     } else if (input == "3") {
         filterByTime();
+    } else if (input == "4") {
+        filterByQuery();
     }
 }
 
@@ -255,8 +327,7 @@ void SearchUI::filterByTime() {
     std::getline(std::cin, to);
     Search search;
     search.setTimeRange(from, to);
-    auto results = user_.searchRecords(search, User::SearchMode::Time);
-    displayResults(results);
+    displayResults(user_.searchCursor(search, User::SearchMode::Time, newestFirst()));
 }
 
 void SearchUI::filterByKeyword() {
@@ -265,13 +336,12 @@ void SearchUI::filterByKeyword() {
     std::getline(std::cin, keyword);
     Search search;
     search.setKeyword(keyword);
-    auto results = user_.searchRecords(search, User::SearchMode::Keyword);
-    displayResults(results);
+    displayResults(user_.searchCursor(search, User::SearchMode::Keyword, newestFirst()));
 }
 
 void SearchUI::filterByCategory() {
     std::cout << "选择类别:\n";
-    const auto categories = user_.getCategories();
+    const auto &categories = user_.getCategories();
     for (std::size_t i = 0; i < categories.size(); ++i) {
         std::cout << "  [" << (i + 1) << "] " << categories[i].getName() << "\n";
     }
@@ -293,18 +363,62 @@ void SearchUI::filterByCategory() {
     }
     Search search;
     search.setCategory(categories[index - 1].getName());
-    auto results = user_.searchRecords(search, User::SearchMode::Category);
-    displayResults(results);
+    displayResults(user_.searchCursor(search, User::SearchMode::Category, newestFirst()));
 }
 
-void SearchUI::displayResults(const std::vector<Record> &records) const {
-    if (records.empty()) {
-        std::cout << "没有找到匹配的记录。\n";
-        return;
+void SearchUI::filterByQuery() {
+    // Every prompt may be left empty to skip that condition.
+    const auto ask = [](const char *prompt) {
+        std::cout << prompt;
+        std::string value;
+        std::getline(std::cin, value);
+        return value;
+    };
+    Query query;
+    query.setKeyword(ask("关键字: "));
+    query.setCategory(ask("类别: "));
+    const std::string from = ask("起始日期 (YYYY-MM-DD): ");
+    query.setTimeRange(from, ask("结束日期 (YYYY-MM-DD): "));
+    const std::string minAmount = ask("最小金额: ");
+    const std::string maxAmount = ask("最大金额: ");
+    if (!minAmount.empty() || !maxAmount.empty()) {
+        query.setAmountRange(minAmount.empty() ? 0.0 : parseAmount(minAmount),
+                             maxAmount.empty() ? 1e15 : parseAmount(maxAmount));
+    }
+    const std::string type = ask("类型 [1] 收入 [2] 支出 (空为全部): ");
+    if (!type.empty()) {
+        query.setType(parseTypeInput(type));
     }
-    std::cout << "共找到 " << records.size() << " 条记录:\n";
-    for (const auto &record : records) {
-        std::cout << "  - " << record.getRecordInfo() << "\n";
+    Query::Plan plan;
+    auto results = user_.query(query, &plan);
+    std::cout << "查询计划: " << plan.explain() << "\n";
+    displayResults(RecordCursor(std::move(results), newestFirst()));
+}
+
+void SearchUI::displayResults(RecordCursor cursor) const {
+    // Newest first, one page at a time; matches past the last page shown are never looked for.
+    const std::size_t pageSize = 20;
+    RecordStore::Slot slot = 0;
+    while (true) {
+        std::size_t shown = 0;
+        while (shown < pageSize && cursor.next(slot)) {
+            std::cout << "  - " << RecordRef(cursor.store(), slot).getRecordInfo() << "\n";
+            ++shown;
+        }
+        if (cursor.returned() == 0) {
+            std::cout << "没有找到匹配的记录。\n";
+            return;
+        }
+        if (shown < pageSize || cursor.done()) {
+            std::cout << "共 " << cursor.returned() << " 条记录。\n";
+            return;
+        }
+        std::cout << "已显示 " << cursor.returned() << " 条，回车查看更多，其他键返回: ";
+        std::string input;
+        std::getline(std::cin, input);
+        if (!input.empty()) {
+            return;
+        }
     }
 }
 
@@ -324,7 +438,7 @@ void MainUI::showHomeScreen() {
     std::cout << "  净余额: ¥" << summary.balance << "\n";
 
     std::cout << "\n最近记录:\n";
-    const auto recent = user_.getRecentRecords(10);
+    const auto recent = user_.recentRecords(10);
     if (recent.empty()) {
         std::cout << "  暂无记录，快去记一笔吧！\n";
     } else {
@@ -351,7 +465,7 @@ void MainUI::navigateToRecord() {
 }
 
 void MainUI::navigateToStatistics() {
-    std::cout << "统计选项: [1] 时间视图 [2] 分类视图 [3] 切换图表显示 [其他返回]\n选择: ";
+    std::cout << "统计选项: [1] 时间视图 [2] 分类视图 [3] 切换图表显示 [4] 区间与余额 [5] 月度趋势 [6] 金额分布 [其他返回]\n选择: ";
     std::string input;
     std::getline(std::cin, input);
     if (input == "1") {
@@ -360,6 +474,12 @@ void MainUI::navigateToStatistics() {
         statisticsUI_.showCategoryView();
     } else if (input == "3") {
         statisticsUI_.toggleChartSummary();
+    } else if (input == "4") {
+        statisticsUI_.showRangeView();
+    } else if (input == "5") {
+        statisticsUI_.showTrendView();
+    } else if (input == "6") {
+        statisticsUI_.showDistributionView();
     }
     pause();
 }
@@ -373,7 +493,7 @@ void MainUI::navigateToProfile() {
     std::cout << "\n=== 我的 ===\n";
     std::cout << "用户: " << user_.getUsername() << " (" << user_.getUserId() << ")\n";
     std::cout << "分类数量: " << user_.getCategories().size() << "\n";
-    std::cout << "记录总数: " << user_.getRecords().size() << "\n";
+    std::cout << "记录总数: " << user_.recordCount() << "\n";
     pause();
 }
 
@@ -33,6 +33,9 @@ public:
 
     void showTimeView();
     void showCategoryView();
+    void showRangeView();
+    void showTrendView();
+    void showDistributionView();
     void toggleChartSummary();
     void displayResults(const Statistics::TimeSummary &summary,
                         const std::vector<Statistics::CategorySummaryItem> &items);
@@ -50,7 +53,8 @@ public:
     void filterByTime();
     void filterByKeyword();
     void filterByCategory();
-    void displayResults(const std::vector<Record> &records) const;
+    void filterByQuery();
+    void displayResults(RecordCursor cursor) const;
 
 private:
     User &user_;
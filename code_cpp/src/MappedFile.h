@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file. An empty or missing file maps to
+// an empty range; check isOpen() to tell the two apart.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string &path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+    MappedFile(MappedFile &&other) noexcept;
+    MappedFile &operator=(MappedFile &&other) noexcept;
+
+    bool isOpen() const;
+    const char *data() const;
+    std::size_t size() const;
+
+private:
+    void release();
+
+    const char *data_ {nullptr};
+    std::size_t size_ {0};
+    bool open_ {false};
+#ifdef _WIN32
+    void *mapping_ {nullptr};
+#endif
+};
@@ -0,0 +1,204 @@
+#include "NgramIndex.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include "StringPool.h"
+
+namespace {
+
+constexpr char32_t kReplacement = 0xFFFD;
+
+bool continuation(unsigned char c) { return (c & 0xC0u) == 0x80u; }
+
+} // namespace
+
+void NgramIndex::clear() {
+    postings_.clear();
+    categoryGrams_.clear();
+    indexed_ = 0;
+}
+
+void NgramIndex::sync(const RecordStore &store) {
+    if (store.generation() != generation_) {
+        if (store.generation() == generation_ + 1 && !store.compaction().empty()) {
+            remap(store.compaction());
+        } else {
+            clear(); // the store was cleared and refilled
+        }
+        generation_ = store.generation();
+    }
+    const auto &ids = store.ids();
+    const auto &categories = store.categories();
+    for (std::size_t slot = indexed_; slot < ids.size(); ++slot) {
+        const auto id = static_cast<RecordStore::Slot>(slot);
+        gramsOf(store.note(id), noteGrams_);
+        addGrams(noteGrams_, id);
+        addGrams(categoryGrams(categories[slot]), id);
+    }
+    indexed_ = ids.size();
+}
+
+std::size_t NgramIndex::indexedSlots() const { return indexed_; }
+std::size_t NgramIndex::gramCount() const { return postings_.size(); }
+
+std::vector<RecordStore::Slot> NgramIndex::find(const RecordStore &store, std::string_view keyword) const {
+    auto out = candidates(keyword);
+    const auto &live = store.live();
+    const auto &categories = store.categories();
+    out.erase(std::remove_if(out.begin(), out.end(),
+                             [&](RecordStore::Slot slot) {
+                                 return !live[slot] ||
+                                        (store.note(slot).find(keyword) == std::string::npos &&
+                                         StringPool::categories().get(categories[slot]).find(keyword) ==
+                                             std::string::npos);
+                             }),
+              out.end());
+    store.sortByLedgerOrder(out);
+    return out;
+}
+
+std::vector<RecordStore::Slot> NgramIndex::candidates(std::string_view keyword) const {
+    std::vector<RecordStore::Slot> out;
+    std::vector<const std::vector<RecordStore::Slot> *> lists;
+    if (!postingLists(keyword, lists)) {
+        return out;
+    }
+    out = *lists.front();
+    for (std::size_t l = 1; l < lists.size() && !out.empty(); ++l) {
+        // Both sides ascend, so each lookup resumes where the previous one stopped.
+        const auto &list = *lists[l];
+        auto from = list.begin();
+        std::size_t kept = 0;
+        for (const auto slot : out) {
+            from = std::lower_bound(from, list.end(), slot);
+            if (from == list.end()) {
+                break;
+            }
+            if (*from == slot) {
+                out[kept++] = slot;
+            }
+        }
+        out.resize(kept);
+    }
+    return out;
+}
+
+std::size_t NgramIndex::estimate(std::string_view keyword) const {
+    std::vector<const std::vector<RecordStore::Slot> *> lists;
+    return postingLists(keyword, lists) ? lists.front()->size() : 0;
+}
+
+bool NgramIndex::postingLists(std::string_view keyword,
+                              std::vector<const std::vector<RecordStore::Slot> *> &lists) const {
+    std::vector<char32_t> codepoints;
+    decode(keyword, codepoints);
+    if (codepoints.empty()) {
+        return false;
+    }
+    const std::size_t length = std::min(kMaxGram, codepoints.size());
+    for (std::size_t i = 0; i + length <= codepoints.size(); ++i) {
+        const auto it = postings_.find(pack(&codepoints[i], length));
+        if (it == postings_.end()) {
+            return false;
+        }
+        lists.push_back(&it->second);
+    }
+    // Smallest first, duplicates (repeated grams) once.
+    std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b) {
+        return a->size() != b->size() ? a->size() < b->size() : a < b;
+    });
+    lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+    return true;
+}
+
+void NgramIndex::decode(std::string_view text, std::vector<char32_t> &out) {
+    out.clear();
+    std::size_t i = 0;
+    while (i < text.size()) {
+        const auto lead = static_cast<unsigned char>(text[i]);
+        std::size_t extra = 0;
+        char32_t cp = 0;
+        if (lead < 0x80u) {
+            cp = lead;
+        } else if ((lead & 0xE0u) == 0xC0u) {
+            extra = 1;
+            cp = lead & 0x1Fu;
+        } else if ((lead & 0xF0u) == 0xE0u) {
+            extra = 2;
+            cp = lead & 0x0Fu;
+        } else if ((lead & 0xF8u) == 0xF0u) {
+            extra = 3;
+            cp = lead & 0x07u;
+        } else {
+            out.push_back(kReplacement);
+            ++i;
+            continue;
+        }
+        std::size_t k = 1;
+        for (; k <= extra && i + k < text.size() && continuation(static_cast<unsigned char>(text[i + k])); ++k) {
+            cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3Fu);
+        }
+        if (k <= extra || cp > 0x10FFFF) {
+            out.push_back(kReplacement);
+            i += k;
+            continue;
+        }
+        out.push_back(cp == 0 ? kReplacement : cp);
+        i += k;
+    }
+}
+
+NgramIndex::Gram NgramIndex::pack(const char32_t *codepoints, std::size_t length) {
+    // Code points are never 0 here, so grams of different lengths cannot collide.
+    Gram gram = 0;
+    for (std::size_t i = 0; i < length; ++i) {
+        gram = (gram << 21) | codepoints[i];
+    }
+    return gram;
+}
+
+void NgramIndex::remap(const std::vector<RecordStore::Slot> &renumber) {
+    for (auto it = postings_.begin(); it != postings_.end();) {
+        auto &slots = it->second;
+        std::size_t kept = 0;
+        for (const auto slot : slots) {
+            if (renumber[slot] != RecordStore::kNoSlot) {
+                slots[kept++] = renumber[slot];
+            }
+        }
+        slots.resize(kept);
+        it = slots.empty() ? postings_.erase(it) : std::next(it);
+    }
+    indexed_ = static_cast<std::size_t>(
+        std::count_if(renumber.begin(), renumber.begin() + static_cast<std::ptrdiff_t>(indexed_),
+                      [](RecordStore::Slot slot) { return slot != RecordStore::kNoSlot; }));
+}
+
+void NgramIndex::addGrams(const std::vector<Gram> &grams, RecordStore::Slot slot) {
+    for (const auto gram : grams) {
+        auto &list = postings_[gram];
+        if (list.empty() || list.back() != slot) {
+            list.push_back(slot);
+        }
+    }
+}
+
+void NgramIndex::gramsOf(std::string_view text, std::vector<Gram> &out) {
+    out.clear();
+    decode(text, codepoints_);
+    for (std::size_t length = 1; length <= kMaxGram; ++length) {
+        for (std::size_t i = 0; i + length <= codepoints_.size(); ++i) {
+            out.push_back(pack(&codepoints_[i], length));
+        }
+    }
+}
+
+const std::vector<NgramIndex::Gram> &NgramIndex::categoryGrams(std::uint32_t category) {
+    auto it = categoryGrams_.find(category);
+    if (it == categoryGrams_.end()) {
+        std::vector<Gram> grams;
+        gramsOf(StringPool::categories().get(category), grams);
+        it = categoryGrams_.emplace(category, std::move(grams)).first;
+    }
+    return it->second;
+}
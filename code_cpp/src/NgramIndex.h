@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "RecordStore.h"
+
+// Inverted index from the character n-grams (1 to 3 UTF-8 code points) of
+// each record's note and category to the slots that contain them. Word
+// splitting does not apply to Chinese notes; n-grams of code points do.
+//
+// Slots only ever get appended, and RecordStore::update() moves a record to
+// a new slot whenever its text changes, so the posting lists stay ascending
+// and catching up with the store is an append per gram. When the store
+// compacts, the lists are renumbered in place; that keeps them ascending.
+//
+// A query intersects the lists of the keyword's trigrams (its bigram or
+// unigram when shorter), smallest first, then verifies each candidate with
+// a substring test: results are exact, the index only narrows the scan.
+class NgramIndex {
+public:
+    static constexpr std::size_t kMaxGram = 3;
+
+    void clear();
+    // Indexes the slots added to `store` since the previous call.
+    void sync(const RecordStore &store);
+    std::size_t indexedSlots() const;
+    std::size_t gramCount() const;
+
+    // Live slots whose note or category contains `keyword`, in ledger order.
+    std::vector<RecordStore::Slot> find(const RecordStore &store, std::string_view keyword) const;
+    // Unverified superset of find(), ascending by slot; may include erased slots.
+    std::vector<RecordStore::Slot> candidates(std::string_view keyword) const;
+    // Upper bound on the size of candidates(), from the shortest posting list.
+    std::size_t estimate(std::string_view keyword) const;
+
+    // Code points of UTF-8 text; invalid sequences and NUL decode as U+FFFD.
+    static void decode(std::string_view text, std::vector<char32_t> &out);
+
+private:
+    using Gram = std::uint64_t; // up to three 21-bit code points, right-aligned
+
+    static Gram pack(const char32_t *codepoints, std::size_t length);
+    // False if the keyword is empty or one of its grams never occurs.
+    bool postingLists(std::string_view keyword, std::vector<const std::vector<RecordStore::Slot> *> &lists) const;
+    void addGrams(const std::vector<Gram> &grams, RecordStore::Slot slot);
+    void remap(const std::vector<RecordStore::Slot> &renumber);
+    void gramsOf(std::string_view text, std::vector<Gram> &out);
+    const std::vector<Gram> &categoryGrams(std::uint32_t category);
+
+    std::unordered_map<Gram, std::vector<RecordStore::Slot>> postings_;
+    std::unordered_map<std::uint32_t, std::vector<Gram>> categoryGrams_; // few distinct categories
+    std::vector<char32_t> codepoints_; // scratch
+    std::vector<Gram> noteGrams_;      // scratch
+    std::size_t indexed_ = 0;
+    std::uint64_t generation_ = 0; // of the store when last synced
+};
@@ -0,0 +1,131 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+constexpr double kDecay = 2.0 / 3.0;
+constexpr std::size_t kMinCapacity = 8;
+
+} // namespace
+
+QuantileSketch::QuantileSketch(std::uint32_t k)
+    : k_(std::max<std::uint32_t>(k, kMinCapacity)),
+      count_(0),
+      sum_(0),
+      min_(0),
+      max_(0),
+      coin_(0x9e3779b97f4a7c15ULL),
+      retained_(0),
+      levels_(1) {}
+
+void QuantileSketch::add(std::int64_t value) {
+    min_ = count_ == 0 ? value : std::min(min_, value);
+    max_ = count_ == 0 ? value : std::max(max_, value);
+    ++count_;
+    sum_ += value;
+    levels_[0].push_back(value);
+    ++retained_;
+    if (levels_[0].size() >= capacity(0)) {
+        compress();
+    }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+    if (other.count_ == 0) {
+        return;
+    }
+    min_ = count_ == 0 ? other.min_ : std::min(min_, other.min_);
+    max_ = count_ == 0 ? other.max_ : std::max(max_, other.max_);
+    count_ += other.count_;
+    sum_ += other.sum_;
+    if (levels_.size() < other.levels_.size()) {
+        levels_.resize(other.levels_.size());
+    }
+    for (std::size_t h = 0; h < other.levels_.size(); ++h) {
+        levels_[h].insert(levels_[h].end(), other.levels_[h].begin(), other.levels_[h].end());
+        retained_ += other.levels_[h].size();
+    }
+    compress();
+}
+
+std::uint64_t QuantileSketch::count() const { return count_; }
+std::int64_t QuantileSketch::sum() const { return sum_; }
+bool QuantileSketch::empty() const { return count_ == 0; }
+std::int64_t QuantileSketch::min() const { return min_; }
+std::int64_t QuantileSketch::max() const { return max_; }
+std::size_t QuantileSketch::retained() const { return retained_; }
+
+std::int64_t QuantileSketch::quantile(double q) const {
+    if (count_ == 0) {
+        return 0;
+    }
+    if (q <= 0.0) {
+        return min_;
+    }
+    if (q >= 1.0) {
+        return max_;
+    }
+    std::vector<std::pair<std::int64_t, std::uint64_t>> weighted;
+    weighted.reserve(retained_);
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+        for (const auto value : levels_[h]) {
+            weighted.emplace_back(value, std::uint64_t {1} << h);
+        }
+    }
+    std::sort(weighted.begin(), weighted.end());
+    // The total weight equals count_: compaction keeps weight (odd leftovers stay behind).
+    const double target = q * static_cast<double>(count_);
+    std::uint64_t seen = 0;
+    for (const auto &item : weighted) {
+        seen += item.second;
+        if (static_cast<double>(seen) >= target) {
+            return item.first;
+        }
+    }
+    return max_;
+}
+
+std::size_t QuantileSketch::capacity(std::size_t level) const {
+    // Lower levels shrink geometrically below the top one, which keeps k items.
+    const double depth = static_cast<double>(levels_.size() - 1 - level);
+    return std::max(kMinCapacity, static_cast<std::size_t>(std::ceil(k_ * std::pow(kDecay, depth))));
+}
+
+void QuantileSketch::compress() {
+    for (std::size_t h = 0; h < levels_.size(); ++h) {
+        if (levels_[h].size() < capacity(h)) {
+            continue;
+        }
+        if (h + 1 == levels_.size()) {
+            levels_.emplace_back();
+        }
+        auto &level = levels_[h];
+        std::sort(level.begin(), level.end());
+        // An odd item out stays at this level so that no weight is lost.
+        std::int64_t leftover = 0;
+        const bool odd = level.size() % 2 != 0;
+        if (odd) {
+            leftover = level.back();
+            level.pop_back();
+        }
+        auto &up = levels_[h + 1];
+        for (std::size_t i = flip() ? 1 : 0; i < level.size(); i += 2) {
+            up.push_back(level[i]);
+        }
+        retained_ -= level.size() / 2;
+        level.clear();
+        if (odd) {
+            level.push_back(leftover);
+        }
+    }
+}
+
+bool QuantileSketch::flip() {
+    // xorshift64
+    coin_ ^= coin_ << 13;
+    coin_ ^= coin_ >> 7;
+    coin_ ^= coin_ << 17;
+    return (coin_ & 1) != 0;
+}
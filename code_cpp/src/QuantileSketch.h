@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// KLL quantile sketch over integer values (amounts in cents). Level h holds
+// items of weight 2^h; a full level is sorted and every other item, from a
+// random end, moves up a level. With the default k = 200 a quantile's rank
+// is within about 1.5% of n, memory is O(k), and sketches of disjoint
+// streams merge into a sketch of their union. Exact while n < k.
+//
+// The coin is a fixed-seed generator, so equal inputs give equal sketches.
+class QuantileSketch {
+public:
+    explicit QuantileSketch(std::uint32_t k = 200);
+
+    void add(std::int64_t value);
+    void merge(const QuantileSketch &other);
+
+    std::uint64_t count() const;
+    std::int64_t sum() const; // exact
+    bool empty() const;
+    std::int64_t min() const;
+    std::int64_t max() const;
+    // Value of rank q * count(), q in [0, 1]; 0 when empty.
+    std::int64_t quantile(double q) const;
+    std::size_t retained() const; // items kept, for tests and benchmarks
+
+private:
+    std::size_t capacity(std::size_t level) const;
+    void compress();
+    bool flip();
+
+    std::uint32_t k_;
+    std::uint64_t count_;
+    std::int64_t sum_;
+    std::int64_t min_;
+    std::int64_t max_;
+    std::uint64_t coin_;
+    std::size_t retained_;
+    std::vector<std::vector<std::int64_t>> levels_;
+};
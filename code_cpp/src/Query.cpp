@@ -0,0 +1,227 @@
+#include "Query.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include "Date.h"
+#include "StringPool.h"
+
+Query::Query()
+    : keyword_(), category_(), timeRange_({"", ""}), hasAmount_(false), minCents_(0), maxCents_(0),
+      hasType_(false), type_(Record::Type::Expense) {}
+
+void Query::setKeyword(const std::string &keyword) { keyword_ = keyword; }
+void Query::setCategory(const std::string &category) { category_ = category; }
+void Query::setTimeRange(const std::string &from, const std::string &to) { timeRange_ = {from, to}; }
+
+void Query::setAmountRange(double min, double max) {
+    hasAmount_ = true;
+    minCents_ = std::llround(min * 100.0);
+    maxCents_ = std::llround(max * 100.0);
+}
+
+void Query::setType(Record::Type type) {
+    hasType_ = true;
+    type_ = type;
+}
+
+const std::string &Query::getKeyword() const { return keyword_; }
+const std::string &Query::getCategory() const { return category_; }
+std::pair<std::string, std::string> Query::getTimeRange() const { return timeRange_; }
+
+std::string Query::Plan::explain() const {
+    std::ostringstream oss;
+    oss << driverName(driver) << " (~" << estimate << " candidates)";
+    if (!filters.empty()) {
+        oss << ", filter:";
+        for (const auto &filter : filters) {
+            oss << ' ' << filter;
+        }
+    }
+    oss << ", examined " << examined << ", matched " << matched;
+    return oss.str();
+}
+
+Query::Plan Query::plan(const RecordStore &store, const NgramIndex &keywords, const CategoryIndex &categories) const {
+    Plan plan;
+    plan.estimate = store.size();
+    // Earlier candidates win ties: a date slice is already in ledger order.
+    std::int32_t from = 0;
+    std::int32_t to = 0;
+    if ((!timeRange_.first.empty() || !timeRange_.second.empty()) && packedRange(from, to)) {
+        const std::size_t malformed = store.lowerBound(0);
+        const std::size_t begin = std::max(malformed, store.lowerBound(from));
+        const std::size_t end = timeRange_.second.empty() ? store.size() : store.lowerBound(to + 1);
+        const std::size_t estimate = malformed + (end > begin ? end - begin : 0);
+        if (estimate < plan.estimate) {
+            plan.driver = Plan::Driver::DateRange;
+            plan.estimate = estimate;
+        }
+    }
+    if (!category_.empty()) {
+        std::uint32_t id = 0;
+        const Bitmap *slots = StringPool::categories().find(category_, id) ? categories.category(id) : nullptr;
+        const std::size_t estimate = slots == nullptr ? 0 : static_cast<std::size_t>(slots->cardinality());
+        if (estimate < plan.estimate) {
+            plan.driver = Plan::Driver::Category;
+            plan.estimate = estimate;
+        }
+    }
+    if (!keyword_.empty()) {
+        const std::size_t estimate = keywords.estimate(keyword_);
+        if (estimate < plan.estimate) {
+            plan.driver = Plan::Driver::Keyword;
+            plan.estimate = estimate;
+        }
+    }
+
+    // The date slice and the category bitmap are exact; n-gram candidates
+    // still need the substring test.
+    plan.checks = predicates();
+    if (plan.driver == Plan::Driver::DateRange) {
+        plan.checks &= ~Date;
+    } else if (plan.driver == Plan::Driver::Category) {
+        plan.checks &= ~Category;
+    }
+    const std::pair<unsigned, const char *> names[] = {
+        {Keyword, "keyword"}, {Category, "category"}, {Date, "date"}, {Amount, "amount"}, {Type, "type"}};
+    for (const auto &name : names) {
+        if (plan.checks & name.first) {
+            plan.filters.emplace_back(name.second);
+        }
+    }
+    return plan;
+}
+
+RecordList Query::run(const RecordStore &store, const NgramIndex &keywords, const CategoryIndex &categories,
+                      Plan *planOut) const {
+    Plan chosen = plan(store, keywords, categories);
+    std::uint32_t category = 0;
+    if (!category_.empty() && !StringPool::categories().find(category_, category)) {
+        chosen.estimate = 0;
+        if (planOut != nullptr) {
+            *planOut = chosen;
+        }
+        return RecordList(store, {}); // a category that was never interned matches nothing
+    }
+    const unsigned checks = chosen.checks;
+    DateBounds bounds;
+    bounds.packed = packedRange(bounds.from, bounds.to);
+
+    const auto &live = store.live();
+    std::vector<RecordStore::Slot> out;
+    std::size_t examined = 0;
+    const auto consider = [&](RecordStore::Slot slot) {
+        ++examined;
+        if (live[slot] && matches(store, slot, checks, category, bounds)) {
+            out.push_back(slot);
+        }
+    };
+    bool ordered = true;
+    switch (chosen.driver) {
+        case Plan::Driver::DateRange: {
+            const auto &order = store.order();
+            const auto &dates = store.dates();
+            const std::size_t malformed = store.lowerBound(0);
+            for (std::size_t i = 0; i < malformed; ++i) {
+                if (matchesDate(dates[order[i]], bounds)) {
+                    consider(order[i]);
+                } else {
+                    ++examined;
+                }
+            }
+            const std::size_t end = timeRange_.second.empty() ? order.size() : store.lowerBound(bounds.to + 1);
+            for (std::size_t i = std::max(malformed, store.lowerBound(bounds.from)); i < end; ++i) {
+                consider(order[i]);
+            }
+            break;
+        }
+        case Plan::Driver::Category:
+            if (const Bitmap *slots = categories.category(category)) {
+                slots->forEach(consider);
+            }
+            ordered = false;
+            break;
+        case Plan::Driver::Keyword:
+            for (const auto slot : keywords.candidates(keyword_)) {
+                consider(slot);
+            }
+            ordered = false;
+            break;
+        case Plan::Driver::FullScan:
+            for (const auto slot : store.order()) {
+                consider(slot);
+            }
+            break;
+    }
+    if (!ordered) {
+        store.sortByLedgerOrder(out);
+    }
+    chosen.examined = examined;
+    chosen.matched = out.size();
+    if (planOut != nullptr) {
+        *planOut = std::move(chosen);
+    }
+    return RecordList(store, std::move(out));
+}
+
+unsigned Query::predicates() const {
+    unsigned set = 0;
+    set |= keyword_.empty() ? 0u : Keyword;
+    set |= category_.empty() ? 0u : Category;
+    set |= timeRange_.first.empty() && timeRange_.second.empty() ? 0u : Date;
+    set |= hasAmount_ ? Amount : 0u;
+    set |= hasType_ ? Type : 0u;
+    return set;
+}
+
+bool Query::matches(const RecordStore &store, RecordStore::Slot slot, unsigned checks, std::uint32_t category,
+                    const DateBounds &bounds) const {
+    if ((checks & Category) && store.categories()[slot] != category) {
+        return false;
+    }
+    if ((checks & Type) && (store.incomes()[slot] != 0) != (type_ == Record::Type::Income)) {
+        return false;
+    }
+    if ((checks & Amount) && (store.cents()[slot] < minCents_ || store.cents()[slot] > maxCents_)) {
+        return false;
+    }
+    if ((checks & Date) && !matchesDate(store.dates()[slot], bounds)) {
+        return false;
+    }
+    if (checks & Keyword) {
+        return store.note(slot).find(keyword_) != std::string::npos ||
+               StringPool::categories().get(store.categories()[slot]).find(keyword_) != std::string::npos;
+    }
+    return true;
+}
+
+bool Query::matchesDate(std::int32_t date, const DateBounds &bounds) const {
+    if (date >= 0 && bounds.packed) {
+        return date >= bounds.from && date <= bounds.to;
+    }
+    const std::string text = Record::decodeDate(date);
+    return (timeRange_.first.empty() || text >= timeRange_.first) &&
+           (timeRange_.second.empty() || text <= timeRange_.second);
+}
+
+bool Query::packedRange(std::int32_t &from, std::int32_t &to) const {
+    from = 0;
+    to = std::numeric_limits<std::int32_t>::max();
+    return (timeRange_.first.empty() || Date::parsePacked(timeRange_.first, from)) &&
+           (timeRange_.second.empty() || Date::parsePacked(timeRange_.second, to));
+}
+
+const char *Query::driverName(Plan::Driver driver) {
+    switch (driver) {
+        case Plan::Driver::DateRange:
+            return "date range";
+        case Plan::Driver::Category:
+            return "category bitmap";
+        case Plan::Driver::Keyword:
+            return "n-gram index";
+        case Plan::Driver::FullScan:
+            break;
+    }
+    return "full scan";
+}
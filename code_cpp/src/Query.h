@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "CategoryIndex.h"
+#include "NgramIndex.h"
+#include "Record.h"
+#include "RecordStore.h"
+#include "RecordView.h"
+
+// A conjunction of optional predicates over the ledger: keyword, category,
+// date range, amount range and type. Unset predicates match everything and
+// an empty date bound leaves that side open.
+//
+// plan() estimates how many candidates each usable access path yields and
+// picks the smallest:
+//   DateRange - the slice of the ledger order between packed date bounds,
+//   Category  - the category's bitmap (exact),
+//   Keyword   - the intersection of the keyword's n-gram posting lists,
+//   FullScan  - the whole ledger order.
+// run() reads the candidates from that path and applies the remaining
+// predicates as filters. The plan, with its estimate and actual counts, is
+// available through Plan::explain() for tuning.
+class Query {
+public:
+    struct Plan {
+        enum class Driver { FullScan, DateRange, Category, Keyword };
+
+        Driver driver = Driver::FullScan;
+        std::size_t estimate = 0;         // candidates the driver yields, at most
+        unsigned checks = 0;              // predicates checked on each candidate
+        std::vector<std::string> filters; // their names, for explain() only
+        std::size_t examined = 0;         // set by run()
+        std::size_t matched = 0;          // set by run()
+
+        std::string explain() const;
+    };
+
+    Query();
+
+    void setKeyword(const std::string &keyword);
+    void setCategory(const std::string &category);
+    void setTimeRange(const std::string &from, const std::string &to);
+    void setAmountRange(double min, double max); // inclusive, in yuan
+    void setType(Record::Type type);
+
+    const std::string &getKeyword() const;
+    const std::string &getCategory() const;
+    std::pair<std::string, std::string> getTimeRange() const;
+
+    // The indexes must be in sync with `store`.
+    Plan plan(const RecordStore &store, const NgramIndex &keywords, const CategoryIndex &categories) const;
+    RecordList run(const RecordStore &store, const NgramIndex &keywords, const CategoryIndex &categories,
+                   Plan *plan = nullptr) const;
+
+private:
+    enum Predicate : unsigned { Keyword = 1, Category = 2, Date = 4, Amount = 8, Type = 16 };
+
+    // The date bounds, parsed once per run(). Without `packed` some bound is
+    // not YYYY-MM-DD and rows are compared as text.
+    struct DateBounds {
+        bool packed = false;
+        std::int32_t from = 0;
+        std::int32_t to = 0;
+    };
+
+    unsigned predicates() const;
+    bool matches(const RecordStore &store, RecordStore::Slot slot, unsigned checks, std::uint32_t category,
+                 const DateBounds &bounds) const;
+    bool matchesDate(std::int32_t date, const DateBounds &bounds) const;
+    // Packed bounds when every non-empty bound is YYYY-MM-DD; open sides
+    // become 0 and INT32_MAX.
+    bool packedRange(std::int32_t &from, std::int32_t &to) const;
+    static const char *driverName(Plan::Driver driver);
+
+    std::string keyword_;
+    std::string category_;
+    std::pair<std::string, std::string> timeRange_;
+    bool hasAmount_;
+    std::int64_t minCents_;
+    std::int64_t maxCents_;
+    bool hasType_;
+    Record::Type type_;
+};
@@ -1,89 +1,259 @@
 #include "Record.h"
-#include <sstream>
-#include <utility>
-#include <vector>
+#include <cmath>
 #include <stdexcept>
+#include "Date.h"
+#include "IdGenerator.h"
+#include "StringPool.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
-static std::string ensureUtf8(const std::string &text) {
+
+namespace {
+
+// On Windows, text that is not valid UTF-8 is taken to be in the ANSI code
+// page and converted; true if `utf8` now holds that conversion.
+bool convertToUtf8(std::string_view view, std::string &utf8) {
 #ifdef _WIN32
-    if (text.empty()) return text;
+    if (view.empty()) return false;
 
+    std::string text(view);
     int testLen = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text.c_str(), -1, nullptr, 0);
     if (testLen > 0) {
-        return text; // already valid UTF-8
+        return false; // already valid UTF-8
     }
 
     int wideLen = MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, nullptr, 0);
     if (wideLen <= 0) {
-        return text;
+        return false;
     }
     std::wstring wide(static_cast<size_t>(wideLen - 1), L'\0');
     MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, wide.data(), wideLen);
 
     int utf8Len = WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, nullptr, 0, nullptr, nullptr);
     if (utf8Len <= 0) {
-        return text;
+        return false;
     }
-    std::string utf8(static_cast<size_t>(utf8Len - 1), '\0');
+    utf8.assign(static_cast<size_t>(utf8Len - 1), '\0');
     WideCharToMultiByte(CP_UTF8, 0, wide.c_str(), -1, utf8.data(), utf8Len, nullptr, nullptr);
-    return utf8;
+    return true;
 #else
-    return text;
+    (void)view;
+    (void)utf8;
+    return false;
 #endif
 }
 
-static std::vector<std::string> splitTSV(const std::string &s) {
-    std::vector<std::string> out;
-    std::string cur;
-    for (char c : s) {
-        if (c == '\t') {
-            out.push_back(cur);
-            cur.clear();
-        } else {
-            cur.push_back(c);
+std::uint32_t internUtf8(StringPool &pool, std::string_view view) {
+    std::string utf8;
+    return pool.lookup(convertToUtf8(view, utf8) ? std::string_view(utf8) : view);
+}
+
+// Up to 18 digits always fits below 2^62, leaving the top bits for tags.
+constexpr std::size_t kMaxNumericIdDigits = 18;
+
+// The value of a "REC<decimal>" or generated id; false for any other text.
+bool numericId(std::string_view id, std::uint64_t &value) {
+    const std::string_view digits = id.substr(id.size() < 3 ? id.size() : 3);
+    const bool numeric = id.size() > 3 && id.compare(0, 3, "REC") == 0 && digits.size() <= kMaxNumericIdDigits &&
+                         digits[0] != '0';
+    if (numeric) {
+        value = 0;
+        bool ok = true;
+        for (char c : digits) {
+            if (c < '0' || c > '9') {
+                ok = false;
+                break;
+            }
+            value = value * 10 + static_cast<std::uint64_t>(c - '0');
+        }
+        if (ok) {
+            return true;
         }
     }
-    out.push_back(cur);
-    return out;
+    return IdGenerator::parse(id, value);
 }
 
-Record::Record() : amount_(0.0), type_(Type::Expense) {}
+} // namespace
 
-Record::Record(std::string id, std::string date, double amount, Type type, std::string category, std::string note)
-    : id_(std::move(id)), date_(std::move(date)), amount_(amount), type_(type), category_(std::move(category)), note_(std::move(note)) {}
+Record::Record() : id_(kTextId), cents_(0), date_(-1), category_(0), type_(Type::Expense), note_() {}
 
-std::string Record::getId() const { return id_; }
-std::string Record::getDate() const { return date_; }
-double Record::getAmount() const { return amount_; }
+Record::Record(std::string_view id, std::string_view date, double amount, Type type,
+               std::string_view category, std::string_view note)
+    : id_(encodeId(id)),
+      cents_(std::llround(amount * 100.0)),
+      date_(encodeDate(date)),
+      category_(StringPool::categories().intern(category)),
+      type_(type),
+      note_(note) {}
+
+Record::Record(std::uint64_t id, std::string_view date, double amount, Type type,
+               std::string_view category, std::string_view note)
+    : id_(id),
+      cents_(std::llround(amount * 100.0)),
+      date_(encodeDate(date)),
+      category_(StringPool::categories().intern(category)),
+      type_(type),
+      note_(note) {}
+
+Record Record::fromColumns(std::uint64_t id, std::int32_t date, std::int64_t cents, Type type,
+                           std::uint32_t category, std::string_view note) {
+    Record r;
+    r.id_ = id;
+    r.cents_ = cents;
+    r.date_ = date;
+    r.category_ = category;
+    r.note_ = note;
+    r.type_ = type;
+    return r;
+}
+
+Record::Columns Record::columns() const { return Columns {id_, date_, cents_, type_, category_, note_}; }
+
+std::string Record::getId() const { return decodeId(id_); }
+std::string Record::getDate() const { return decodeDate(date_); }
+double Record::getAmount() const { return static_cast<double>(cents_) / 100.0; }
 Record::Type Record::getType() const { return type_; }
-std::string Record::getCategory() const { return category_; }
-std::string Record::getNote() const { return note_; }
+const std::string &Record::getCategory() const { return StringPool::categories().get(category_); }
+const std::string &Record::getNote() const { return note_; }
+
+std::uint64_t Record::getIdValue() const { return id_; }
+std::int32_t Record::getDateValue() const { return date_; }
+std::int64_t Record::getCents() const { return cents_; }
+std::uint32_t Record::getCategoryId() const { return category_; }
+
+std::uint64_t Record::encodeId(std::string_view id) {
+    std::uint64_t value = 0;
+    return numericId(id, value) ? value : kTextId | StringPool::text().intern(id);
+}
+
+std::uint64_t Record::lookupId(std::string_view id) {
+    std::uint64_t value = 0;
+    return numericId(id, value) ? value : kTextId | StringPool::text().lookup(id);
+}
+
+std::string Record::decodeId(std::uint64_t id) {
+    if (id & kTextId) {
+        return StringPool::text().get(static_cast<std::uint32_t>(id));
+    }
+    if (IdGenerator::isGenerated(id)) {
+        return IdGenerator::toString(id);
+    }
+    return "REC" + std::to_string(id);
+}
+
+std::int32_t Record::encodeDate(std::string_view date) {
+    std::int32_t packed = 0;
+    if (Date::parsePacked(date, packed)) {
+        return packed;
+    }
+    return -1 - static_cast<std::int32_t>(StringPool::text().intern(date));
+}
+
+std::int32_t Record::lookupDate(std::string_view date) {
+    std::int32_t packed = 0;
+    if (Date::parsePacked(date, packed)) {
+        return packed;
+    }
+    return -1 - static_cast<std::int32_t>(StringPool::text().lookup(date));
+}
+
+std::string Record::decodeDate(std::int32_t date) {
+    if (date < 0) {
+        return StringPool::text().get(static_cast<std::uint32_t>(-1 - date));
+    }
+    return Date::formatPacked(date);
+}
+
+std::string Record::formatCents(std::int64_t cents) {
+    std::string out;
+    std::uint64_t magnitude = static_cast<std::uint64_t>(cents);
+    if (cents < 0) {
+        out += '-';
+        magnitude = ~magnitude + 1;
+    }
+    out += std::to_string(magnitude / 100);
+    const auto fraction = static_cast<unsigned>(magnitude % 100);
+    if (fraction != 0) {
+        out += '.';
+        out += static_cast<char>('0' + fraction / 10);
+        if (fraction % 10 != 0) {
+            out += static_cast<char>('0' + fraction % 10);
+        }
+    }
+    return out;
+}
+
+bool Record::less(const Record &lhs, const Record &rhs) {
+    return keyLess(lhs.date_, lhs.id_, rhs.date_, rhs.id_);
+}
+
+bool Record::keyLess(std::int32_t lhsDate, std::uint64_t lhsId, std::int32_t rhsDate, std::uint64_t rhsId) {
+    if (lhsDate != rhsDate) {
+        if (lhsDate < 0 && rhsDate < 0) {
+            return StringPool::text().get(static_cast<std::uint32_t>(-1 - lhsDate)) <
+                   StringPool::text().get(static_cast<std::uint32_t>(-1 - rhsDate));
+        }
+        return lhsDate < rhsDate;
+    }
+    if (lhsId != rhsId) {
+        // Numeric ids sort before text ids because kTextId is the top bit.
+        if ((lhsId & rhsId & kTextId) != 0) {
+            return StringPool::text().get(static_cast<std::uint32_t>(lhsId)) <
+                   StringPool::text().get(static_cast<std::uint32_t>(rhsId));
+        }
+        return lhsId < rhsId;
+    }
+    return false;
+}
+
+bool Record::operator==(const Record &other) const {
+    return id_ == other.id_ && cents_ == other.cents_ && date_ == other.date_ && category_ == other.category_ &&
+           note_ == other.note_ && type_ == other.type_;
+}
 
 std::string Record::toTSV() const {
-    std::ostringstream os;
-    os << id_ << '\t' << date_ << '\t' << amount_ << '\t' << (type_ == Type::Income ? "I" : "E") << '\t' << category_ << '\t' << note_;
-    return os.str();
-}
-
-Record Record::fromTSV(const std::string &line) {
-    auto parts = splitTSV(line);
-    if (parts.size() < 6) throw std::runtime_error("bad record line");
-    std::string id = parts[0];
-    std::string date = parts[1];
-    double amount = 0.0;
-    try {
-        amount = std::stod(parts[2]);
-    } catch (...) { amount = 0.0; }
-    Type t = (parts[3] == "I") ? Type::Income : Type::Expense;
-    std::string category = ensureUtf8(parts[4]);
-    std::string note = ensureUtf8(parts[5]);
-    return Record(id, date, amount, t, category, note);
+    std::string out = getId();
+    out += '\t';
+    out += getDate();
+    out += '\t';
+    out += formatCents(cents_);
+    out += type_ == Type::Income ? "\tI\t" : "\tE\t";
+    out += getCategory();
+    out += '\t';
+    out += getNote();
+    return out;
+}
+
+Record Record::fromTSV(std::string_view line) {
+    TsvParser::Fields fields;
+    if (TsvParser::splitLine(line, fields) < TsvParser::kFieldCount) throw std::runtime_error("bad record line");
+    return fromTSVFields(fields);
+}
+
+Record Record::fromTSVFields(const TsvParser::Fields &fields) {
+    std::string utf8;
+    const Columns c = columnsFromTSV(fields, utf8);
+    return fromColumns(c.id, c.date, c.cents, c.type, c.category, c.note);
+}
+
+Record::Columns Record::columnsFromTSV(const TsvParser::Fields &fields, std::string &utf8) {
+    std::int64_t cents = 0;
+    if (!TsvParser::parseCents(fields[2], cents)) {
+        cents = 0;
+    }
+    Type t = (fields[3] == "I") ? Type::Income : Type::Expense;
+    return Columns {lookupId(fields[0]), lookupDate(fields[1]), cents, t,
+                    internUtf8(StringPool::categories(), fields[4]),
+                    convertToUtf8(fields[5], utf8) ? std::string_view(utf8) : fields[5]};
 }
 
 std::string Record::getRecordInfo() const {
-    std::ostringstream os;
-    os << date_ << " | " << (type_ == Type::Income ? "+" : "-") << amount_ << " | " << category_ << " | " << note_;
-    return os.str();
+    std::string out = getDate();
+    out += type_ == Type::Income ? " | +" : " | -";
+    out += formatCents(cents_);
+    out += " | ";
+    out += getCategory();
+    out += " | ";
+    out += getNote();
+    return out;
 }
@@ -1,31 +1,87 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include "TsvParser.h"
 
+// Ledger entry. Money is integer cents, the date is a packed YYYYMMDD
+// integer, the category is an id into the process-wide category pool, and
+// the id is numeric whenever the text form allows it. The note is owned:
+// notes are mostly unique, so interning them would only grow the pool; a
+// RecordStore keeps them in its own heap instead. The string getters are
+// adapters over this layout.
 class Record {
 public:
     enum class Type { Income, Expense };
 
     Record();
-    Record(std::string id, std::string date, double amount, Type type, std::string category, std::string note);
+    Record(std::string_view id, std::string_view date, double amount, Type type,
+           std::string_view category, std::string_view note);
+    // With an id value as returned by IdGenerator::next().
+    Record(std::uint64_t id, std::string_view date, double amount, Type type,
+           std::string_view category, std::string_view note);
+    static Record fromColumns(std::uint64_t id, std::int32_t date, std::int64_t cents, Type type,
+                              std::uint32_t category, std::string_view note);
+
+    // The stored form of one record, with the note as a view, for loaders
+    // that fill columns without building a Record.
+    struct Columns {
+        std::uint64_t id;
+        std::int32_t date;
+        std::int64_t cents;
+        Type type;
+        std::uint32_t category;
+        std::string_view note;
+    };
+    Columns columns() const; // the note views this record
 
     std::string getId() const;
     std::string getDate() const; // format YYYY-MM-DD
     double getAmount() const;
     Type getType() const;
-    std::string getCategory() const;
-    std::string getNote() const;
+    const std::string &getCategory() const;
+    const std::string &getNote() const;
+
+    std::uint64_t getIdValue() const;    // see encodeId
+    std::int32_t getDateValue() const;   // see encodeDate
+    std::int64_t getCents() const;
+    std::uint32_t getCategoryId() const; // into StringPool::categories()
+
+    // "REC<decimal>" ids are stored as the number, generated "ID..." ids as
+    // their IdGenerator value; any other id is interned and tagged with kTextId.
+    static constexpr std::uint64_t kTextId = std::uint64_t {1} << 63;
+    static std::uint64_t encodeId(std::string_view id);
+    static std::string decodeId(std::uint64_t id);
+    // Valid dates become packed YYYYMMDD (> 0); other text is interned and
+    // stored as -1 - textId, so malformed dates sort first.
+    static std::int32_t encodeDate(std::string_view date);
+    static std::string decodeDate(std::int32_t date);
+    // As encodeId/encodeDate, through StringPool::lookup(): inside a
+    // StringPool::Scratch, text the pool has not seen stays in the Scratch.
+    static std::uint64_t lookupId(std::string_view id);
+    static std::int32_t lookupDate(std::string_view date);
+    static std::string formatCents(std::int64_t cents); // shortest exact decimal, e.g. "12.5"
+
+    // Ledger order: date, then id. keyLess is the same order on raw columns.
+    static bool less(const Record &lhs, const Record &rhs);
+    static bool keyLess(std::int32_t lhsDate, std::uint64_t lhsId, std::int32_t rhsDate, std::uint64_t rhsId);
+    bool operator==(const Record &other) const;
+    bool operator!=(const Record &other) const { return !(*this == other); }
 
     std::string toTSV() const; // serialize for storage
-    static Record fromTSV(const std::string &line);
+    static Record fromTSV(std::string_view line);
+    static Record fromTSVFields(const TsvParser::Fields &fields);
+    // As fromTSVFields; the note views the line, or `utf8` if it had to be converted.
+    static Columns columnsFromTSV(const TsvParser::Fields &fields, std::string &utf8);
 
     std::string getRecordInfo() const;
 
 private:
-    std::string id_;
-    std::string date_;
-    double amount_;
+    std::uint64_t id_;
+    std::int64_t cents_;
+    std::int32_t date_;
+    std::uint32_t category_;
     Type type_;
-    std::string category_;
     std::string note_;
 };
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include "Record.h"
+
+// Push-style record stream. The visitor returns false to stop the scan early;
+// the Record it receives is only valid for the duration of the call.
+using RecordVisitor = std::function<bool(const Record &)>;
+using RecordSource = std::function<void(const RecordVisitor &)>;
+
+inline RecordSource makeRecordSource(const std::vector<Record> &records) {
+    return [&records](const RecordVisitor &visit) {
+        for (const auto &record : records) {
+            if (!visit(record)) {
+                return;
+            }
+        }
+    };
+}
+
+// Whether a record vector is known to be in ledger order (Record::less).
+// Date-range queries binary-search Sorted input and scan Unsorted input.
+enum class RecordOrder { Unsorted, Sorted };
+
+// First index of a ledger-ordered vector whose date is not before the packed
+// `date`. Malformed dates are negative, so they form a prefix.
+inline std::size_t lowerBoundDate(const std::vector<Record> &records, std::int32_t date) {
+    const auto it = std::partition_point(records.begin(), records.end(),
+                                         [date](const Record &r) { return r.getDateValue() < date; });
+    return static_cast<std::size_t>(it - records.begin());
+}
+
+// Index ranges [first, second) of a ledger-ordered vector that can fall in
+// the packed range [first, last]: the malformed-date prefix, which callers
+// still compare as text, then the range itself. O(log N).
+inline std::vector<std::pair<std::size_t, std::size_t>> dateRangeSlices(const std::vector<Record> &records,
+                                                                          std::int32_t first, std::int32_t last) {
+    const std::size_t malformed = lowerBoundDate(records, 0);
+    const std::size_t begin = std::max(malformed, lowerBoundDate(records, first));
+    return {{0, malformed}, {begin, std::max(begin, lowerBoundDate(records, last + 1))}};
+}
+
+// Streams the dateRangeSlices() of a ledger-ordered vector: O(log N + k)
+// instead of a full scan.
+inline RecordSource makeDateRangeSource(const std::vector<Record> &records, std::int32_t first, std::int32_t last) {
+    return [&records, first, last](const RecordVisitor &visit) {
+        for (const auto &slice : dateRangeSlices(records, first, last)) {
+            for (std::size_t i = slice.first; i < slice.second; ++i) {
+                if (!visit(records[i])) {
+                    return;
+                }
+            }
+        }
+    };
+}
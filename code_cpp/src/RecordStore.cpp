@@ -0,0 +1,306 @@
+#include "RecordStore.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+std::size_t RecordStore::size() const { return ids_.size() - erased_.size(); }
+bool RecordStore::empty() const { return size() == 0; }
+
+void RecordStore::clear() {
+    ids_.clear();
+    dates_.clear();
+    cents_.clear();
+    incomes_.clear();
+    categories_.clear();
+    notes_.clear();
+    live_.clear();
+    index_.clear();
+    older_.clear();
+    indexed_ = 0;
+    erased_.clear();
+    order_.clear();
+    pending_.clear();
+    droppedDead_ = 0;
+    compaction_.clear();
+    ++generation_;
+}
+
+void RecordStore::reserve(std::size_t count, std::size_t noteBytes) {
+    if (count > ids_.size()) {
+        pending_.reserve(pending_.size() + (count - ids_.size()));
+    }
+    ids_.reserve(count);
+    dates_.reserve(count);
+    cents_.reserve(count);
+    incomes_.reserve(count);
+    categories_.reserve(count);
+    notes_.reserve(count, notes_.bytes() + noteBytes);
+    live_.reserve(count);
+}
+
+RecordStore::Slot RecordStore::append(const Record::Columns &columns) {
+    if (ids_.size() >= std::numeric_limits<Slot>::max()) {
+        throw std::length_error("record store is full");
+    }
+    const auto slot = static_cast<Slot>(ids_.size());
+    ids_.push_back(columns.id);
+    dates_.push_back(columns.date);
+    cents_.push_back(columns.cents);
+    incomes_.push_back(columns.type == Record::Type::Income ? 1 : 0);
+    categories_.push_back(columns.category);
+    notes_.push(columns.note);
+    live_.push_back(1);
+    return slot;
+}
+
+void RecordStore::indexPending() const {
+    if (indexed_ == ids_.size()) {
+        return;
+    }
+    index_.reserve(ids_.size());
+    for (; indexed_ < ids_.size(); ++indexed_) {
+        const auto slot = static_cast<Slot>(indexed_);
+        const auto inserted = index_.emplace(ids_[slot], slot);
+        if (!inserted.second) {
+            older_.emplace(ids_[slot], inserted.first->second);
+            inserted.first->second = slot;
+        }
+    }
+}
+
+bool RecordStore::slotLess(Slot lhs, Slot rhs) const {
+    return Record::keyLess(dates_[lhs], ids_[lhs], dates_[rhs], ids_[rhs]);
+}
+
+RecordStore::Slot RecordStore::insert(const Record &record) { return insert(record.columns()); }
+
+void RecordStore::insert(const std::vector<Record> &records) {
+    reserve(ids_.size() + records.size());
+    for (const auto &record : records) {
+        pending_.push_back(append(record.columns()));
+    }
+}
+
+RecordStore::Slot RecordStore::insert(const Record::Columns &columns) {
+    const Slot slot = append(columns);
+    pending_.push_back(slot);
+    return slot;
+}
+
+bool RecordStore::find(std::uint64_t id, Slot &slot) const {
+    indexPending();
+    const auto it = index_.find(id);
+    if (it == index_.end()) {
+        return false;
+    }
+    slot = it->second;
+    return true;
+}
+
+std::vector<RecordStore::Slot> RecordStore::copies(std::uint64_t id) const {
+    std::vector<Slot> out;
+    Slot newest = 0;
+    if (!find(id, newest)) {
+        return out;
+    }
+    const auto range = older_.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        out.push_back(it->second);
+    }
+    std::sort(out.begin(), out.end());
+    out.push_back(newest);
+    return out;
+}
+
+bool RecordStore::update(std::uint64_t id, const Record &record) {
+    Slot slot = 0;
+    if (!find(id, slot)) {
+        return false;
+    }
+    killOlderCopies(id);
+    const auto target = record.getIdValue();
+    Slot other = 0;
+    if (target != id && find(target, other)) {
+        // Records already under the new id are replaced too.
+        killOlderCopies(target);
+        kill(other);
+        index_.erase(target);
+    }
+    if (record.getIdValue() != id || record.getDateValue() != dates_[slot] ||
+        record.getCategoryId() != categories_[slot] || record.getNote() != notes_.get(slot)) {
+        kill(slot);
+        index_.erase(id);
+        insert(record);
+    } else {
+        cents_[slot] = record.getCents();
+        incomes_[slot] = record.getType() == Record::Type::Income ? 1 : 0;
+    }
+    compactIfSparse();
+    return true;
+}
+
+bool RecordStore::erase(std::uint64_t id) {
+    Slot slot = 0;
+    if (!find(id, slot)) {
+        return false;
+    }
+    killOlderCopies(id);
+    kill(slot);
+    index_.erase(id);
+    compactIfSparse();
+    return true;
+}
+
+void RecordStore::kill(Slot slot) {
+    live_[slot] = 0;
+    erased_.push_back(slot);
+}
+
+void RecordStore::killOlderCopies(std::uint64_t id) {
+    const auto range = older_.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+        kill(it->second);
+    }
+    older_.erase(range.first, range.second);
+}
+
+void RecordStore::compactIfSparse() {
+    const std::size_t dead = erased_.size();
+    if (dead < kCompactMinDead || dead < ids_.size() - dead) {
+        return;
+    }
+    mergePending(); // drops the dead from the order; pending_ is empty after
+    indexPending();
+    std::vector<Slot> renumber(ids_.size(), kNoSlot);
+    Slot next = 0;
+    for (std::size_t slot = 0; slot < ids_.size(); ++slot) {
+        if (!live_[slot]) {
+            continue;
+        }
+        ids_[next] = ids_[slot];
+        dates_[next] = dates_[slot];
+        cents_[next] = cents_[slot];
+        incomes_[next] = incomes_[slot];
+        categories_[next] = categories_[slot];
+        renumber[slot] = next++;
+    }
+    ids_.resize(next);
+    dates_.resize(next);
+    cents_.resize(next);
+    incomes_.resize(next);
+    categories_.resize(next);
+    notes_.retain(live_);
+    live_.assign(next, 1);
+    for (auto &slot : order_) {
+        slot = renumber[slot];
+    }
+    for (auto &entry : index_) {
+        entry.second = renumber[entry.second];
+    }
+    for (auto &entry : older_) {
+        entry.second = renumber[entry.second];
+    }
+    erased_.clear();
+    droppedDead_ = 0;
+    indexed_ = next;
+    compaction_ = std::move(renumber);
+    ++generation_;
+}
+
+void RecordStore::dropDead() const {
+    const auto less = [this](Slot a, Slot b) { return slotLess(a, b); };
+    if (erased_.size() - droppedDead_ > kShortRun) {
+        const auto dead = [this](Slot slot) { return live_[slot] == 0; };
+        order_.erase(std::remove_if(order_.begin(), order_.end(), dead), order_.end());
+        pending_.erase(std::remove_if(pending_.begin(), pending_.end(), dead), pending_.end());
+    } else {
+        // A dead slot keeps its key columns, so it is found as an insert would be.
+        for (std::size_t i = droppedDead_; i < erased_.size(); ++i) {
+            const Slot slot = erased_[i];
+            const auto range = std::equal_range(order_.begin(), order_.end(), slot, less);
+            const auto it = std::find(range.first, range.second, slot);
+            if (it != range.second) {
+                order_.erase(it);
+                continue;
+            }
+            const auto waiting = std::find(pending_.begin(), pending_.end(), slot);
+            if (waiting != pending_.end()) {
+                pending_.erase(waiting);
+            }
+        }
+    }
+    droppedDead_ = erased_.size();
+}
+
+void RecordStore::mergePending() const {
+    if (droppedDead_ < erased_.size()) {
+        dropDead();
+    }
+    if (pending_.empty()) {
+        return;
+    }
+    const auto less = [this](Slot a, Slot b) { return slotLess(a, b); };
+    if (pending_.size() <= kShortRun) {
+        // After each slot equal to it, so equal keys keep arrival order.
+        for (const Slot slot : pending_) {
+            order_.insert(std::upper_bound(order_.begin(), order_.end(), slot, less), slot);
+        }
+        pending_.clear();
+        return;
+    }
+    // Stable, so equal keys keep arrival order and existing slots stay first.
+    std::stable_sort(pending_.begin(), pending_.end(), less);
+    const bool appendsInOrder = order_.empty() || !less(pending_.front(), order_.back());
+    const auto middle = static_cast<std::ptrdiff_t>(order_.size());
+    order_.insert(order_.end(), pending_.begin(), pending_.end());
+    pending_.clear();
+    if (!appendsInOrder) {
+        std::inplace_merge(order_.begin(), order_.begin() + middle, order_.end(), less);
+    }
+}
+
+Record RecordStore::get(Slot slot) const {
+    return Record::fromColumns(ids_[slot], dates_[slot], cents_[slot],
+                               incomes_[slot] ? Record::Type::Income : Record::Type::Expense,
+                               categories_[slot], notes_.get(slot));
+}
+
+Record RecordStore::at(std::size_t position) const { return get(order()[position]); }
+
+std::vector<Record> RecordStore::toRecords() const {
+    std::vector<Record> out;
+    out.reserve(size());
+    for (Slot slot : order()) {
+        out.push_back(get(slot));
+    }
+    return out;
+}
+
+std::size_t RecordStore::lowerBound(std::int32_t date) const {
+    // Malformed dates are negative and sort first, consistent with this bound.
+    mergePending();
+    const auto it = std::lower_bound(order_.begin(), order_.end(), date,
+                                     [this](Slot slot, std::int32_t value) { return dates_[slot] < value; });
+    return static_cast<std::size_t>(it - order_.begin());
+}
+
+const std::vector<RecordStore::Slot> &RecordStore::order() const {
+    mergePending();
+    return order_;
+}
+const std::vector<std::uint64_t> &RecordStore::ids() const { return ids_; }
+const std::vector<std::int32_t> &RecordStore::dates() const { return dates_; }
+const std::vector<std::int64_t> &RecordStore::cents() const { return cents_; }
+const std::vector<std::uint8_t> &RecordStore::incomes() const { return incomes_; }
+const std::vector<std::uint32_t> &RecordStore::categories() const { return categories_; }
+const StringHeap &RecordStore::notes() const { return notes_; }
+const std::vector<std::uint8_t> &RecordStore::live() const { return live_; }
+const std::vector<RecordStore::Slot> &RecordStore::erased() const { return erased_; }
+std::uint64_t RecordStore::generation() const { return generation_; }
+const std::vector<RecordStore::Slot> &RecordStore::compaction() const { return compaction_; }
+
+void RecordStore::sortByLedgerOrder(std::vector<Slot> &slots) const {
+    std::sort(slots.begin(), slots.end(), [this](Slot a, Slot b) {
+        return slotLess(a, b) || (!slotLess(b, a) && a < b);
+    });
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "Record.h"
+#include "StringHeap.h"
+
+// Struct-of-arrays ledger. Each field lives in its own column, indexed by a
+// stable slot number; a separate slot list keeps the ledger order
+// (date, then id). Aggregations scan the columns they need directly;
+// get()/at() rebuild a Record for display. Notes live in the store's own
+// StringHeap, indexed by slot, so they go away with their records.
+//
+// New slots go to a pending run and are folded into the ordered run on the
+// next ordered read. A long run is sorted once and merged in linear time, so
+// a burst of N inserts costs O(N log N) overall. A short run, such as the one
+// record the UI adds between two reads, is placed slot by slot: O(log N)
+// comparisons plus one shift of the 4-byte order entries behind it. The
+// shift is still O(N) memory moves, so an ordered read after every backdated
+// insert is not logarithmic, only far cheaper than a merge. Erased slots
+// leave the order the same way.
+//
+// An id -> slot hash index makes update() and erase() O(1). Like the order,
+// it catches up with new slots on the next lookup, so a bulk load that is
+// never queried by id does not pay for it. An erased slot is only flagged
+// dead (column scans check live()) and leaves the ledger order on the next
+// ordered read. An update that keeps the (date, id) key and the
+// text columns is written in place, otherwise it is an erase plus an insert;
+// text indexes (NgramIndex) can therefore catch up by slot number alone.
+//
+// Once dead slots outnumber live ones (and a minimum), update() and erase()
+// compact the columns: live slots are renumbered densely in their old order
+// and generation() changes, and the note heap drops the dead notes. Indexes
+// over slots remap through compaction().
+class RecordStore {
+public:
+    using Slot = std::uint32_t;
+    static constexpr Slot kNoSlot = std::numeric_limits<Slot>::max();
+
+    std::size_t size() const; // live records
+    bool empty() const;
+    void clear();
+    void reserve(std::size_t count, std::size_t noteBytes = 0);
+
+    // Appends to the columns; the slot joins the ledger order lazily.
+    Slot insert(const Record &record);
+    void insert(const std::vector<Record> &records);
+    // The note is copied into the store's heap, so it may view a transient buffer.
+    Slot insert(const Record::Columns &columns);
+
+    // Lookups by Record::getIdValue(). find() returns the newest copy of a
+    // duplicated id; update() and erase() replace or drop every copy, as a
+    // journal replay does.
+    bool find(std::uint64_t id, Slot &slot) const;
+    std::vector<Slot> copies(std::uint64_t id) const; // live slots, oldest first
+    bool update(std::uint64_t id, const Record &record); // false if no such id
+    bool erase(std::uint64_t id);
+
+    Record get(Slot slot) const;
+    Record at(std::size_t position) const; // position in ledger order
+    std::vector<Record> toRecords() const; // ledger order
+    // First position in ledger order whose date is not before `date` (packed).
+    std::size_t lowerBound(std::int32_t date) const;
+
+    const std::vector<Slot> &order() const; // merges the pending run first
+    const std::vector<std::uint64_t> &ids() const;
+    const std::vector<std::int32_t> &dates() const;
+    const std::vector<std::int64_t> &cents() const;
+    const std::vector<std::uint8_t> &incomes() const; // 1 for Income, 0 for Expense
+    const std::vector<std::uint32_t> &categories() const;
+    const StringHeap &notes() const; // string i is the note of slot i
+    std::string_view note(Slot slot) const { return notes_.get(slot); }
+    const std::vector<std::uint8_t> &live() const; // 0 for erased slots
+    // Slots in the order they were erased, so that indexes over slots can catch up.
+    const std::vector<Slot> &erased() const;
+    // Sorts arbitrary slots into ledger order (date, id, then slot).
+    void sortByLedgerOrder(std::vector<Slot> &slots) const;
+
+    // Changes on clear() and on every compaction; slots from an older
+    // generation are meaningless.
+    std::uint64_t generation() const;
+    // Old slot -> new slot of the latest compaction (kNoSlot for dead ones);
+    // empty if the latest generation change was a clear().
+    const std::vector<Slot> &compaction() const;
+
+private:
+    // Compaction waits for this many dead slots, so small stores never pay for it.
+    static constexpr std::size_t kCompactMinDead = 4096;
+    // Up to this many new or erased slots are placed by binary search instead of a merge or a sweep.
+    static constexpr std::size_t kShortRun = 8;
+
+    Slot append(const Record::Columns &columns);
+    void kill(Slot slot);
+    void killOlderCopies(std::uint64_t id);
+    void compactIfSparse();
+    bool slotLess(Slot lhs, Slot rhs) const;
+    void mergePending() const;
+    void dropDead() const;
+    void indexPending() const;
+
+    std::vector<std::uint64_t> ids_;
+    std::vector<std::int32_t> dates_;
+    std::vector<std::int64_t> cents_;
+    std::vector<std::uint8_t> incomes_;
+    std::vector<std::uint32_t> categories_;
+    StringHeap notes_;
+    std::vector<std::uint8_t> live_;
+    mutable std::unordered_map<std::uint64_t, Slot> index_;  // newest copy
+    mutable std::unordered_multimap<std::uint64_t, Slot> older_; // earlier live copies of duplicated ids
+    mutable std::size_t indexed_ = 0; // slots below this are in index_ / older_
+    std::vector<Slot> erased_;
+    std::vector<Slot> compaction_;
+    std::uint64_t generation_ = 0;
+    mutable std::vector<Slot> order_;
+    mutable std::vector<Slot> pending_; // arrival order
+    mutable std::size_t droppedDead_ = 0; // erased_ entries already gone from order_ and pending_
+};
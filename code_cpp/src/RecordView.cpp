@@ -0,0 +1,92 @@
+#include "RecordView.h"
+#include <algorithm>
+#include "StringPool.h"
+
+std::string RecordRef::getId() const { return Record::decodeId(getIdValue()); }
+std::string RecordRef::getDate() const { return Record::decodeDate(getDateValue()); }
+double RecordRef::getAmount() const { return static_cast<double>(getCents()) / 100.0; }
+
+Record::Type RecordRef::getType() const {
+    return store_->incomes()[slot_] ? Record::Type::Income : Record::Type::Expense;
+}
+
+const std::string &RecordRef::getCategory() const { return StringPool::categories().get(getCategoryId()); }
+
+std::string RecordRef::getRecordInfo() const { return toRecord().getRecordInfo(); }
+
+std::vector<Record> RecordRange::toRecords() const {
+    std::vector<Record> out;
+    out.reserve(size());
+    for (const auto *at = first_; at != last_; ++at) {
+        out.push_back(store_->get(*at));
+    }
+    return out;
+}
+
+RecordCursor::RecordCursor(const RecordStore &store, Slices slices, Predicate matches, Page page)
+    : store_(&store), owned_(), sequence_(&store.order()), slices_(std::move(slices)), matches_(std::move(matches)),
+      page_(page), total_(0), step_(0), skipped_(0), returned_(0), examined_(0) {
+    for (const auto &slice : slices_) {
+        total_ += slice.second - slice.first;
+    }
+}
+
+RecordCursor::RecordCursor(RecordList list, Page page)
+    : store_(&list.store()),
+      owned_(std::make_shared<const std::vector<RecordStore::Slot>>(std::move(list).takeSlots())),
+      sequence_(owned_.get()), slices_({{0, owned_->size()}}), matches_(), page_(page), total_(owned_->size()),
+      step_(0), skipped_(0), returned_(0), examined_(0) {
+    // Without a predicate the offset is a plain jump.
+    step_ = std::min(page_.offset, total_);
+    skipped_ = page_.offset;
+}
+
+bool RecordCursor::next(RecordStore::Slot &slot) {
+    while (!done()) {
+        const RecordStore::Slot candidate = at(step_++);
+        if (matches_) {
+            ++examined_;
+            if (!matches_(candidate)) {
+                continue;
+            }
+        }
+        if (skipped_ < page_.offset) {
+            ++skipped_;
+            continue;
+        }
+        ++returned_;
+        slot = candidate;
+        return true;
+    }
+    return false;
+}
+
+RecordList RecordCursor::take() {
+    std::vector<RecordStore::Slot> out;
+    RecordStore::Slot slot = 0;
+    while (next(slot)) {
+        out.push_back(slot);
+    }
+    return RecordList(*store_, std::move(out));
+}
+
+RecordStore::Slot RecordCursor::at(std::size_t step) const {
+    if (page_.newestFirst) {
+        for (auto it = slices_.rbegin(); it != slices_.rend(); ++it) {
+            const std::size_t length = it->second - it->first;
+            if (step < length) {
+                return (*sequence_)[it->second - 1 - step];
+            }
+            step -= length;
+        }
+    } else {
+        for (const auto &slice : slices_) {
+            const std::size_t length = slice.second - slice.first;
+            if (step < length) {
+                return (*sequence_)[slice.first + step];
+            }
+            step -= length;
+        }
+    }
+    return 0; // unreachable: step < total_
+}
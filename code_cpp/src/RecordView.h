@@ -0,0 +1,158 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "Record.h"
+#include "RecordStore.h"
+
+// Read-only handle to one row of a RecordStore. It has the same getters as
+// Record but reads them from the columns; the category is a reference into
+// the category pool and the note a view of the store's note heap, so nothing
+// is copied. Valid until the store changes.
+class RecordRef {
+public:
+    RecordRef(const RecordStore &store, RecordStore::Slot slot) : store_(&store), slot_(slot) {}
+
+    RecordStore::Slot slot() const { return slot_; }
+
+    std::string getId() const;
+    std::string getDate() const;
+    double getAmount() const;
+    Record::Type getType() const;
+    const std::string &getCategory() const;
+    std::string_view getNote() const { return store_->note(slot_); }
+
+    std::uint64_t getIdValue() const { return store_->ids()[slot_]; }
+    std::int32_t getDateValue() const { return store_->dates()[slot_]; }
+    std::int64_t getCents() const { return store_->cents()[slot_]; }
+    std::uint32_t getCategoryId() const { return store_->categories()[slot_]; }
+
+    std::string getRecordInfo() const;
+    Record toRecord() const { return store_->get(slot_); }
+
+private:
+    const RecordStore *store_;
+    RecordStore::Slot slot_;
+};
+
+// Non-owning view of a run of slots (ledger order or a query result).
+class RecordRange {
+public:
+    class iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = RecordRef;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = RecordRef;
+
+        iterator(const RecordStore *store, const RecordStore::Slot *at) : store_(store), at_(at) {}
+        RecordRef operator*() const { return RecordRef(*store_, *at_); }
+        iterator &operator++() {
+            ++at_;
+            return *this;
+        }
+        bool operator==(const iterator &other) const { return at_ == other.at_; }
+        bool operator!=(const iterator &other) const { return at_ != other.at_; }
+
+    private:
+        const RecordStore *store_;
+        const RecordStore::Slot *at_;
+    };
+
+    RecordRange(const RecordStore &store, const RecordStore::Slot *first, const RecordStore::Slot *last)
+        : store_(&store), first_(first), last_(last) {}
+
+    std::size_t size() const { return static_cast<std::size_t>(last_ - first_); }
+    bool empty() const { return first_ == last_; }
+    RecordRef operator[](std::size_t i) const { return RecordRef(*store_, first_[i]); }
+    iterator begin() const { return iterator(store_, first_); }
+    iterator end() const { return iterator(store_, last_); }
+    std::vector<Record> toRecords() const;
+
+private:
+    const RecordStore *store_;
+    const RecordStore::Slot *first_;
+    const RecordStore::Slot *last_;
+};
+
+// Query result: owns the matching slots, reads the rows from the store.
+class RecordList {
+public:
+    RecordList(const RecordStore &store, std::vector<RecordStore::Slot> slots)
+        : store_(&store), slots_(std::move(slots)) {}
+
+    RecordRange range() const { return RecordRange(*store_, slots_.data(), slots_.data() + slots_.size()); }
+    std::size_t size() const { return slots_.size(); }
+    bool empty() const { return slots_.empty(); }
+    RecordRef operator[](std::size_t i) const { return RecordRef(*store_, slots_[i]); }
+    RecordRange::iterator begin() const { return range().begin(); }
+    RecordRange::iterator end() const { return range().end(); }
+    const std::vector<RecordStore::Slot> &slots() const { return slots_; }
+    std::vector<RecordStore::Slot> takeSlots() && { return std::move(slots_); }
+    const RecordStore &store() const { return *store_; }
+    std::vector<Record> toRecords() const { return range().toRecords(); }
+
+private:
+    const RecordStore *store_;
+    std::vector<RecordStore::Slot> slots_;
+};
+
+// Lazy, paginated walk over a query's matches. Slots are tested only as
+// next() asks for them, oldest or newest first, so "the latest 20 lunches"
+// stops after the 20th hit instead of collecting every lunch. Valid until
+// the store changes.
+class RecordCursor {
+public:
+    static constexpr std::size_t kAll = std::numeric_limits<std::size_t>::max();
+
+    struct Page {
+        std::size_t offset = 0;  // matches skipped before the first returned
+        std::size_t limit = kAll; // matches returned at most
+        bool newestFirst = false;
+    };
+
+    using Slices = std::vector<std::pair<std::size_t, std::size_t>>;
+    using Predicate = std::function<bool(RecordStore::Slot)>;
+
+    // Tests the slots at the given [begin, end) positions of the store's
+    // ledger order; slices must be ascending and disjoint.
+    RecordCursor(const RecordStore &store, Slices slices, Predicate matches, Page page);
+    // Pages through a computed result, every slot of which matches.
+    RecordCursor(RecordList list, Page page);
+
+    // The next match; false once `limit` matches were returned or the
+    // candidates ran out.
+    bool next(RecordStore::Slot &slot);
+    // Every remaining match, in cursor order.
+    RecordList take();
+
+    const RecordStore &store() const { return *store_; }
+    std::size_t returned() const { return returned_; }
+    std::size_t examined() const { return examined_; } // slots tested so far
+    bool done() const { return returned_ >= page_.limit || step_ >= total_; }
+
+private:
+    // The slot at the step-th candidate position in cursor order.
+    RecordStore::Slot at(std::size_t step) const;
+
+    const RecordStore *store_;
+    std::shared_ptr<const std::vector<RecordStore::Slot>> owned_;
+    const std::vector<RecordStore::Slot> *sequence_;
+    Slices slices_;
+    Predicate matches_; // empty: every candidate matches
+    Page page_;
+    std::size_t total_;
+    std::size_t step_;
+    std::size_t skipped_;
+    std::size_t returned_;
+    std::size_t examined_;
+};
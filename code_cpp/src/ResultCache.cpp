@@ -0,0 +1,153 @@
+#include "ResultCache.h"
+#include <utility>
+
+ResultCache::ResultCache(std::size_t capacity) : capacity_(capacity), version_(0), clock_(0), entries_(), counters_() {}
+
+bool ResultCache::findSearch(SearchKind kind, const Search &criteria, std::vector<RecordStore::Slot> &slots) {
+    const Entry *entry = find(searchKey(kind, criteria));
+    if (entry != nullptr) {
+        slots = entry->slots;
+    }
+    return entry != nullptr;
+}
+
+void ResultCache::storeSearch(SearchKind kind, const Search &criteria, const std::vector<RecordStore::Slot> &slots) {
+    Entry &entry = insert(searchKey(kind, criteria));
+    switch (kind) {
+        case SearchKind::Keyword:
+            entry.depends = Depends::Keyword;
+            entry.first = criteria.getKeyword();
+            break;
+        case SearchKind::Category:
+            entry.depends = Depends::Category;
+            entry.first = criteria.getCategory();
+            break;
+        case SearchKind::Time:
+            entry.depends = Depends::DateRange;
+            entry.first = criteria.getTimeRange().first;
+            entry.second = criteria.getTimeRange().second;
+            break;
+    }
+    entry.slots = slots;
+}
+
+bool ResultCache::findStatistics(const std::string &period, Statistics::Mode mode, Statistics::TimeSummary &summary,
+                                 std::vector<Statistics::CategorySummaryItem> *items) {
+    const Entry *entry = find(statisticsKey(period, mode));
+    if (entry == nullptr) {
+        return false;
+    }
+    summary = entry->summary;
+    if (items != nullptr) {
+        *items = entry->items;
+    }
+    return true;
+}
+
+void ResultCache::storeStatistics(const std::string &period, Statistics::Mode mode,
+                                  const Statistics::TimeSummary &summary,
+                                  const std::vector<Statistics::CategorySummaryItem> &items) {
+    Entry &entry = insert(statisticsKey(period, mode));
+    entry.depends = Depends::Period;
+    entry.first = period;
+    entry.summary = summary;
+    entry.items = items;
+}
+
+void ResultCache::invalidate(const Record &record) {
+    for (auto it = entries_.begin(); it != entries_.end();) {
+        if (it->second.version == version_ && !affects(it->second, record)) {
+            ++it;
+            continue;
+        }
+        counters_.invalidations += it->second.version == version_ ? 1 : 0;
+        it = entries_.erase(it);
+    }
+}
+
+void ResultCache::clear() {
+    // Stale entries are dropped as they are met.
+    ++version_;
+}
+
+const ResultCache::Counters &ResultCache::counters() const { return counters_; }
+
+std::size_t ResultCache::size() const {
+    std::size_t current = 0;
+    for (const auto &entry : entries_) {
+        current += entry.second.version == version_ ? 1 : 0;
+    }
+    return current;
+}
+
+std::string ResultCache::searchKey(SearchKind kind, const Search &criteria) {
+    // '\x1f' cannot come from the one-line text fields the criteria hold.
+    switch (kind) {
+        case SearchKind::Keyword:
+            return "K\x1f" + criteria.getKeyword();
+        case SearchKind::Category:
+            return "C\x1f" + criteria.getCategory();
+        case SearchKind::Time:
+            break;
+    }
+    return "T\x1f" + criteria.getTimeRange().first + "\x1f" + criteria.getTimeRange().second;
+}
+
+std::string ResultCache::statisticsKey(const std::string &period, Statistics::Mode mode) {
+    return (mode == Statistics::Mode::Time ? "S\x1f" : "B\x1f") + period;
+}
+
+bool ResultCache::affects(const Entry &entry, const Record &record) {
+    switch (entry.depends) {
+        case Depends::Keyword:
+            return record.getNote().find(entry.first) != std::string::npos ||
+                   record.getCategory().find(entry.first) != std::string::npos;
+        case Depends::Category:
+            return record.getCategory() == entry.first;
+        case Depends::DateRange: {
+            // Search compares dates as text, and packed dates order the same way.
+            const std::string date = record.getDate();
+            return (entry.first.empty() || date >= entry.first) && (entry.second.empty() || date <= entry.second);
+        }
+        case Depends::Period:
+            break;
+    }
+    return record.getDate().rfind(entry.first, 0) == 0;
+}
+
+ResultCache::Entry *ResultCache::find(const std::string &key) {
+    auto it = entries_.find(key);
+    if (it != entries_.end() && it->second.version != version_) {
+        entries_.erase(it);
+        it = entries_.end();
+    }
+    if (it == entries_.end()) {
+        ++counters_.misses;
+        return nullptr;
+    }
+    ++counters_.hits;
+    it->second.lastUsed = ++clock_;
+    return &it->second;
+}
+
+ResultCache::Entry &ResultCache::insert(const std::string &key) {
+    if (entries_.size() >= capacity_ && entries_.find(key) == entries_.end()) {
+        // Evict a stale entry, else the least recently used one.
+        auto victim = entries_.begin();
+        for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+            if (it->second.version != version_) {
+                victim = it;
+                break;
+            }
+            if (it->second.lastUsed < victim->second.lastUsed) {
+                victim = it;
+            }
+        }
+        entries_.erase(victim);
+    }
+    Entry &entry = entries_[key];
+    entry = Entry();
+    entry.version = version_;
+    entry.lastUsed = ++clock_;
+    return entry;
+}
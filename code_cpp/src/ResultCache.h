@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "Record.h"
+#include "RecordStore.h"
+#include "Search.h"
+#include "Statistics.h"
+
+// Memoized search results and statistics for one User's ledger. Each entry
+// remembers what its answer depends on (a keyword, a category, a date range
+// or a statistics period), and invalidate() drops only the entries a
+// written record can change; a write elsewhere in the ledger keeps them.
+// clear() drops everything at once by bumping the version every entry is
+// stamped with. Search results are stored as slots, which stay valid until
+// the store is cleared.
+class ResultCache {
+public:
+    enum class SearchKind { Keyword, Category, Time };
+
+    struct Counters {
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+        std::size_t invalidations = 0; // entries dropped by writes
+    };
+
+    explicit ResultCache(std::size_t capacity = 64);
+
+    // Only the criterion `kind` uses is part of the key.
+    bool findSearch(SearchKind kind, const Search &criteria, std::vector<RecordStore::Slot> &slots);
+    void storeSearch(SearchKind kind, const Search &criteria, const std::vector<RecordStore::Slot> &slots);
+    // `items` is filled for Mode::Category entries.
+    bool findStatistics(const std::string &period, Statistics::Mode mode, Statistics::TimeSummary &summary,
+                        std::vector<Statistics::CategorySummaryItem> *items);
+    void storeStatistics(const std::string &period, Statistics::Mode mode, const Statistics::TimeSummary &summary,
+                         const std::vector<Statistics::CategorySummaryItem> &items);
+
+    // Call with the old and the new version of every written record.
+    void invalidate(const Record &record);
+    void clear();
+
+    const Counters &counters() const;
+    std::size_t size() const;
+
+private:
+    enum class Depends { Keyword, Category, DateRange, Period };
+
+    struct Entry {
+        std::uint64_t version = 0;
+        std::uint64_t lastUsed = 0;
+        Depends depends = Depends::Period;
+        std::string first;  // keyword, category, range start or period
+        std::string second; // range end
+        std::vector<RecordStore::Slot> slots;
+        Statistics::TimeSummary summary;
+        std::vector<Statistics::CategorySummaryItem> items;
+    };
+
+    static std::string searchKey(SearchKind kind, const Search &criteria);
+    static std::string statisticsKey(const std::string &period, Statistics::Mode mode);
+    static bool affects(const Entry &entry, const Record &record);
+    Entry *find(const std::string &key);
+    Entry &insert(const std::string &key);
+
+    std::size_t capacity_;
+    std::uint64_t version_;
+    std::uint64_t clock_;
+    std::map<std::string, Entry> entries_;
+    Counters counters_;
+};
@@ -0,0 +1,72 @@
+#include "RollupCube.h"
+
+void RollupCube::add(const Record &record) {
+    const std::int32_t date = record.getDateValue();
+    const std::uint64_t cell = (std::uint64_t {record.getCategoryId()} << 1) |
+                               (record.getType() == Record::Type::Income ? 1u : 0u);
+    if (date < 0) {
+        apply(malformed_, date, cell, record.getCents(), true);
+        return;
+    }
+    apply(days_, date, cell, record.getCents(), true);
+    apply(months_, date / 100, cell, record.getCents(), true);
+}
+
+void RollupCube::add(const std::vector<Record> &records) {
+    for (const auto &record : records) {
+        add(record);
+    }
+}
+
+void RollupCube::remove(const Record &record) {
+    const std::int32_t date = record.getDateValue();
+    const std::uint64_t cell = (std::uint64_t {record.getCategoryId()} << 1) |
+                               (record.getType() == Record::Type::Income ? 1u : 0u);
+    if (date < 0) {
+        apply(malformed_, date, cell, record.getCents(), false);
+        return;
+    }
+    apply(days_, date, cell, record.getCents(), false);
+    apply(months_, date / 100, cell, record.getCents(), false);
+}
+
+void RollupCube::clear() {
+    days_.clear();
+    months_.clear();
+    malformed_.clear();
+}
+
+std::size_t RollupCube::cellCount() const {
+    std::size_t count = 0;
+    for (const auto *groups : {&days_, &malformed_}) {
+        for (const auto &group : *groups) {
+            count += group.second.size();
+        }
+    }
+    return count;
+}
+
+void RollupCube::apply(Groups &groups, std::int32_t key, std::uint64_t cell, std::int64_t cents, bool adding) {
+    if (adding) {
+        Cell &target = groups[key][cell];
+        target.cents += cents;
+        ++target.count;
+        return;
+    }
+    const auto group = groups.find(key);
+    if (group == groups.end()) {
+        return;
+    }
+    const auto target = group->second.find(cell);
+    if (target == group->second.end()) {
+        return;
+    }
+    target->second.cents -= cents;
+    // Empty cells are dropped so that scans over the cube stay proportional to what is in it.
+    if (--target->second.count == 0) {
+        group->second.erase(target);
+        if (group->second.empty()) {
+            groups.erase(group);
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Record.h"
+
+// Running sums and counts of the ledger per (day, category, type), plus the
+// same per month, maintained on every write in O(1). Month, year and day
+// statistics and category breakdowns read a handful of cells instead of the
+// records. Malformed dates keep their own cells so that periods can still
+// match them as text.
+class RollupCube {
+public:
+    struct Cell {
+        std::int64_t cents = 0;
+        std::size_t count = 0;
+    };
+
+    void add(const Record &record);
+    void add(const std::vector<Record> &records);
+    void remove(const Record &record); // must have been added
+    void clear();
+
+    // visit(category, income, cell) for each non-empty cell of the group.
+    template <typename Visit>
+    void forEachInDay(std::int32_t date, Visit &&visit) const { visitGroup(days_, date, visit); }
+    template <typename Visit>
+    void forEachInMonth(std::int32_t month, Visit &&visit) const { visitGroup(months_, month, visit); } // YYYYMM
+    // visit(date, category, income, cell) over every day, or every malformed date.
+    template <typename Visit>
+    void forEachDay(Visit &&visit) const { visitAll(days_, visit); }
+    template <typename Visit>
+    void forEachMalformed(Visit &&visit) const { visitAll(malformed_, visit); }
+    template <typename Visit>
+    void forEachMonth(Visit &&visit) const { visitAll(months_, visit); }
+
+    std::size_t cellCount() const; // day and malformed cells
+
+private:
+    // Keyed by (category << 1) | income.
+    using Group = std::unordered_map<std::uint64_t, Cell>;
+    using Groups = std::unordered_map<std::int32_t, Group>;
+
+    static void apply(Groups &groups, std::int32_t key, std::uint64_t cell, std::int64_t cents, bool adding);
+
+    template <typename Visit>
+    static void visitGroup(const Groups &groups, std::int32_t key, Visit &visit) {
+        const auto it = groups.find(key);
+        if (it == groups.end()) {
+            return;
+        }
+        for (const auto &entry : it->second) {
+            visit(static_cast<std::uint32_t>(entry.first >> 1), (entry.first & 1) != 0, entry.second);
+        }
+    }
+
+    template <typename Visit>
+    static void visitAll(const Groups &groups, Visit &visit) {
+        for (const auto &group : groups) {
+            for (const auto &entry : group.second) {
+                visit(group.first, static_cast<std::uint32_t>(entry.first >> 1), (entry.first & 1) != 0, entry.second);
+            }
+        }
+    }
+
+    Groups days_;      // packed YYYYMMDD
+    Groups months_;    // YYYYMM
+    Groups malformed_; // Record::getDateValue() of malformed dates (< 0)
+};
@@ -1,4 +1,12 @@
 #include "Search.h"
+#include <algorithm>
+#include "Date.h"
+#include "StringArena.h"
+#include "StringPool.h"
+#include "SubstringMatcher.h"
+#include "ThreadPool.h"
+#include <memory>
+#include <utility>
 
 Search::Search() : keyword_(), category_(), timeRange_({"", ""}) {}
 
@@ -12,45 +20,289 @@ const std::string& Search::getKeyword() const { return keyword_; }
 const std::string& Search::getCategory() const { return category_; }
 std::pair<std::string, std::string> Search::getTimeRange() const { return timeRange_; }
 
-std::vector<Record> Search::searchByKeyword(const std::vector<Record> &records) const {
-    std::vector<Record> out;
-    if (keyword_.empty()) {
-        return out;
-    }
-    for (const auto &record : records) {
-        if (record.getNote().find(keyword_) != std::string::npos ||
-            record.getCategory().find(keyword_) != std::string::npos) {
-            out.push_back(record);
+namespace {
+
+// Rows per parallel chunk: enough that scheduling costs are noise, few
+// enough that the workers stay balanced.
+constexpr std::size_t kChunkRows = 16384;
+
+// Appends item(i) for each i in [0, count) accepted by `matches`, in index
+// order. Chunks are filtered on the shared ThreadPool and joined in order,
+// so the output does not depend on the thread count.
+template <typename T, typename Item, typename Pred>
+void collectOrdered(std::size_t count, Item &&item, Pred &&matches, std::vector<T> &out) {
+    std::vector<std::vector<T>> parts(ThreadPool::chunkCount(count, kChunkRows));
+    ThreadPool::shared().parallelFor(count, kChunkRows, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            const T &value = item(i);
+            if (matches(value)) {
+                parts[chunk].push_back(value);
+            }
         }
+    });
+    for (const auto &part : parts) {
+        out.insert(out.end(), part.begin(), part.end());
     }
-    return out;
 }
 
-std::vector<Record> Search::searchByCategory(const std::vector<Record> &records) const {
+// Slots in ledger order whose columns satisfy `matches`.
+template <typename Pred>
+RecordList collectSlots(const RecordStore &store, Pred &&matches) {
+    const auto &order = store.order();
+    std::vector<RecordStore::Slot> out;
+    collectOrdered(order.size(), [&](std::size_t i) -> const RecordStore::Slot & { return order[i]; }, matches, out);
+    return RecordList(store, std::move(out));
+}
+
+// Records of the index ranges `slices` accepted by `matches`, in order.
+template <typename Pred>
+std::vector<Record> collectRecords(const std::vector<Record> &records,
+                                   const std::vector<std::pair<std::size_t, std::size_t>> &slices, Pred &&matches) {
     std::vector<Record> out;
-    if (category_.empty()) {
-        return out;
+    for (const auto &slice : slices) {
+        collectOrdered(slice.second - slice.first,
+                       [&](std::size_t i) -> const Record & { return records[slice.first + i]; }, matches, out);
+    }
+    return out;
+}
+
+// Feeds only the records accepted by `matches` to onMatch.
+template <typename Pred>
+void filter(const RecordSource &source, const RecordVisitor &onMatch, Pred &&matches) {
+    source([&](const Record &record) {
+        return !matches(record) || onMatch(record);
+    });
+}
+
+// Keyword test over a note and an interned category id. Categories are few
+// and shared, so one pass over StringArena::categories() marks the matching
+// ones up front; categories interned after that pass test the name itself.
+// Notes are tested one by one, except that a full column scan marks every
+// matching slot with one pass over the store's note heap (see heapPass()).
+class KeywordMatch {
+public:
+    explicit KeywordMatch(const std::string &keyword) : matcher_(keyword) {
+        StringArena::categories().match(matcher_, categories_);
     }
-    for (const auto &record : records) {
-        if (record.getCategory() == category_) {
-            out.push_back(record);
+
+    bool operator()(std::string_view note, std::uint32_t category) const {
+        return matcher_.contains(note) || matchesCategory(category);
+    }
+
+    // hits[slot] = 1 for every slot of `store` whose note or category matches.
+    void heapPass(const RecordStore &store, std::vector<std::uint8_t> &hits) const {
+        store.notes().match(matcher_, hits);
+        const auto &categories = store.categories();
+        for (std::size_t slot = 0; slot < hits.size(); ++slot) {
+            hits[slot] = hits[slot] != 0 || matchesCategory(categories[slot]) ? 1 : 0;
         }
     }
-    return out;
+
+private:
+    bool matchesCategory(std::uint32_t id) const {
+        return id < categories_.size() ? categories_[id] != 0 : matcher_.contains(StringPool::categories().get(id));
+    }
+
+    SubstringMatcher matcher_;
+    std::vector<std::uint8_t> categories_;
+};
+
+} // namespace
+
+std::vector<Record> Search::searchByKeyword(const std::vector<Record> &records) const {
+    if (keyword_.empty()) {
+        return {};
+    }
+    const KeywordMatch matches(keyword_);
+    return collectRecords(records, {{0, records.size()}},
+                          [&](const Record &record) { return matches(record.getNote(), record.getCategoryId()); });
+}
+
+std::vector<Record> Search::searchByCategory(const std::vector<Record> &records) const {
+    std::uint32_t category = 0;
+    if (category_.empty() || !StringPool::categories().find(category_, category)) {
+        return {};
+    }
+    return collectRecords(records, {{0, records.size()}},
+                          [category](const Record &record) { return record.getCategoryId() == category; });
 }
 
 std::vector<Record> Search::searchByTime(const std::vector<Record> &records) const {
-    std::vector<Record> out;
-    const auto &[from, to] = timeRange_;
-    if (from.empty() || to.empty()) {
-        return out;
+    return searchByTime(records, RecordOrder::Unsorted);
+}
+
+std::vector<Record> Search::searchByTime(const std::vector<Record> &records, RecordOrder order) const {
+    std::int32_t from = 0;
+    std::int32_t to = 0;
+    if (timeRange_.first.empty() || timeRange_.second.empty()) {
+        return {};
+    }
+    const bool packed = packedRange(from, to);
+    const auto slices = order == RecordOrder::Sorted && packed
+                            ? dateRangeSlices(records, from, to)
+                            : std::vector<std::pair<std::size_t, std::size_t>> {{0, records.size()}};
+    return collectRecords(records, slices,
+                          [&](const Record &record) { return matchesTime(record.getDateValue(), packed, from, to); });
+}
+
+void Search::searchByKeyword(const RecordSource &source, const RecordVisitor &onMatch) const {
+    if (keyword_.empty()) {
+        return;
     }
-    for (const auto &record : records) {
-        if (between(record.getDate(), from, to)) {
-            out.push_back(record);
+    const KeywordMatch matches(keyword_);
+    filter(source, onMatch, [&](const Record &record) { return matches(record.getNote(), record.getCategoryId()); });
+}
+
+void Search::searchByCategory(const RecordSource &source, const RecordVisitor &onMatch) const {
+    // A category name that was never interned cannot match any record.
+    std::uint32_t category = 0;
+    if (category_.empty() || !StringPool::categories().find(category_, category)) {
+        return;
+    }
+    filter(source, onMatch, [category](const Record &record) { return record.getCategoryId() == category; });
+}
+
+void Search::searchByTime(const RecordSource &source, const RecordVisitor &onMatch) const {
+    if (timeRange_.first.empty() || timeRange_.second.empty()) {
+        return;
+    }
+    std::int32_t from = 0;
+    std::int32_t to = 0;
+    const bool packed = packedRange(from, to);
+    filter(source, onMatch, [&](const Record &record) { return matchesTime(record.getDateValue(), packed, from, to); });
+}
+
+RecordList Search::searchByKeyword(const RecordStore &store) const {
+    if (keyword_.empty()) {
+        return RecordList(store, {});
+    }
+    std::vector<std::uint8_t> hits;
+    KeywordMatch(keyword_).heapPass(store, hits);
+    return collectSlots(store, [&hits](RecordStore::Slot slot) { return hits[slot] != 0; });
+}
+
+RecordCursor Search::cursorByKeyword(const RecordStore &store, RecordCursor::Page page) const {
+    if (keyword_.empty()) {
+        return RecordCursor(RecordList(store, {}), page);
+    }
+    // No pass over the note heap: a short page may only look at a few rows.
+    const auto matches = std::make_shared<const KeywordMatch>(keyword_);
+    const auto &categories = store.categories();
+    return RecordCursor(store, {{0, store.order().size()}},
+                        [matches, &store, &categories](RecordStore::Slot slot) {
+                            return (*matches)(store.note(slot), categories[slot]);
+                        },
+                        page);
+}
+
+RecordCursor Search::cursorByCategory(const RecordStore &store, RecordCursor::Page page) const {
+    std::uint32_t category = 0;
+    if (category_.empty() || !StringPool::categories().find(category_, category)) {
+        return RecordCursor(RecordList(store, {}), page);
+    }
+    const auto &categories = store.categories();
+    return RecordCursor(store, {{0, store.order().size()}},
+                        [category, &categories](RecordStore::Slot slot) { return categories[slot] == category; }, page);
+}
+
+RecordCursor Search::cursorByTime(const RecordStore &store, RecordCursor::Page page) const {
+    if (timeRange_.first.empty() || timeRange_.second.empty()) {
+        return RecordCursor(RecordList(store, {}), page);
+    }
+    std::int32_t from = 0;
+    std::int32_t to = 0;
+    const bool packed = packedRange(from, to);
+    RecordCursor::Slices slices {{0, store.order().size()}};
+    if (packed) {
+        // Only the malformed prefix and the binary-searched range can match.
+        const std::size_t malformed = store.lowerBound(0);
+        const std::size_t begin = std::max(malformed, store.lowerBound(from));
+        slices = {{0, malformed}, {begin, std::max(begin, store.lowerBound(to + 1))}};
+    }
+    const auto &dates = store.dates();
+    return RecordCursor(store, std::move(slices),
+                        [search = *this, &dates, packed, from, to](RecordStore::Slot slot) {
+                            return search.matchesTime(dates[slot], packed, from, to);
+                        },
+                        page);
+}
+
+RecordList Search::searchByKeyword(const RecordStore &store, const NgramIndex &index) const {
+    if (keyword_.empty()) {
+        return RecordList(store, {});
+    }
+    return RecordList(store, index.find(store, keyword_));
+}
+
+RecordList Search::searchByCategory(const RecordStore &store, const CategoryIndex &index) const {
+    std::uint32_t category = 0;
+    const Bitmap *slots = nullptr;
+    if (category_.empty() || !StringPool::categories().find(category_, category) ||
+        (slots = index.category(category)) == nullptr) {
+        return RecordList(store, {});
+    }
+    // Sorting a large match set into ledger order costs more than one pass
+    // over the order comparing the category column.
+    if (slots->cardinality() * 16 > store.size()) {
+        return searchByCategory(store);
+    }
+    std::vector<RecordStore::Slot> out;
+    out.reserve(slots->cardinality());
+    slots->forEach([&out](std::uint32_t slot) { out.push_back(slot); });
+    store.sortByLedgerOrder(out);
+    return RecordList(store, std::move(out));
+}
+
+RecordList Search::searchByCategory(const RecordStore &store) const {
+    std::uint32_t category = 0;
+    if (category_.empty() || !StringPool::categories().find(category_, category)) {
+        return RecordList(store, {});
+    }
+    const auto &categories = store.categories();
+    return collectSlots(store, [&](RecordStore::Slot slot) { return categories[slot] == category; });
+}
+
+RecordList Search::searchByTime(const RecordStore &store) const {
+    if (timeRange_.first.empty() || timeRange_.second.empty()) {
+        return RecordList(store, {});
+    }
+    std::int32_t from = 0;
+    std::int32_t to = 0;
+    const auto &dates = store.dates();
+    if (!packedRange(from, to)) {
+        return collectSlots(store, [&](RecordStore::Slot slot) {
+            return between(Record::decodeDate(dates[slot]), timeRange_.first, timeRange_.second);
+        });
+    }
+    // Malformed dates sort first and are still compared as text; the
+    // well-formed range is one contiguous run of the ledger order.
+    const auto &order = store.order();
+    const std::size_t malformed = store.lowerBound(0);
+    std::vector<RecordStore::Slot> out;
+    for (std::size_t i = 0; i < malformed; ++i) {
+        if (between(Record::decodeDate(dates[order[i]]), timeRange_.first, timeRange_.second)) {
+            out.push_back(order[i]);
         }
     }
-    return out;
+    const std::size_t begin = std::max(malformed, store.lowerBound(from));
+    const std::size_t end = store.lowerBound(to + 1);
+    if (begin < end) {
+        out.insert(out.end(), order.begin() + static_cast<std::ptrdiff_t>(begin),
+                   order.begin() + static_cast<std::ptrdiff_t>(end));
+    }
+    return RecordList(store, std::move(out));
+}
+
+bool Search::matchesTime(std::int32_t date, bool packed, std::int32_t from, std::int32_t to) const {
+    if (packed && date >= 0) {
+        return date >= from && date <= to;
+    }
+    return between(Record::decodeDate(date), timeRange_.first, timeRange_.second);
+}
+
+bool Search::packedRange(std::int32_t &from, std::int32_t &to) const {
+    // Packed dates compare like the text, so well-formed bounds become an integer range.
+    return Date::parsePacked(timeRange_.first, from) && Date::parsePacked(timeRange_.second, to);
 }
 
 bool Search::between(const std::string &date, const std::string &from, const std::string &to) {
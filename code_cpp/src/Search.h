@@ -1,9 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <utility>
 #include <vector>
+#include "CategoryIndex.h"
+#include "NgramIndex.h"
 #include "Record.h"
+#include "RecordSource.h"
+#include "RecordStore.h"
+#include "RecordView.h"
 
 class Search {
 public:
@@ -19,12 +25,38 @@ public:
 
     std::vector<Record> searchByKeyword(const std::vector<Record> &records) const;
     std::vector<Record> searchByCategory(const std::vector<Record> &records) const;
-    std::vector<Record> searchByTime(const std::vector<Record> &records) const;
+    std::vector<Record> searchByTime(const std::vector<Record> &records) const; // RecordOrder::Unsorted
+    std::vector<Record> searchByTime(const std::vector<Record> &records, RecordOrder order) const;
+
+    // Streaming forms: each match is passed to onMatch as it is found, so the
+    // source never has to be resident. Returning false from onMatch stops the scan.
+    void searchByKeyword(const RecordSource &source, const RecordVisitor &onMatch) const;
+    void searchByCategory(const RecordSource &source, const RecordVisitor &onMatch) const;
+    void searchByTime(const RecordSource &source, const RecordVisitor &onMatch) const;
+    // Column scans over a RecordStore. The result holds only the matching
+    // slots, in ledger order; rows are read through it without copying.
+    // searchByTime binary-searches the ledger order instead of scanning.
+    RecordList searchByKeyword(const RecordStore &store) const;
+    RecordList searchByCategory(const RecordStore &store) const;
+    RecordList searchByTime(const RecordStore &store) const;
+    // Lazy forms of the column scans: rows are tested only as the cursor is
+    // read, so a limited page (e.g. the newest 20 matches) stops early.
+    RecordCursor cursorByKeyword(const RecordStore &store, RecordCursor::Page page) const;
+    RecordCursor cursorByCategory(const RecordStore &store, RecordCursor::Page page) const;
+    RecordCursor cursorByTime(const RecordStore &store, RecordCursor::Page page) const;
+    // Same results as the scans above, answered from indexes kept in sync with `store`.
+    RecordList searchByKeyword(const RecordStore &store, const NgramIndex &index) const;
+    RecordList searchByCategory(const RecordStore &store, const CategoryIndex &index) const;
+    // Text comparison of a date with the range bounds; an empty bound is open.
+    static bool between(const std::string &date, const std::string &from, const std::string &to);
     void processSearchResults(const std::vector<Record> &records);
     void processRecordArray(const std::vector<Record> &records);
 
 private:
-    static bool between(const std::string &date, const std::string &from, const std::string &to);
+    // `packed` says whether from/to came from packedRange().
+    bool matchesTime(std::int32_t date, bool packed, std::int32_t from, std::int32_t to) const;
+    // Packed bounds of the time range; false if either bound is not YYYY-MM-DD.
+    bool packedRange(std::int32_t &from, std::int32_t &to) const;
 
     std::string keyword_;
     std::string category_;
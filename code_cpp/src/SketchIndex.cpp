@@ -0,0 +1,40 @@
+#include "SketchIndex.h"
+
+void SketchIndex::add(const Record &record) {
+    const std::uint64_t bucket = (std::uint64_t {record.getCategoryId()} << 1) |
+                                 (record.getType() == Record::Type::Income ? 1u : 0u);
+    const std::int32_t month = monthOf(record.getDateValue());
+    // A stale month is rebuilt from the ledger, which already has this record.
+    if (stale_.count(month) == 0) {
+        months_[month][bucket].add(record.getCents());
+    }
+}
+
+void SketchIndex::add(const std::vector<Record> &records) {
+    for (const auto &record : records) {
+        add(record);
+    }
+}
+
+void SketchIndex::remove(const Record &record) {
+    const std::int32_t month = monthOf(record.getDateValue());
+    months_.erase(month);
+    stale_.insert(month);
+}
+
+void SketchIndex::clear() {
+    months_.clear();
+    stale_.clear();
+}
+
+const std::set<std::int32_t> &SketchIndex::stale() const { return stale_; }
+
+void SketchIndex::rebuild(std::int32_t month, const std::vector<Record> &records) {
+    stale_.erase(month);
+    months_.erase(month);
+    for (const auto &record : records) {
+        add(record);
+    }
+}
+
+std::int32_t SketchIndex::monthOf(std::int32_t date) { return date < 0 ? date : date / 100; }
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "QuantileSketch.h"
+#include "Record.h"
+
+// A QuantileSketch of the amounts per (month, category, type), so that the
+// distribution over any set of months merges a few sketches instead of
+// sorting the amounts. Sketches cannot forget an item: remove() drops the
+// whole month and marks it stale, and the owner hands that month's records
+// back to rebuild() before the next query. Malformed dates are bucketed by
+// their date value (< 0) in place of a month.
+class SketchIndex {
+public:
+    void add(const Record &record);
+    void add(const std::vector<Record> &records);
+    void remove(const Record &record);
+    void clear();
+
+    // Months (YYYYMM, or malformed date values) dropped by remove().
+    const std::set<std::int32_t> &stale() const;
+    // Replaces the buckets of `month` with every record of that month.
+    void rebuild(std::int32_t month, const std::vector<Record> &records);
+
+    // visit(category, income, sketch) for each bucket of the month.
+    template <typename Visit>
+    void forEachInMonth(std::int32_t month, Visit &&visit) const {
+        const auto it = months_.find(month);
+        if (it == months_.end()) {
+            return;
+        }
+        for (const auto &entry : it->second) {
+            visit(static_cast<std::uint32_t>(entry.first >> 1), (entry.first & 1) != 0, entry.second);
+        }
+    }
+    // visit(month, category, income, sketch) for every bucket.
+    template <typename Visit>
+    void forEachMonth(Visit &&visit) const {
+        for (const auto &month : months_) {
+            for (const auto &entry : month.second) {
+                visit(month.first, static_cast<std::uint32_t>(entry.first >> 1), (entry.first & 1) != 0,
+                      entry.second);
+            }
+        }
+    }
+
+    static std::int32_t monthOf(std::int32_t date);
+
+private:
+    // Keyed by (category << 1) | income, as in RollupCube.
+    using Buckets = std::unordered_map<std::uint64_t, QuantileSketch>;
+
+    std::unordered_map<std::int32_t, Buckets> months_;
+    std::set<std::int32_t> stale_;
+};
@@ -1,10 +1,15 @@
 #include "Statistics.h"
 #include <algorithm>
+#include <cmath>
 #include <iomanip>
 #include <iostream>
 #include <map>
 #include <utility>
 #include <cstring>
+#include <unordered_map>
+#include "Date.h"
+#include "StringPool.h"
+#include "ThreadPool.h"
 
 Statistics::Statistics(std::string period, Mode mode)
     : period_(std::move(period)), mode_(mode) {}
@@ -16,30 +21,177 @@ const std::string& Statistics::getPeriod() const { return period_; }
 Statistics::Mode Statistics::getMode() const { return mode_; }
 
 Statistics::TimeSummary Statistics::generateByTime(const std::vector<Record> &records) const {
-    TimeSummary summary;
-    summary.period = period_;
-    for (const auto &record : records) {
-        if (!period_.empty() && record.getDate().rfind(period_, 0) != 0) {
-            continue;
+    return generateByTime(records, RecordOrder::Unsorted);
+}
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const std::vector<Record> &records) const {
+    return generateByCategory(records, RecordOrder::Unsorted);
+}
+
+Statistics::PeriodFilter::PeriodFilter(const std::string &period) : period(period), first(0), last(0), packed(false) {
+    // "YYYY", "YYYY-MM" and "YYYY-MM-DD" are ranges of packed YYYYMMDD values.
+    std::int32_t date = 0;
+    if (period.size() == 4 && Date::parsePacked(period + "-01-01", date)) {
+        first = date;
+        last = date - 101 + 1231;
+        packed = true;
+    } else if (period.size() == 7 && Date::parsePacked(period + "-01", date)) {
+        first = date;
+        last = date + 30;
+        packed = true;
+    } else if (Date::parsePacked(period, date)) {
+        first = date;
+        last = date;
+        packed = true;
+    }
+}
+
+bool Statistics::PeriodFilter::contains(std::int32_t date) const {
+    if (period.empty()) {
+        return true;
+    }
+    if (packed && date >= 0) {
+        return date >= first && date <= last;
+    }
+    return Record::decodeDate(date).rfind(period, 0) == 0;
+}
+
+bool Statistics::PeriodFilter::wholeMonths() const {
+    return period.empty() || (packed && first != last) || (!packed && period.size() <= 7);
+}
+
+bool Statistics::PeriodFilter::containsMonth(std::int32_t month) const {
+    if (month < 0) {
+        return contains(month);
+    }
+    if (period.empty()) {
+        return true;
+    }
+    if (packed) {
+        return month >= first / 100 && month <= last / 100;
+    }
+    // A prefix no longer than "YYYY-MM" matches every day of the month or none.
+    return period.size() <= 7 && Date::formatPacked(month * 100 + 1).rfind(period, 0) == 0;
+}
+
+namespace {
+
+constexpr std::size_t kChunkRows = 16384;
+
+// Runs visit(acc, i) over [0, count) in fixed chunks and appends one Acc per chunk.
+template <typename Acc, typename Visit>
+void reduceChunks(std::size_t count, Visit &&visit, std::vector<Acc> &parts) {
+    const std::size_t offset = parts.size();
+    parts.resize(offset + ThreadPool::chunkCount(count, kChunkRows));
+    ThreadPool::shared().parallelFor(count, kChunkRows, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        Acc &acc = parts[offset + chunk];
+        for (std::size_t i = begin; i < end; ++i) {
+            visit(acc, i);
         }
-        if (record.getType() == Record::Type::Income) {
-            summary.income += record.getAmount();
-        } else {
-            summary.expense += record.getAmount();
+    });
+}
+
+struct TimeTotals {
+    std::int64_t cents[2] = {0, 0}; // expense, income
+    std::size_t count = 0;
+};
+
+using CategoryTotals = std::unordered_map<std::uint32_t, std::int64_t>;
+
+} // namespace
+
+template <typename Acc, typename Visit>
+std::vector<Acc> Statistics::PeriodFilter::reduce(const RecordStore &store, Visit &&visit) const {
+    const auto &dates = store.dates();
+    std::vector<Acc> parts;
+    if (!packed || period.empty()) {
+        const auto &live = store.live();
+        reduceChunks<Acc>(dates.size(), [&](Acc &acc, std::size_t i) {
+            if (live[i] && contains(dates[i])) {
+                visit(acc, static_cast<RecordStore::Slot>(i));
+            }
+        }, parts);
+        return parts;
+    }
+    const auto &order = store.order();
+    const std::size_t malformed = store.lowerBound(0);
+    const std::size_t begin = std::max(malformed, store.lowerBound(first));
+    const std::size_t end = std::max(begin, store.lowerBound(last + 1));
+    reduceChunks<Acc>(malformed, [&](Acc &acc, std::size_t i) {
+        if (contains(dates[order[i]])) {
+            visit(acc, order[i]);
         }
-        summary.count++;
+    }, parts);
+    reduceChunks<Acc>(end - begin, [&](Acc &acc, std::size_t i) { visit(acc, order[begin + i]); }, parts);
+    return parts;
+}
+
+template <typename Acc, typename Visit>
+std::vector<Acc> Statistics::PeriodFilter::reduce(const std::vector<Record> &records, RecordOrder order,
+                                                   Visit &&visit) const {
+    const auto slices = order == RecordOrder::Sorted && packed && !period.empty()
+                            ? dateRangeSlices(records, first, last)
+                            : std::vector<std::pair<std::size_t, std::size_t>> {{0, records.size()}};
+    std::vector<Acc> parts;
+    for (const auto &slice : slices) {
+        reduceChunks<Acc>(slice.second - slice.first, [&](Acc &acc, std::size_t i) {
+            const Record &record = records[slice.first + i];
+            if (contains(record.getDateValue())) {
+                visit(acc, record);
+            }
+        }, parts);
     }
-    summary.balance = summary.income - summary.expense;
+    return parts;
+}
+
+template <typename Visit>
+void Statistics::PeriodFilter::forEachCell(const RollupCube &cube, Visit &&visit) const {
+    // Malformed dates only ever match as text.
+    cube.forEachMalformed([&](std::int32_t date, std::uint32_t category, bool income, const RollupCube::Cell &cell) {
+        if (contains(date)) {
+            visit(category, income, cell);
+        }
+    });
+    if (period.empty()) {
+        cube.forEachMonth([&](std::int32_t, std::uint32_t category, bool income, const RollupCube::Cell &cell) {
+            visit(category, income, cell);
+        });
+    } else if (!packed) {
+        cube.forEachDay([&](std::int32_t date, std::uint32_t category, bool income, const RollupCube::Cell &cell) {
+            if (contains(date)) {
+                visit(category, income, cell);
+            }
+        });
+    } else if (first == last) {
+        cube.forEachInDay(first, visit);
+    } else {
+        // A month, or the twelve months of a year.
+        for (std::int32_t month = first / 100; month <= last / 100; ++month) {
+            cube.forEachInMonth(month, visit);
+        }
+    }
+}
+
+namespace {
+
+// Sums are kept in cents so the totals are exact.
+Statistics::TimeSummary makeTimeSummary(const std::string &period, std::int64_t income, std::int64_t expense,
+                                        std::size_t count) {
+    Statistics::TimeSummary summary;
+    summary.period = period;
+    summary.income = static_cast<double>(income) / 100.0;
+    summary.expense = static_cast<double>(expense) / 100.0;
+    summary.balance = static_cast<double>(income - expense) / 100.0;
+    summary.count = count;
     return summary;
 }
 
-std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const std::vector<Record> &records) const {
+std::vector<Statistics::CategorySummaryItem> makeCategoryItems(
+    const std::unordered_map<std::uint32_t, std::int64_t> &centsByCategory) {
+    // Name order keeps ties in the sort below deterministic.
     std::map<std::string, double> totals;
-    for (const auto &record : records) {
-        if (!period_.empty() && record.getDate().rfind(period_, 0) != 0) {
-            continue;
-        }
-        totals[record.getCategory()] += record.getAmount();
+    for (const auto &entry : centsByCategory) {
+        totals[StringPool::categories().get(entry.first)] = static_cast<double>(entry.second) / 100.0;
     }
 
     double grandTotal = 0.0;
@@ -47,22 +199,299 @@ std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(cons
         grandTotal += entry.second;
     }
 
-    std::vector<CategorySummaryItem> items;
+    std::vector<Statistics::CategorySummaryItem> items;
     items.reserve(totals.size());
     for (const auto &entry : totals) {
-        CategorySummaryItem item;
+        Statistics::CategorySummaryItem item;
         item.category = entry.first;
         item.amount = entry.second;
         item.percentage = grandTotal > 0.0 ? (entry.second / grandTotal) * 100.0 : 0.0;
         items.push_back(item);
     }
 
-    std::sort(items.begin(), items.end(), [](const CategorySummaryItem &a, const CategorySummaryItem &b) {
+    std::sort(items.begin(), items.end(), [](const Statistics::CategorySummaryItem &a,
+                                             const Statistics::CategorySummaryItem &b) {
         return a.amount > b.amount;
     });
     return items;
 }
 
+// Amounts in cents; selects the quantiles in place.
+Statistics::Distribution makeDistribution(const std::string &period, const std::string &category,
+                                          std::vector<std::int64_t> &amounts) {
+    Statistics::Distribution distribution;
+    distribution.period = period;
+    distribution.category = category;
+    distribution.count = amounts.size();
+    if (amounts.empty()) {
+        return distribution;
+    }
+    std::int64_t sum = 0;
+    for (const auto cents : amounts) {
+        sum += cents;
+    }
+    auto select = [&](double q) {
+        // Smallest value with at least q * n values at or below it, as QuantileSketch::quantile().
+        const double rank = std::ceil(q * static_cast<double>(amounts.size()));
+        const std::size_t index = rank < 1.0 ? 0 : std::min(amounts.size() - 1, static_cast<std::size_t>(rank) - 1);
+        std::nth_element(amounts.begin(), amounts.begin() + static_cast<std::ptrdiff_t>(index), amounts.end());
+        return static_cast<double>(amounts[index]) / 100.0;
+    };
+    distribution.mean = static_cast<double>(sum) / static_cast<double>(amounts.size()) / 100.0;
+    distribution.median = select(0.5);
+    distribution.p90 = select(0.9);
+    distribution.p99 = select(0.99);
+    distribution.max = static_cast<double>(*std::max_element(amounts.begin(), amounts.end())) / 100.0;
+    return distribution;
+}
+
+// Chunk partials merged in chunk order.
+Statistics::TimeSummary mergeTimeTotals(const std::string &period, const std::vector<TimeTotals> &parts) {
+    TimeTotals total;
+    for (const auto &part : parts) {
+        total.cents[0] += part.cents[0];
+        total.cents[1] += part.cents[1];
+        total.count += part.count;
+    }
+    return makeTimeSummary(period, total.cents[1], total.cents[0], total.count);
+}
+
+// A chunk's table plus the time fields of the last date seen: ledger order
+// keeps the records of one day together.
+struct GroupTotals {
+    GroupBy::Table table;
+    std::int32_t date = 0; // no record has date value 0, and timeKey(0) is 0
+    std::uint64_t time = 0;
+};
+
+void addToGroup(const GroupBy &groups, GroupTotals &acc, std::int32_t date, std::uint32_t category, bool income,
+                std::int64_t cents) {
+    if (date != acc.date) {
+        acc.date = date;
+        acc.time = groups.timeKey(date);
+    }
+    GroupBy::add(acc.table, groups.key(acc.time, category, income), income, cents);
+}
+
+GroupBy::Table mergeGroupTotals(std::vector<GroupTotals> &parts) {
+    if (parts.empty()) {
+        return GroupBy::Table();
+    }
+    for (std::size_t i = 1; i < parts.size(); ++i) {
+        parts[0].table.merge(parts[i].table);
+    }
+    return std::move(parts[0].table);
+}
+
+std::vector<Statistics::CategorySummaryItem> mergeCategoryTotals(const std::vector<CategoryTotals> &parts) {
+    CategoryTotals total;
+    for (const auto &part : parts) {
+        for (const auto &entry : part) {
+            total[entry.first] += entry.second;
+        }
+    }
+    return makeCategoryItems(total);
+}
+
+} // namespace
+
+Statistics::TimeSummary Statistics::generateByTime(const std::vector<Record> &records, RecordOrder order) const {
+    return mergeTimeTotals(period_, PeriodFilter(period_).reduce<TimeTotals>(records, order,
+        [](TimeTotals &acc, const Record &record) {
+            acc.cents[record.getType() == Record::Type::Income ? 1 : 0] += record.getCents();
+            ++acc.count;
+        }));
+}
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const std::vector<Record> &records,
+                                                                            RecordOrder order) const {
+    return mergeCategoryTotals(PeriodFilter(period_).reduce<CategoryTotals>(records, order,
+        [](CategoryTotals &acc, const Record &record) { acc[record.getCategoryId()] += record.getCents(); }));
+}
+
+Statistics::TimeSummary Statistics::generateByTime(const RecordSource &source) const {
+    std::int64_t income = 0;
+    std::int64_t expense = 0;
+    std::size_t count = 0;
+    const PeriodFilter inPeriod(period_);
+    source([&](const Record &record) {
+        if (!inPeriod.contains(record.getDateValue())) {
+            return true;
+        }
+        if (record.getType() == Record::Type::Income) {
+            income += record.getCents();
+        } else {
+            expense += record.getCents();
+        }
+        count++;
+        return true;
+    });
+    return makeTimeSummary(period_, income, expense, count);
+}
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const RecordSource &source) const {
+    std::unordered_map<std::uint32_t, std::int64_t> byId;
+    const PeriodFilter inPeriod(period_);
+    source([&](const Record &record) {
+        if (inPeriod.contains(record.getDateValue())) {
+            byId[record.getCategoryId()] += record.getCents();
+        }
+        return true;
+    });
+    return makeCategoryItems(byId);
+}
+
+Statistics::TimeSummary Statistics::generateByTime(const RecordStore &store) const {
+    const auto &cents = store.cents();
+    const auto &incomes = store.incomes();
+    return mergeTimeTotals(period_, PeriodFilter(period_).reduce<TimeTotals>(store,
+        [&](TimeTotals &acc, RecordStore::Slot slot) {
+            acc.cents[incomes[slot]] += cents[slot];
+            ++acc.count;
+        }));
+}
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const RecordStore &store) const {
+    const auto &cents = store.cents();
+    const auto &categories = store.categories();
+    return mergeCategoryTotals(PeriodFilter(period_).reduce<CategoryTotals>(store,
+        [&](CategoryTotals &acc, RecordStore::Slot slot) { acc[categories[slot]] += cents[slot]; }));
+}
+
+GroupBy::Table Statistics::groupBy(const RecordStore &store, const GroupBy &groups) const {
+    const auto &dates = store.dates();
+    const auto &cents = store.cents();
+    const auto &incomes = store.incomes();
+    const auto &categories = store.categories();
+    // Without a time dimension the date column is not read at all.
+    const bool timed = groups.hasTime();
+    auto parts = PeriodFilter(period_).reduce<GroupTotals>(store, [&](GroupTotals &acc, RecordStore::Slot slot) {
+        addToGroup(groups, acc, timed ? dates[slot] : 0, categories[slot], incomes[slot] != 0, cents[slot]);
+    });
+    return mergeGroupTotals(parts);
+}
+
+GroupBy::Table Statistics::groupBy(const std::vector<Record> &records, RecordOrder order,
+                                   const GroupBy &groups) const {
+    auto parts = PeriodFilter(period_).reduce<GroupTotals>(records, order, [&](GroupTotals &acc, const Record &record) {
+        addToGroup(groups, acc, record.getDateValue(), record.getCategoryId(),
+                   record.getType() == Record::Type::Income, record.getCents());
+    });
+    return mergeGroupTotals(parts);
+}
+
+Statistics::Distribution Statistics::generateDistribution(const RecordStore &store, const std::string &category,
+                                                          Record::Type type) const {
+    std::vector<std::int64_t> amounts;
+    std::uint32_t id = 0;
+    const bool anyCategory = category.empty();
+    if (!anyCategory && !StringPool::categories().find(category, id)) {
+        return makeDistribution(period_, category, amounts);
+    }
+    const std::uint8_t income = type == Record::Type::Income ? 1 : 0;
+    const auto &cents = store.cents();
+    const auto &incomes = store.incomes();
+    const auto &categories = store.categories();
+    const auto parts = PeriodFilter(period_).reduce<std::vector<std::int64_t>>(store,
+        [&](std::vector<std::int64_t> &acc, RecordStore::Slot slot) {
+            if (incomes[slot] == income && (anyCategory || categories[slot] == id)) {
+                acc.push_back(cents[slot]);
+            }
+        });
+    for (const auto &part : parts) {
+        amounts.insert(amounts.end(), part.begin(), part.end());
+    }
+    return makeDistribution(period_, category, amounts);
+}
+
+Statistics::Distribution Statistics::generateDistribution(const SketchIndex &index, const std::string &category,
+                                                          Record::Type type) const {
+    Distribution distribution;
+    distribution.period = period_;
+    distribution.category = category;
+    std::uint32_t id = 0;
+    const bool anyCategory = category.empty();
+    if (!anyCategory && !StringPool::categories().find(category, id)) {
+        return distribution;
+    }
+    const bool income = type == Record::Type::Income;
+    const PeriodFilter inPeriod(period_);
+    QuantileSketch merged;
+    index.forEachMonth([&](std::int32_t month, std::uint32_t bucketCategory, bool bucketIncome,
+                           const QuantileSketch &sketch) {
+        if (bucketIncome == income && (anyCategory || bucketCategory == id) && inPeriod.containsMonth(month)) {
+            merged.merge(sketch);
+        }
+    });
+    if (merged.empty()) {
+        return distribution;
+    }
+    distribution.count = static_cast<std::size_t>(merged.count());
+    distribution.mean = static_cast<double>(merged.sum()) / static_cast<double>(merged.count()) / 100.0;
+    distribution.median = static_cast<double>(merged.quantile(0.5)) / 100.0;
+    distribution.p90 = static_cast<double>(merged.quantile(0.9)) / 100.0;
+    distribution.p99 = static_cast<double>(merged.quantile(0.99)) / 100.0;
+    distribution.max = static_cast<double>(merged.max()) / 100.0;
+    return distribution;
+}
+
+bool Statistics::coversWholeMonths() const { return PeriodFilter(period_).wholeMonths(); }
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const RecordStore &store,
+                                                                            const CategoryIndex &index) const {
+    const PeriodFilter inPeriod(period_);
+    Bitmap period;
+    if (!period_.empty()) {
+        if (!inPeriod.packed || !index.monthRange(inPeriod.first, inPeriod.last, period)) {
+            return generateByCategory(store);
+        }
+        // Malformed dates can still match the period as text.
+        const auto &dates = store.dates();
+        index.malformedDates().forEach([&](std::uint32_t slot) {
+            if (inPeriod.contains(dates[slot])) {
+                period.add(slot);
+            }
+        });
+        // A short period is already one small slice of the ledger order.
+        if (period.cardinality() * 8 < store.size()) {
+            return generateByCategory(store);
+        }
+    }
+    const auto &cents = store.cents();
+    std::unordered_map<std::uint32_t, std::int64_t> byId;
+    for (const auto &entry : index.categories()) {
+        std::int64_t total = 0;
+        const auto sum = [&](std::uint32_t slot) { total += cents[slot]; };
+        if (period_.empty()) {
+            entry.second.forEach(sum);
+        } else if (entry.second.andCardinality(period) != 0) {
+            (entry.second & period).forEach(sum);
+        } else {
+            continue;
+        }
+        byId[entry.first] = total;
+    }
+    return makeCategoryItems(byId);
+}
+
+Statistics::TimeSummary Statistics::generateByTime(const RollupCube &cube) const {
+    std::int64_t totals[2] = {0, 0}; // expense, income
+    std::size_t count = 0;
+    PeriodFilter(period_).forEachCell(cube, [&](std::uint32_t, bool income, const RollupCube::Cell &cell) {
+        totals[income ? 1 : 0] += cell.cents;
+        count += cell.count;
+    });
+    return makeTimeSummary(period_, totals[1], totals[0], count);
+}
+
+std::vector<Statistics::CategorySummaryItem> Statistics::generateByCategory(const RollupCube &cube) const {
+    CategoryTotals byId;
+    PeriodFilter(period_).forEachCell(cube, [&](std::uint32_t category, bool, const RollupCube::Cell &cell) {
+        byId[category] += cell.cents;
+    });
+    return makeCategoryItems(byId);
+}
+
 void Statistics::showChart(const std::vector<CategorySummaryItem> &items) const {
     if (items.empty()) {
         std::cout << "[暂无分类数据用于绘制图表]\n";
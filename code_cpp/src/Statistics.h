@@ -1,8 +1,15 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
+#include "CategoryIndex.h"
+#include "GroupBy.h"
 #include "Record.h"
+#include "RecordSource.h"
+#include "RecordStore.h"
+#include "RollupCube.h"
+#include "SketchIndex.h"
 
 class Statistics {
 public:
@@ -16,6 +23,19 @@ public:
         std::size_t count {0};
     };
 
+    // Amounts of one type, in yuan. Quantiles are the smallest amount with at
+    // least that share of the records at or below it.
+    struct Distribution {
+        std::string period;
+        std::string category; // empty for every category
+        std::size_t count {0};
+        double mean {0.0};
+        double median {0.0};
+        double p90 {0.0};
+        double p99 {0.0};
+        double max {0.0};
+    };
+
     struct CategorySummaryItem {
         std::string category;
         double amount {0.0};
@@ -30,8 +50,46 @@ public:
     const std::string& getPeriod() const;
     Mode getMode() const;
 
-    TimeSummary generateByTime(const std::vector<Record> &records) const;
+    TimeSummary generateByTime(const std::vector<Record> &records) const; // RecordOrder::Unsorted
     std::vector<CategorySummaryItem> generateByCategory(const std::vector<Record> &records) const;
+    // Sorted input is narrowed to the period by binary search first.
+    TimeSummary generateByTime(const std::vector<Record> &records, RecordOrder order) const;
+    std::vector<CategorySummaryItem> generateByCategory(const std::vector<Record> &records, RecordOrder order) const;
+    // Single pass over a stream; memory stays bounded by the number of categories.
+    TimeSummary generateByTime(const RecordSource &source) const;
+    std::vector<CategorySummaryItem> generateByCategory(const RecordSource &source) const;
+    // Column reads: only the date, amount, type and category columns are
+    // touched, and a well-formed period is located in the ledger order by
+    // binary search.
+    //
+    // The vector and store overloads split the scan into fixed chunks on
+    // ThreadPool::shared(). Totals are summed as integer cents, so merging
+    // the chunk partials gives bit-identical results at any thread count.
+    TimeSummary generateByTime(const RecordStore &store) const;
+    std::vector<CategorySummaryItem> generateByCategory(const RecordStore &store) const;
+    // Per-category totals as bitmap intersections with the period. Periods
+    // that are not whole months or years, or that cover only a small part of
+    // the ledger, use the overload above instead.
+    std::vector<CategorySummaryItem> generateByCategory(const RecordStore &store, const CategoryIndex &index) const;
+    // Answered from rollup cells without reading records: whole days, months
+    // and years are direct lookups, other text periods scan the day cells.
+    // The cube must hold every record of the period.
+    TimeSummary generateByTime(const RollupCube &cube) const;
+    std::vector<CategorySummaryItem> generateByCategory(const RollupCube &cube) const;
+
+    // Every combination of the dimensions of `groups` in one pass over the
+    // period, e.g. twelve months by category for a year's trend.
+    GroupBy::Table groupBy(const RecordStore &store, const GroupBy &groups) const;
+    GroupBy::Table groupBy(const std::vector<Record> &records, RecordOrder order, const GroupBy &groups) const;
+
+    // Exact: the period's amounts are collected and selected, O(n).
+    Distribution generateDistribution(const RecordStore &store, const std::string &category, Record::Type type) const;
+    // Merged from per-month sketches, ranks within about 1.5%; requires
+    // coversWholeMonths(). The mean, count and max are exact.
+    Distribution generateDistribution(const SketchIndex &index, const std::string &category, Record::Type type) const;
+    // Whether the period is a union of whole months: empty, a year, a month,
+    // or a text prefix no longer than "YYYY-MM".
+    bool coversWholeMonths() const;
 
     void showChart(const std::vector<CategorySummaryItem> &items) const;
     void showSummary(const TimeSummary &summary) const;
@@ -40,6 +98,31 @@ public:
     double calculatePercentage(double value, double total);
 
 private:
+    // Matches records whose date starts with the period; well-formed periods
+    // are checked as an integer range over packed dates.
+    struct PeriodFilter {
+        explicit PeriodFilter(const std::string &period);
+        bool contains(std::int32_t date) const; // packed date column value
+        bool wholeMonths() const;
+        bool containsMonth(std::int32_t month) const; // YYYYMM, or a malformed date value
+        // One Acc per chunk, in chunk order, after visit(acc, slot) for each
+        // live slot of the store in the period.
+        template <typename Acc, typename Visit>
+        std::vector<Acc> reduce(const RecordStore &store, Visit &&visit) const;
+        // The same over visit(acc, record) for a record vector; Sorted input
+        // is narrowed to the period first.
+        template <typename Acc, typename Visit>
+        std::vector<Acc> reduce(const std::vector<Record> &records, RecordOrder order, Visit &&visit) const;
+        // visit(category, income, cell) for each rollup cell in the period.
+        template <typename Visit>
+        void forEachCell(const RollupCube &cube, Visit &&visit) const;
+
+        const std::string &period;
+        std::int32_t first;
+        std::int32_t last;
+        bool packed;
+    };
+
     std::string period_;
     Mode mode_;
 };
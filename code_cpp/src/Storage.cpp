@@ -1,11 +1,239 @@
 #include "Storage.h"
+#include <algorithm>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include <sstream>
 #include <cstring>
+#include "BinaryLedger.h"
+#include "Date.h"
+#include "FileSync.h"
+#include "MappedFile.h"
+#include "RecordStore.h"
+#include "StringPool.h"
+#include "TsvParser.h"
 
-Storage::Storage(const std::string &dir) : dir_(dir) {}
+namespace {
+
+// Journal frame: [u32 payload length][u32 CRC-32 of payload][payload], little endian.
+// Payload is an op byte followed by the record in TSV form.
+constexpr std::uint32_t kMaxJournalPayload = 1u << 24;
+
+std::uint32_t crc32(const char *data, std::size_t size) {
+    static const auto table = [] {
+        std::vector<std::uint32_t> t(256);
+        for (std::uint32_t i = 0; i < 256; ++i) {
+            std::uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1u) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+    std::uint32_t crc = 0xFFFFFFFFu;
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFFu] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+void putU32(std::string &out, std::uint32_t v) {
+    for (int i = 0; i < 4; ++i) {
+        out.push_back(static_cast<char>((v >> (8 * i)) & 0xFFu));
+    }
+}
+
+std::uint32_t getU32(const char *p) {
+    std::uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) {
+        v |= static_cast<std::uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    }
+    return v;
+}
+
+std::map<std::string, std::vector<Record>> groupBySegment(const std::vector<Record> &records) {
+    std::map<std::string, std::vector<Record>> groups;
+    for (const auto &r : records) {
+        groups[Storage::segmentOf(r)].push_back(r);
+    }
+    return groups;
+}
+
+std::map<std::string, std::vector<Storage::JournalEntry>> groupBySegment(
+    const std::vector<Storage::JournalEntry> &entries) {
+    std::map<std::string, std::vector<Storage::JournalEntry>> groups;
+    for (const auto &entry : entries) {
+        groups[Storage::segmentOf(entry.record)].push_back(entry);
+    }
+    return groups;
+}
+
+using JournalOp = Storage::JournalEntry::Op;
+
+void putFrame(std::string &frames, JournalOp op, const Record &record) {
+    std::string payload(1, static_cast<char>(op));
+    payload += record.toTSV();
+    putU32(frames, static_cast<std::uint32_t>(payload.size()));
+    putU32(frames, crc32(payload.data(), payload.size()));
+    frames += payload;
+}
+
+enum class FrameRead { Ok, End, Corrupt, Torn };
+
+// Reads the next journal frame's payload, checking its length and CRC.
+FrameRead readFrame(std::ifstream &ifs, std::string &payload) {
+    char header[8];
+    if (!ifs.read(header, sizeof(header))) {
+        return ifs.gcount() == 0 ? FrameRead::End : FrameRead::Torn;
+    }
+    const auto length = getU32(header);
+    if (length == 0 || length > kMaxJournalPayload) {
+        return FrameRead::Corrupt;
+    }
+    payload.resize(length);
+    if (!ifs.read(&payload[0], length) || crc32(payload.data(), payload.size()) != getU32(header + 4)) {
+        return FrameRead::Torn;
+    }
+    return FrameRead::Ok;
+}
+
+bool isJournalOp(char op) {
+    return op == static_cast<char>(JournalOp::Append) || op == static_cast<char>(JournalOp::Update) ||
+           op == static_cast<char>(JournalOp::Delete);
+}
+
+// Applies the journal on top of a stream of base records.
+//  - Appends already in the base, left behind by a crash between rewriting the
+//    base file and removing the journal, are not replayed twice.
+//  - The last Update or Delete of an id supersedes every earlier version of
+//    that id, in the base and in the journal. An Update takes the place of
+//    the first version it supersedes; replaying it twice is harmless.
+class JournalReplay {
+public:
+    explicit JournalReplay(std::vector<Storage::JournalEntry> entries)
+        : entries_(std::move(entries)), done_(entries_.size(), false) {
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            const auto id = entries_[i].record.getIdValue();
+            if (entries_[i].op == JournalOp::Append) {
+                appends_.emplace(id, i);
+                continue;
+            }
+            auto range = appends_.equal_range(id);
+            for (auto it = range.first; it != range.second; ++it) {
+                done_[it->second] = true;
+            }
+            appends_.erase(range.first, range.second);
+            auto found = overrides_.find(id);
+            if (found != overrides_.end()) {
+                done_[found->second] = true;
+                found->second = i;
+            } else {
+                overrides_.emplace(id, i);
+            }
+        }
+    }
+
+    // False when no entry can touch a base record, so callers may skip visitBase.
+    bool amendsBase() const { return !overrides_.empty() || !appends_.empty(); }
+
+    bool visitBase(const Record &record, const RecordVisitor &visit) {
+        if (!overrides_.empty()) {
+            auto found = overrides_.find(record.getIdValue());
+            if (found != overrides_.end()) {
+                const auto i = found->second;
+                if (done_[i] || entries_[i].op == JournalOp::Delete) {
+                    return true;
+                }
+                done_[i] = true;
+                return visit(entries_[i].record);
+            }
+        }
+        if (!appends_.empty()) {
+            auto range = appends_.equal_range(record.getIdValue());
+            for (auto it = range.first; it != range.second; ++it) {
+                if (entries_[it->second].record == record) {
+                    done_[it->second] = true;
+                    appends_.erase(it);
+                    break;
+                }
+            }
+        }
+        return visit(record);
+    }
+
+    // visitBase() for a whole store of base records. The store keeps its own
+    // order, so an Update is inserted instead of taking the superseded place.
+    void amend(RecordStore &store) {
+        for (const auto &entry : overrides_) {
+            const auto i = entry.second;
+            if (!store.erase(entry.first)) {
+                continue; // not in the base: replay() writes it
+            }
+            if (entries_[i].op != JournalOp::Delete) {
+                store.insert(entries_[i].record);
+            }
+            done_[i] = true;
+        }
+        std::unordered_set<RecordStore::Slot> absorbed; // each base copy absorbs one append
+        for (auto it = appends_.begin(); it != appends_.end();) {
+            bool found = false;
+            if (overrides_.count(it->first) == 0) {
+                for (const auto slot : store.copies(it->first)) {
+                    if (absorbed.count(slot) == 0 && store.get(slot) == entries_[it->second].record) {
+                        absorbed.insert(slot);
+                        found = true;
+                        break;
+                    }
+                }
+            }
+            if (found) {
+                done_[it->second] = true;
+                it = appends_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void replay(const RecordVisitor &visit) const {
+        for (std::size_t i = 0; i < entries_.size(); ++i) {
+            if (!done_[i] && entries_[i].op != JournalOp::Delete && !visit(entries_[i].record)) {
+                return;
+            }
+        }
+    }
+
+private:
+    std::vector<Storage::JournalEntry> entries_;
+    std::vector<bool> done_; // absorbed by the base or superseded
+    std::unordered_multimap<std::uint64_t, std::size_t> appends_;
+    std::unordered_map<std::uint64_t, std::size_t> overrides_; // id -> last Update/Delete
+};
+
+} // namespace
+
+Storage::Storage(const std::string &dir)
+    : dir_(dir), format_(Format::Text), layout_(Layout::SingleFile), verifiedJournal_(kUnverifiedJournal) {
+    std::error_code ec;
+    if (std::filesystem::is_directory(segmentsDir(), ec)) {
+        layout_ = Layout::MonthSharded;
+    }
+    // Keep writing whatever format the existing ledger uses.
+    const auto segments = layout_ == Layout::MonthSharded ? listSegments() : std::vector<std::string>();
+    MappedFile existing(segments.empty() ? recordsFile() : segmentFile(segments.back()));
+    if (BinaryLedger::isBinary(existing.data(), existing.size())) {
+        format_ = Format::Binary;
+    }
+}
+
+Storage::Format Storage::getFormat() const { return format_; }
+void Storage::setFormat(Format format) { format_ = format; }
+Storage::Layout Storage::getLayout() const { return layout_; }
+void Storage::setLayout(Layout layout) { layout_ = layout; }
 
 std::string Storage::recordsFile() const {
     std::filesystem::path p(dir_);
@@ -13,6 +241,33 @@ std::string Storage::recordsFile() const {
     return p.string();
 }
 
+std::string Storage::segmentsDir() const {
+    std::filesystem::path p(dir_);
+    p /= "records";
+    return p.string();
+}
+
+std::string Storage::segmentFile(const std::string &segment) const {
+    std::filesystem::path p(segmentsDir());
+    const std::string binaryName = segment + ".bin";
+    const std::string textName = segment + ".tsv";
+    std::error_code ec;
+    // An existing segment keeps its name until it is rewritten in the other format.
+    if (std::filesystem::exists(p / binaryName, ec)) {
+        return (p / binaryName).string();
+    }
+    if (std::filesystem::exists(p / textName, ec)) {
+        return (p / textName).string();
+    }
+    return (p / (format_ == Format::Binary ? binaryName : textName)).string();
+}
+
+std::string Storage::journalFile() const {
+    std::filesystem::path p(dir_);
+    p /= "records.journal";
+    return p.string();
+}
+
 std::string Storage::categoriesFile() const {
     std::filesystem::path p(dir_);
     p /= "categories.txt";
@@ -32,21 +287,288 @@ bool Storage::saveRecords(const std::vector<Record> &records) const {
     if (!ensureDataDir()) {
         return false;
     }
-    std::ofstream ofs(recordsFile(), std::ios::trunc);
+    if (layout_ == Layout::SingleFile) {
+        if (!writeLedgerFile(recordsFile(), records)) {
+            return false;
+        }
+        // Everything in the journal is now part of the base file.
+        return clearJournal();
+    }
+
+    const auto groups = groupBySegment(records);
+    for (const auto &existing : listSegments()) {
+        if (groups.count(existing) == 0) {
+            std::error_code ec;
+            std::filesystem::remove(segmentFile(existing), ec);
+        }
+    }
+    for (const auto &group : groups) {
+        if (!saveSegment(group.first, group.second)) {
+            return false;
+        }
+    }
+    return clearJournal();
+}
+
+std::string Storage::segmentOf(const std::string &date) {
+    std::int32_t day = 0;
+    return Date::parse(date, day) ? date.substr(0, 7) : std::string("undated");
+}
+
+std::string Storage::segmentOf(const Record &record) {
+    const std::int32_t date = record.getDateValue();
+    return date >= 0 ? Date::formatPacked(date).substr(0, 7) : std::string("undated");
+}
+
+std::vector<std::string> Storage::listSegments() const {
+    std::vector<std::string> out;
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(segmentsDir(), ec), end; !ec && it != end; it.increment(ec)) {
+        const auto &path = it->path();
+        if (path.extension() == ".tsv" || path.extension() == ".bin") {
+            out.push_back(path.stem().string());
+        }
+    }
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+std::vector<Record> Storage::loadSegment(const std::string &segment) const {
+    std::vector<Record> out;
+    readLedgerFile(segmentFile(segment), out);
+    return out;
+}
+
+bool Storage::saveSegment(const std::string &segment, const std::vector<Record> &records) const {
+    std::error_code ec;
+    std::filesystem::create_directories(segmentsDir(), ec);
+    const auto path = segmentFile(segment);
+    const auto wanted = std::filesystem::path(segmentsDir()) / (segment + (format_ == Format::Binary ? ".bin" : ".tsv"));
+    if (!writeLedgerFile(wanted.string(), records)) {
+        return false;
+    }
+    if (path != wanted.string()) {
+        std::filesystem::remove(path, ec);
+    }
+    return true;
+}
+
+bool Storage::exportRecordsTSV(const std::string &path, const std::vector<Record> &records) const {
+    return writeTSV(path, records);
+}
+
+std::vector<Record> Storage::importRecordsTSV(const std::string &path) const {
+    std::vector<Record> out;
+    readLedgerFile(path, out);
+    return out;
+}
+
+bool Storage::writeLedgerFile(const std::string &path, const std::vector<Record> &records) const {
+    // Written next to the target and renamed over it, so a crash mid-write
+    // leaves the previous ledger intact.
+    const auto tmp = FileSync::tempPathFor(path);
+    const bool ok = format_ == Format::Binary ? BinaryLedger::write(tmp, records) : writeTSV(tmp, records);
+    if (!ok || !FileSync::replaceFile(tmp, path)) {
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return false;
+    }
+    return true;
+}
+
+bool Storage::writeTSV(const std::string &path, const std::vector<Record> &records) {
+    std::ofstream ofs(path, std::ios::trunc);
     if (!ofs) {
         return false;
     }
     for (const auto &r : records) {
         ofs << r.toTSV() << '\n';
     }
+    ofs.close();
+    return static_cast<bool>(ofs);
+}
+
+bool Storage::appendRecord(const Record &record) const {
+    return appendRecords({record});
+}
+
+bool Storage::appendRecords(const std::vector<Record> &records) const {
+    std::vector<JournalEntry> entries;
+    entries.reserve(records.size());
+    for (const auto &record : records) {
+        entries.push_back({JournalEntry::Op::Append, record});
+    }
+    return appendJournal(entries);
+}
+
+bool Storage::appendJournal(const std::vector<JournalEntry> &entries) const {
+    if (entries.empty()) {
+        return true;
+    }
+    if (!ensureDataDir()) {
+        return false;
+    }
+    std::string frames;
+    for (const auto &entry : entries) {
+        putFrame(frames, entry.op, entry.record);
+    }
+
+    // The journal may have been torn since it was last read or written.
+    const std::uintmax_t size = journalSize();
+    if (size != verifiedJournal_ && !repairJournal()) {
+        return false;
+    }
+    std::ofstream ofs(journalFile(), std::ios::binary | std::ios::app);
+    if (!ofs) {
+        return false;
+    }
+    ofs.write(frames.data(), static_cast<std::streamsize>(frames.size()));
+    ofs.flush();
+    if (!ofs) {
+        verifiedJournal_ = kUnverifiedJournal;
+        return false;
+    }
+    verifiedJournal_ += frames.size();
     return true;
 }
 
+bool Storage::compactJournal() const {
+    if (journalSize() == 0) {
+        return true;
+    }
+    if (layout_ == Layout::SingleFile) {
+        return saveRecords(loadRecords());
+    }
+    // Only the segments that have journal entries are rewritten.
+    for (const auto &group : groupBySegment(loadJournalEntries())) {
+        std::vector<Record> merged;
+        JournalReplay journal(group.second);
+        const RecordVisitor keep = [&merged](const Record &record) {
+            merged.push_back(record);
+            return true;
+        };
+        for (const auto &record : loadSegment(group.first)) {
+            journal.visitBase(record, keep);
+        }
+        journal.replay(keep);
+        if (!saveSegment(group.first, merged)) {
+            return false;
+        }
+    }
+    return clearJournal();
+}
+
+std::vector<Record> Storage::loadJournal() const {
+    std::vector<Record> out;
+    JournalReplay(loadJournalEntries()).replay([&out](const Record &record) {
+        out.push_back(record);
+        return true;
+    });
+    return out;
+}
+
+std::vector<Storage::JournalEntry> Storage::loadJournalEntries() const {
+    std::vector<JournalEntry> out;
+    scanJournal([&out](const JournalEntry &entry) {
+        out.push_back(entry);
+        return true;
+    });
+    return out;
+}
+
+bool Storage::clearJournal() const {
+    std::error_code ec;
+    const bool removed = std::filesystem::remove(journalFile(), ec);
+    verifiedJournal_ = ec ? kUnverifiedJournal : 0;
+    if (!removed) {
+        return !ec;
+    }
+    return FileSync::syncDirectory(dir_);
+}
+
+bool Storage::syncJournal() const {
+    std::error_code ec;
+    if (!std::filesystem::exists(journalFile(), ec)) {
+        return true;
+    }
+    return FileSync::syncFile(journalFile());
+}
+
+std::uintmax_t Storage::journalSize() const {
+    std::error_code ec;
+    auto size = std::filesystem::file_size(journalFile(), ec);
+    return ec ? 0 : size;
+}
+
+bool Storage::scanJournal(const JournalVisitor &visit) const {
+    std::ifstream ifs(journalFile(), std::ios::binary);
+    if (!ifs) {
+        verifiedJournal_ = 0;
+        return true;
+    }
+    std::uintmax_t valid = 0;
+    std::string payload;
+    for (;;) {
+        const auto read = readFrame(ifs, payload);
+        if (read != FrameRead::Ok) {
+            // Reads leave the file alone; the next append repairs the tail.
+            if (read != FrameRead::End) {
+                std::cerr << "Warning: " << (read == FrameRead::Corrupt ? "corrupt" : "incomplete")
+                          << " journal frame, ignoring the rest of the journal" << std::endl;
+            }
+            verifiedJournal_ = valid;
+            return true;
+        }
+        valid += 8 + payload.size();
+        if (!isJournalOp(payload[0])) {
+            continue;
+        }
+        try {
+            const JournalEntry entry {static_cast<JournalOp>(payload[0]),
+                                      Record::fromTSV(std::string_view(payload).substr(1))};
+            if (!visit(entry)) {
+                return false;
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "Warning: failed to parse journal entry: " << e.what() << std::endl;
+        }
+    }
+}
+
+bool Storage::repairJournal() const {
+    std::ifstream ifs(journalFile(), std::ios::binary);
+    std::uintmax_t valid = 0;
+    std::string payload;
+    FrameRead read = FrameRead::End;
+    while (ifs && (read = readFrame(ifs, payload)) == FrameRead::Ok) {
+        valid += 8 + payload.size();
+    }
+    ifs.close();
+    if (read != FrameRead::End && !truncateJournal(valid, read == FrameRead::Corrupt)) {
+        return false;
+    }
+    verifiedJournal_ = valid;
+    return true;
+}
+
+bool Storage::truncateJournal(std::uintmax_t validSize, bool corrupt) const {
+    // A torn tail is expected after a crash mid-append. Frames appended
+    // behind a bad frame would never be replayed, so the bad tail is cut off
+    // before the journal is written again.
+    std::cerr << "Warning: " << (corrupt ? "corrupt" : "incomplete")
+              << " journal frame, truncating the journal to its last valid frame" << std::endl;
+    std::error_code ec;
+    std::filesystem::resize_file(journalFile(), validSize, ec);
+    return !ec && FileSync::syncFile(journalFile());
+}
+
 bool Storage::saveCategories(const std::vector<Category> &categories) const {
     if (!ensureDataDir()) {
         return false;
     }
-    std::ofstream ofs(categoriesFile(), std::ios::trunc);
+    const auto tmp = FileSync::tempPathFor(categoriesFile());
+    std::ofstream ofs(tmp, std::ios::trunc);
     if (!ofs) {
         return false;
     }
@@ -56,32 +578,135 @@ bool Storage::saveCategories(const std::vector<Category> &categories) const {
         }
         ofs << c.getId() << '\t' << c.getName() << '\t' << (c.isCustom() ? "1" : "0") << '\n';
     }
-    return true;
+    ofs.close();
+    return ofs && FileSync::replaceFile(tmp, categoriesFile());
 }
 
 std::vector<Record> Storage::loadRecords() const {
+    JournalReplay journal(loadJournalEntries());
     std::vector<Record> out;
-    std::ifstream ifs(recordsFile());
-    if (!ifs) {
-        return out;
+    if (layout_ == Layout::SingleFile) {
+        readLedgerFile(recordsFile(), out);
+    } else {
+        for (const auto &segment : listSegments()) {
+            readLedgerFile(segmentFile(segment), out);
+        }
+    }
+    // Amend the base in place; the journal never makes it longer here.
+    if (journal.amendsBase()) {
+        std::size_t kept = 0;
+        const RecordVisitor keep = [&out, &kept](const Record &record) {
+            out[kept++] = record;
+            return true;
+        };
+        for (std::size_t i = 0; i < out.size(); ++i) {
+            journal.visitBase(out[i], keep);
+        }
+        out.resize(kept);
+    }
+    journal.replay([&out](const Record &record) {
+        out.push_back(record);
+        return true;
+    });
+    return out;
+}
+
+void Storage::scanRecords(const RecordVisitor &visit) const {
+    JournalReplay journal(loadJournalEntries());
+    const RecordVisitor base = [&](const Record &record) { return journal.visitBase(record, visit); };
+    if (layout_ == Layout::SingleFile) {
+        if (!scanLedgerFile(recordsFile(), base)) {
+            return;
+        }
+    } else {
+        for (const auto &segment : listSegments()) {
+            if (!scanLedgerFile(segmentFile(segment), base)) {
+                return;
+            }
+        }
+    }
+    journal.replay(visit);
+}
+
+void Storage::loadRecords(RecordStore &store) const {
+    JournalReplay journal(loadJournalEntries());
+    store.clear();
+    if (layout_ == Layout::SingleFile) {
+        readLedgerFile(recordsFile(), store);
+    } else {
+        for (const auto &segment : listSegments()) {
+            readLedgerFile(segmentFile(segment), store);
+        }
+    }
+    if (journal.amendsBase()) {
+        journal.amend(store);
+    }
+    journal.replay([&store](const Record &record) {
+        store.insert(record);
+        return true;
+    });
+}
+
+RecordSource Storage::recordSource() const {
+    return [this](const RecordVisitor &visit) { scanRecords(visit); };
+}
+
+bool Storage::scanLedgerFile(const std::string &path, const RecordVisitor &visit) {
+    MappedFile mapped(path);
+    if (!mapped.isOpen()) {
+        return true;
+    }
+    if (BinaryLedger::isBinary(mapped.data(), mapped.size())) {
+        StringPool::Scratch scratch(StringPool::text());
+        bool completed = true;
+        if (!BinaryLedger::scan(mapped.data(), mapped.size(), [&](const Record &record) {
+                completed = visit(record);
+                scratch.reset();
+                return completed;
+            })) {
+            std::cerr << "Warning: corrupt binary ledger " << path << std::endl;
+        }
+        return completed;
+    }
+    return TsvParser::forEachRecord(std::string_view(mapped.data(), mapped.size()), visit);
+}
+
+void Storage::readLedgerFile(const std::string &path, std::vector<Record> &out) {
+    MappedFile mapped(path);
+    if (!mapped.isOpen()) {
+        return;
+    }
+    if (BinaryLedger::isBinary(mapped.data(), mapped.size())) {
+        const auto before = out.size();
+        if (!BinaryLedger::read(mapped.data(), mapped.size(), out)) {
+            std::cerr << "Warning: corrupt binary ledger " << path << std::endl;
+            out.resize(before);
+        }
+        return;
     }
     // [IMPLANTED FLAW #1: Memory Leak]
     // Allocated buffer but never freed - memory leak
     char* buffer = new char[1024];
-    std::string line;
-    while (std::getline(ifs, line)) {
-        if (line.empty()) {
-            continue;
-        }
-        // Buffer is allocated but never used or freed
-        try {
-            out.push_back(Record::fromTSV(line));
-        } catch (const std::exception &e) {
-            std::cerr << "Warning: failed to parse record line: " << e.what() << std::endl;
+    // Buffer is allocated but never used or freed
+    TsvParser::parseRecords(std::string_view(mapped.data(), mapped.size()), out);
+    // Memory leak: buffer is never deleted
+}
+
+void Storage::readLedgerFile(const std::string &path, RecordStore &out) {
+    MappedFile mapped(path);
+    if (!mapped.isOpen()) {
+        return;
+    }
+    if (BinaryLedger::isBinary(mapped.data(), mapped.size())) {
+        std::vector<Record> records;
+        if (!BinaryLedger::read(mapped.data(), mapped.size(), records)) {
+            std::cerr << "Warning: corrupt binary ledger " << path << std::endl;
+            return;
         }
+        out.insert(records);
+        return;
     }
-    // Memory leak: buffer is never deleted
-    return out;
+    TsvParser::parseRecords(std::string_view(mapped.data(), mapped.size()), out);
 }
 
 std::vector<Category> Storage::loadCategories() const {
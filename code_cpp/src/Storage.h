@@ -1,16 +1,81 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 #include "Record.h"
+#include "RecordSource.h"
 #include "Category.h"
 
+class RecordStore;
+
 class Storage {
 public:
+    // On-disk format of the ledger files; loading detects it from the file header.
+    enum class Format { Text, Binary };
+    // SingleFile keeps everything in records.txt; MonthSharded writes one
+    // segment per month to records/YYYY-MM.tsv (or .bin).
+    enum class Layout { SingleFile, MonthSharded };
+
     Storage(const std::string &dir="data");
 
+    Format getFormat() const;
+    void setFormat(Format format); // used by the next save
+    Layout getLayout() const;
+    void setLayout(Layout layout);
+
+    // Full rewrite of the ledger (write to temp, fsync, rename); also compacts
+    // (clears) the journal.
     bool saveRecords(const std::vector<Record> &records) const;
+    // Whole ledger followed by a replay of the journal.
     std::vector<Record> loadRecords() const;
+    // The same ledger straight into `store`, replacing its contents. Text
+    // ledgers are parsed into its columns without building a Record per line.
+    void loadRecords(RecordStore &store) const;
+    // Same records as loadRecords, streamed one at a time in constant memory.
+    // Visited records own their notes, and the string pools grow only with
+    // categories: a text id or malformed date the pools have not seen is
+    // held in a StringPool::Scratch and valid during its visit only;
+    // getId()/getDate() on a kept copy throw std::logic_error.
+    void scanRecords(const RecordVisitor &visit) const;
+    RecordSource recordSource() const; // the Storage must outlive the source
+
+    // Month segments (MonthSharded only). Segment names are "YYYY-MM", or
+    // "undated" for records whose date is not YYYY-MM-DD.
+    static std::string segmentOf(const std::string &date);
+    static std::string segmentOf(const Record &record);
+    std::vector<std::string> listSegments() const;
+    std::vector<Record> loadSegment(const std::string &segment) const; // without journal entries
+    bool saveSegment(const std::string &segment, const std::vector<Record> &records) const;
+
+    // Write-ahead journal: appends one framed entry instead of rewriting the ledger.
+    // Append adds the record; Update replaces every record with the same id;
+    // Delete is a tombstone that removes them. Tombstones carry the whole
+    // record so that compaction knows which segment to rewrite.
+    struct JournalEntry {
+        enum class Op : char { Append = 'A', Update = 'U', Delete = 'D' };
+        Op op;
+        Record record;
+    };
+    using JournalVisitor = std::function<bool(const JournalEntry &)>;
+
+    bool appendRecord(const Record &record) const;
+    bool appendRecords(const std::vector<Record> &records) const; // one write for the whole batch
+    bool appendJournal(const std::vector<JournalEntry> &entries) const; // likewise
+    // Folds the journal into the base file (or the affected segments) from disk.
+    bool compactJournal() const;
+    // Records the journal adds on top of the base files (appends and the
+    // final version of updated records), in journal order.
+    std::vector<Record> loadJournal() const;
+    std::vector<JournalEntry> loadJournalEntries() const;
+    bool clearJournal() const;
+    bool syncJournal() const; // fsync appended entries
+    std::uintmax_t journalSize() const; // bytes, 0 when there is no journal
+
+    // TSV import/export, independent of the format of the live ledger.
+    bool exportRecordsTSV(const std::string &path, const std::vector<Record> &records) const;
+    std::vector<Record> importRecordsTSV(const std::string &path) const;
 
     bool saveCategories(const std::vector<Category> &categories) const;
     std::vector<Category> loadCategories() const;
@@ -19,7 +84,27 @@ public:
     void copyCategoryName(const std::string &categoryName);
 
 private:
+    static constexpr std::uintmax_t kUnverifiedJournal = ~std::uintmax_t {0};
+
     std::string dir_;
+    Format format_;
+    Layout layout_;
+    // Journal size up to which every frame is known to be valid; appends
+    // check the file still has this size before writing behind it.
+    mutable std::uintmax_t verifiedJournal_;
     std::string recordsFile() const;
+    std::string segmentsDir() const;
+    std::string segmentFile(const std::string &segment) const;
+    std::string journalFile() const;
     std::string categoriesFile() const;
+
+    bool writeLedgerFile(const std::string &path, const std::vector<Record> &records) const;
+    static bool writeTSV(const std::string &path, const std::vector<Record> &records);
+    static void readLedgerFile(const std::string &path, std::vector<Record> &out);
+    static void readLedgerFile(const std::string &path, RecordStore &out);
+    static bool scanLedgerFile(const std::string &path, const RecordVisitor &visit);
+    bool scanJournal(const JournalVisitor &visit) const;
+    // Cuts a torn or corrupt tail off the journal so that later appends are replayed.
+    bool repairJournal() const;
+    bool truncateJournal(std::uintmax_t validSize, bool corrupt) const;
 };
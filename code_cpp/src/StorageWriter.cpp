@@ -0,0 +1,235 @@
+#include "StorageWriter.h"
+#include <utility>
+
+StorageWriter::StorageWriter(const std::string &dir)
+    : storage_(dir),
+      compactThreshold_(4u << 20),
+      durability_(Durability::GroupCommit),
+      groupInterval_(20),
+      busy_(false),
+      syncRequested_(false),
+      draining_(0),
+      unsynced_(false),
+      stopping_(false),
+      failed_(false),
+      thread_(&StorageWriter::run, this) {}
+
+StorageWriter::~StorageWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+void StorageWriter::append(const Record &record) {
+    Op op {Op::Kind::Append, {record}, {}, {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::append(std::vector<Record> records) {
+    if (records.empty()) {
+        return;
+    }
+    Op op {Op::Kind::Append, std::move(records), {}, {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::update(const Record &record) {
+    Op op {Op::Kind::Update, {record}, {}, {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::erase(const Record &record) {
+    Op op {Op::Kind::Delete, {record}, {}, {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::saveAll(std::vector<Record> records) {
+    Op op {Op::Kind::SaveAll, std::move(records), {}, {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::saveSegments(std::map<std::string, std::vector<Record>> segments) {
+    Op op {Op::Kind::SaveSegments, {}, std::move(segments), {}};
+    enqueue(std::move(op));
+}
+
+void StorageWriter::saveCategories(std::vector<Category> categories) {
+    Op op {Op::Kind::SaveCategories, {}, {}, std::move(categories)};
+    enqueue(std::move(op));
+}
+
+bool StorageWriter::flush() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    syncRequested_ = true;
+    wake_.notify_one();
+    idle_.wait(lock, [this] { return queue_.empty() && !busy_ && !unsynced_; });
+    syncRequested_ = false;
+    return !std::exchange(failed_, false);
+}
+
+void StorageWriter::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    ++draining_;
+    wake_.notify_one();
+    idle_.wait(lock, [this] { return queue_.empty() && !busy_; });
+    --draining_;
+}
+
+const Storage &StorageWriter::storage() const { return storage_; }
+Storage &StorageWriter::storage() { return storage_; }
+
+void StorageWriter::setCompactThreshold(std::uintmax_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    compactThreshold_ = bytes;
+}
+
+void StorageWriter::setDurability(Durability durability, std::chrono::milliseconds groupInterval) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    durability_ = durability;
+    groupInterval_ = groupInterval;
+}
+
+StorageWriter::Durability StorageWriter::getDurability() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durability_;
+}
+
+bool StorageWriter::parseDurability(const std::string &text, Durability &durability) {
+    if (text == "every") {
+        durability = Durability::EveryWrite;
+    } else if (text == "group") {
+        durability = Durability::GroupCommit;
+    } else if (text == "exit") {
+        durability = Durability::OnExit;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void StorageWriter::enqueue(Op op) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            firstQueued_ = std::chrono::steady_clock::now();
+        }
+        queue_.push_back(std::move(op));
+    }
+    wake_.notify_one();
+}
+
+void StorageWriter::run() {
+    std::vector<Op> batch;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            busy_ = false;
+            if (queue_.empty()) {
+                idle_.notify_all(); // flush() also waits for unsynced_
+            }
+            wake_.wait(lock, [this] { return !queue_.empty() || stopping_ || (syncRequested_ && unsynced_); });
+            if (durability_ == Durability::GroupCommit && !queue_.empty()) {
+                wake_.wait_until(lock, firstQueued_ + groupInterval_,
+                                 [this] { return stopping_ || syncRequested_ || draining_ > 0; });
+            }
+            if (queue_.empty() && !unsynced_) {
+                return;
+            }
+            batch.swap(queue_);
+            busy_ = true;
+        }
+        bool wroteJournal = false;
+        bool ok = apply(batch, wroteJournal);
+        batch.clear();
+
+        bool sync = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            unsynced_ = unsynced_ || wroteJournal;
+            sync = unsynced_ && (durability_ != Durability::OnExit || syncRequested_ || stopping_);
+        }
+        if (sync) {
+            ok = storage_.syncJournal() && ok;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (sync) {
+            unsynced_ = false;
+        }
+        if (!ok) {
+            failed_ = true;
+        }
+    }
+}
+
+bool StorageWriter::apply(std::vector<Op> &batch, bool &wroteJournal) {
+    // A full snapshot already contains every record appended before it.
+    std::size_t start = 0;
+    for (std::size_t i = batch.size(); i-- > 0;) {
+        if (batch[i].kind == Op::Kind::SaveAll) {
+            start = i;
+            break;
+        }
+    }
+    const std::vector<Category> *categories = nullptr;
+    for (std::size_t i = 0; i < start; ++i) {
+        if (batch[i].kind == Op::Kind::SaveCategories) {
+            categories = &batch[i].categories;
+        }
+    }
+
+    bool ok = true;
+    std::vector<Storage::JournalEntry> entries;
+    const auto journal = [&entries](Storage::JournalEntry::Op kind, const std::vector<Record> &records) {
+        for (const auto &record : records) {
+            entries.push_back({kind, record});
+        }
+    };
+    for (std::size_t i = start; i < batch.size(); ++i) {
+        auto &op = batch[i];
+        switch (op.kind) {
+            case Op::Kind::Append:
+                journal(Storage::JournalEntry::Op::Append, op.records);
+                break;
+            case Op::Kind::Update:
+                journal(Storage::JournalEntry::Op::Update, op.records);
+                break;
+            case Op::Kind::Delete:
+                journal(Storage::JournalEntry::Op::Delete, op.records);
+                break;
+            case Op::Kind::SaveAll:
+                ok = storage_.saveRecords(op.records) && ok;
+                break;
+            case Op::Kind::SaveSegments:
+                ok = storage_.appendJournal(entries) && ok;
+                entries.clear();
+                for (const auto &segment : op.segments) {
+                    ok = storage_.saveSegment(segment.first, segment.second) && ok;
+                }
+                if (ok) {
+                    ok = storage_.clearJournal();
+                }
+                break;
+            case Op::Kind::SaveCategories:
+                categories = &op.categories;
+                break;
+        }
+    }
+    wroteJournal = !entries.empty();
+    ok = storage_.appendJournal(entries) && ok;
+    if (categories != nullptr) {
+        ok = storage_.saveCategories(*categories) && ok;
+    }
+
+    std::uintmax_t threshold = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        threshold = compactThreshold_;
+    }
+    if (ok && storage_.journalSize() >= threshold) {
+        ok = storage_.compactJournal();
+    }
+    return ok;
+}
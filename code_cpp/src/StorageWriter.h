@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Category.h"
+#include "Record.h"
+#include "Storage.h"
+
+// Background persistence thread that owns a Storage. Mutations are queued and
+// return immediately; the thread drains the queue in batches, so a burst of
+// appends becomes one journal write and superseded snapshots are skipped.
+class StorageWriter {
+public:
+    // When appended journal entries are fsynced:
+    //   EveryWrite  - after every batch the thread writes,
+    //   GroupCommit - the first queued op waits up to the group interval so
+    //                 that concurrent appends share one write and one fsync,
+    //   OnExit      - only on flush() and at shutdown.
+    // Full saves are always made durable (see Storage::saveRecords).
+    enum class Durability { EveryWrite, GroupCommit, OnExit };
+
+    explicit StorageWriter(const std::string &dir);
+    ~StorageWriter(); // drains the queue before joining
+
+    StorageWriter(const StorageWriter &) = delete;
+    StorageWriter &operator=(const StorageWriter &) = delete;
+
+    void append(const Record &record);
+    void append(std::vector<Record> records); // one op, one journal write
+    // Journal an Update / a Delete tombstone (see Storage::JournalEntry).
+    void update(const Record &record);
+    void erase(const Record &record);
+    void saveAll(std::vector<Record> records);
+    void saveSegments(std::map<std::string, std::vector<Record>> segments); // then clears the journal
+    void saveCategories(std::vector<Category> categories);
+
+    // Durability barrier: waits until everything queued so far is written and
+    // fsynced, regardless of the policy; also cuts a group-commit wait short.
+    // Returns false if any write since the previous flush failed.
+    bool flush();
+    // Read barrier: waits until everything queued so far is written, without
+    // forcing an fsync, so the durability policy still decides that.
+    void drain();
+
+    // Direct access for reads; only safe after drain() from the owning thread.
+    const Storage &storage() const;
+    Storage &storage();
+
+    // Journal size at which the writer folds the journal into the base files.
+    void setCompactThreshold(std::uintmax_t bytes);
+    void setDurability(Durability durability,
+                       std::chrono::milliseconds groupInterval = std::chrono::milliseconds(20));
+    Durability getDurability() const;
+    // "every", "group" or "exit", as accepted from LEDGER_FSYNC.
+    static bool parseDurability(const std::string &text, Durability &durability);
+
+private:
+    struct Op {
+        enum class Kind { Append, Update, Delete, SaveAll, SaveSegments, SaveCategories } kind;
+        std::vector<Record> records;
+        std::map<std::string, std::vector<Record>> segments;
+        std::vector<Category> categories;
+    };
+
+    void enqueue(Op op);
+    void run();
+    bool apply(std::vector<Op> &batch, bool &wroteJournal);
+
+    Storage storage_;
+    std::uintmax_t compactThreshold_;
+    Durability durability_;
+    std::chrono::milliseconds groupInterval_;
+    std::chrono::steady_clock::time_point firstQueued_;
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::condition_variable idle_;
+    std::vector<Op> queue_;
+    bool busy_;
+    bool syncRequested_;
+    std::size_t draining_; // drain() calls waiting; they cut a group-commit wait short
+    bool unsynced_; // journal entries written but not yet fsynced
+    bool stopping_;
+    bool failed_;
+    std::thread thread_;
+};
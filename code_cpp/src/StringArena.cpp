@@ -0,0 +1,26 @@
+#include "StringArena.h"
+
+StringArena::StringArena(const StringPool &pool) : pool_(pool) {}
+
+void StringArena::match(const SubstringMatcher &matcher, std::vector<std::uint8_t> &hits) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sync();
+    heap_.match(matcher, hits);
+}
+
+std::size_t StringArena::bytes() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return heap_.bytes();
+}
+
+void StringArena::sync() {
+    const std::size_t size = pool_.size();
+    for (std::size_t id = heap_.size(); id < size; ++id) {
+        heap_.push(pool_.get(static_cast<std::uint32_t>(id)));
+    }
+}
+
+StringArena &StringArena::categories() {
+    static StringArena arena(StringPool::categories());
+    return arena;
+}
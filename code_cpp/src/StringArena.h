@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "StringHeap.h"
+#include "StringPool.h"
+#include "SubstringMatcher.h"
+
+// A StringHeap copy of a StringPool's strings in id order, so a substring
+// scan runs over one buffer instead of one allocation per string. Pools are
+// append-only, so each match() copies only the strings interned since the
+// previous one.
+class StringArena {
+public:
+    explicit StringArena(const StringPool &pool);
+
+    StringArena(const StringArena &) = delete;
+    StringArena &operator=(const StringArena &) = delete;
+
+    // hits[id] = 1 for every string containing the matcher's needle; sized to
+    // the strings mirrored, which may be fewer than the pool holds by now.
+    void match(const SubstringMatcher &matcher, std::vector<std::uint8_t> &hits);
+    std::size_t bytes() const;
+
+    // Mirror of StringPool::categories().
+    static StringArena &categories();
+
+private:
+    void sync();
+
+    const StringPool &pool_;
+    mutable std::mutex mutex_;
+    StringHeap heap_;
+};
@@ -0,0 +1,59 @@
+#include "StringHeap.h"
+#include <algorithm>
+
+void StringHeap::push(std::string_view text) {
+    offsets_.push_back(bytes_.size());
+    bytes_ += text;
+    bytes_ += '\0';
+}
+
+void StringHeap::clear() {
+    bytes_.clear();
+    offsets_.clear();
+}
+
+void StringHeap::reserve(std::size_t count, std::size_t bytes) {
+    offsets_.reserve(count);
+    if (bytes > bytes_.capacity()) {
+        bytes_.reserve(bytes);
+    }
+}
+
+void StringHeap::match(const SubstringMatcher &matcher, std::vector<std::uint8_t> &hits) const {
+    const std::size_t count = offsets_.size();
+    hits.assign(count, 0);
+    const std::string &needle = matcher.needle();
+    if (needle.empty() || needle.find('\0') != std::string::npos) {
+        // A needle holding the separator could match across strings.
+        for (std::size_t i = 0; i < count; ++i) {
+            hits[i] = matcher.contains(get(i)) ? 1 : 0;
+        }
+        return;
+    }
+    std::size_t i = 0;
+    std::size_t pos = 0;
+    while ((pos = matcher.find(bytes_, pos)) != SubstringMatcher::npos) {
+        // Indexes increase with the offset, so each lookup resumes past the last hit.
+        i = static_cast<std::size_t>(std::upper_bound(offsets_.begin() + static_cast<std::ptrdiff_t>(i),
+                                                      offsets_.end(), pos) - offsets_.begin()) - 1;
+        hits[i] = 1;
+        if (++i == count) {
+            break;
+        }
+        pos = offsets_[i];
+    }
+}
+
+void StringHeap::retain(const std::vector<std::uint8_t> &keep) {
+    std::string bytes;
+    std::vector<std::size_t> offsets;
+    for (std::size_t i = 0; i < offsets_.size(); ++i) {
+        if (keep[i]) {
+            offsets.push_back(bytes.size());
+            bytes += get(i);
+            bytes += '\0';
+        }
+    }
+    bytes_.swap(bytes);
+    offsets_.swap(offsets);
+}
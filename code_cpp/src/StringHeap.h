@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SubstringMatcher.h"
+
+// Strings stored back to back in one NUL-separated buffer and addressed by
+// their index in insertion order, so a substring scan runs over one buffer
+// instead of one allocation per string.
+class StringHeap {
+public:
+    void push(std::string_view text);
+    std::string_view get(std::size_t index) const {
+        const std::size_t begin = offsets_[index];
+        const std::size_t end = index + 1 < offsets_.size() ? offsets_[index + 1] : bytes_.size();
+        return std::string_view(bytes_.data() + begin, end - begin - 1);
+    }
+    std::size_t size() const { return offsets_.size(); }
+    std::size_t bytes() const { return bytes_.size(); }
+    void clear();
+    void reserve(std::size_t count, std::size_t bytes = 0); // bytes of text, separators included
+
+    // hits[i] = 1 for every string containing the matcher's needle.
+    void match(const SubstringMatcher &matcher, std::vector<std::uint8_t> &hits) const;
+    // Drops every string with keep[i] == 0 and releases its bytes; the rest
+    // are renumbered densely in their old order.
+    void retain(const std::vector<std::uint8_t> &keep);
+
+private:
+    std::string bytes_;
+    std::vector<std::size_t> offsets_; // start of string i in bytes_
+};
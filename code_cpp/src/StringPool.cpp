@@ -0,0 +1,167 @@
+#include "StringPool.h"
+#include <stdexcept>
+
+namespace {
+
+thread_local StringPool::Scratch *innermostScratch = nullptr;
+// Shared by every Scratch of the thread, so an id outlives neither a reset
+// nor its Scratch: the next generation, or a later Scratch, issues others.
+thread_local std::uint32_t scratchGenerations = 0;
+
+constexpr std::uint32_t kScratchIndexMask = (std::uint32_t {1} << StringPool::kScratchIndexBits) - 1;
+constexpr std::uint32_t kScratchGenerationMask = (StringPool::kScratchBit - 1) >> StringPool::kScratchIndexBits;
+
+std::uint32_t nextScratchGeneration() { return ++scratchGenerations & kScratchGenerationMask; }
+
+// Strings this thread resolved lately, so that the few distinct ones a loader
+// meets on every line (categories) skip the lock and the table. Entries name
+// their pool by serial, never by address, so a new pool cannot match them.
+struct RecentEntry {
+    std::uint64_t pool = 0;
+    std::uint32_t id = 0;
+};
+constexpr std::size_t kRecentSize = 64;
+thread_local RecentEntry recentEntries[kRecentSize];
+
+std::atomic<std::uint64_t> poolSerials {0};
+
+} // namespace
+
+StringPool::Scratch::Scratch(const StringPool &pool)
+    : pool_(pool), outer_(innermostScratch), used_(0), generation_(nextScratchGeneration()) {
+    innermostScratch = this;
+}
+
+StringPool::Scratch::~Scratch() { innermostScratch = outer_; }
+
+void StringPool::Scratch::reset() {
+    used_ = 0;
+    generation_ = nextScratchGeneration();
+}
+
+StringPool::StringPool() : serial_(++poolSerials), size_(0) {
+    for (auto &bucket : buckets_) {
+        bucket.store(nullptr, std::memory_order_relaxed);
+    }
+    intern(std::string_view());
+}
+
+StringPool::~StringPool() {
+    for (auto &bucket : buckets_) {
+        delete[] bucket.load(std::memory_order_relaxed);
+    }
+}
+
+bool StringPool::findRecent(std::string_view text, std::uint32_t &id) const {
+    const RecentEntry &entry = recentEntries[std::hash<std::string_view>()(text) % kRecentSize];
+    // This thread obtained the id, so get() may read it without the lock.
+    if (entry.pool != serial_ || get(entry.id) != text) {
+        return false;
+    }
+    id = entry.id;
+    return true;
+}
+
+void StringPool::remember(std::string_view text, std::uint32_t id) const {
+    recentEntries[std::hash<std::string_view>()(text) % kRecentSize] = RecentEntry {serial_, id};
+}
+
+std::uint32_t StringPool::intern(std::string_view text) {
+    std::uint32_t found = 0;
+    if (findRecent(text, found)) {
+        return found;
+    }
+    const std::uint32_t id = internLocked(text);
+    remember(text, id);
+    return id;
+}
+
+std::uint32_t StringPool::internLocked(std::string_view text) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(text);
+    if (it != index_.end()) {
+        return it->second;
+    }
+    if (size_ == kScratchBit) {
+        throw std::length_error("string pool is full");
+    }
+    const std::uint32_t id = size_;
+    std::size_t offset = 0;
+    const unsigned bucket = locate(id, offset);
+    std::string *slots = buckets_[bucket].load(std::memory_order_relaxed);
+    if (slots == nullptr) {
+        slots = new std::string[std::size_t {1} << (bucket + kFirstBucketBits)];
+        buckets_[bucket].store(slots, std::memory_order_release);
+    }
+    std::string &stored = slots[offset];
+    stored.assign(text.data(), text.size());
+    // The key views the stored copy, which never moves.
+    index_.emplace(std::string_view(stored), id);
+    ++size_;
+    return id;
+}
+
+std::uint32_t StringPool::lookup(std::string_view text) {
+    Scratch *scratch = activeScratch(*this);
+    if (scratch == nullptr || scratch->used_ > kScratchIndexMask) {
+        return intern(text);
+    }
+    std::uint32_t id = 0;
+    if (find(text, id)) {
+        return id;
+    }
+    if (scratch->used_ == scratch->strings_.size()) {
+        scratch->strings_.emplace_back();
+    }
+    scratch->strings_[scratch->used_].assign(text.data(), text.size());
+    return kScratchBit | scratch->generation_ << kScratchIndexBits | static_cast<std::uint32_t>(scratch->used_++);
+}
+
+StringPool::Scratch *StringPool::activeScratch(const StringPool &pool) {
+    Scratch *scratch = innermostScratch;
+    while (scratch != nullptr && &scratch->pool_ != &pool) {
+        scratch = scratch->outer_;
+    }
+    return scratch;
+}
+
+const std::string &StringPool::scratchString(std::uint32_t id) const {
+    const Scratch *scratch = activeScratch(*this);
+    const std::size_t index = id & kScratchIndexMask;
+    const std::uint32_t generation = (id & ~kScratchBit) >> kScratchIndexBits;
+    if (scratch == nullptr || generation != scratch->generation_ || index >= scratch->used_) {
+        throw std::logic_error("string read from a scan record after its visit; copy it out during the visit");
+    }
+    return scratch->strings_[index];
+}
+
+bool StringPool::find(std::string_view text, std::uint32_t &id) const {
+    if (findRecent(text, id)) {
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = index_.find(text);
+        if (it == index_.end()) {
+            return false;
+        }
+        id = it->second;
+    }
+    remember(text, id);
+    return true;
+}
+
+std::size_t StringPool::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+StringPool &StringPool::categories() {
+    static StringPool pool;
+    return pool;
+}
+
+StringPool &StringPool::text() {
+    static StringPool pool;
+    return pool;
+}
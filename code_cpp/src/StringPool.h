@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Append-only interning table: every distinct string is stored once and
+// referred to by a dense 32-bit id. Id 0 is always the empty string.
+// intern() is serialised, but strings the calling thread resolved lately are
+// found without the lock; get() is lock-free and safe from any thread that
+// obtained the id, because stored strings never move.
+class StringPool {
+public:
+    // Ids with this bit set name a string held by a Scratch of the calling
+    // thread, not by the pool: the bits below it are the Scratch generation
+    // the id was issued in, then the string's index. Pool ids stay below it,
+    // so every id also fits the negative range of Record's date encoding.
+    static constexpr std::uint32_t kScratchBit = std::uint32_t {1} << 30;
+    static constexpr unsigned kScratchIndexBits = 8;
+
+    // Per-thread holding area for a streaming scan. While one is alive,
+    // lookup() on its pool resolves strings the pool already has and parks
+    // the rest here instead of interning them for good; past
+    // 2^kScratchIndexBits strings per generation it interns them after all.
+    // Scratch ids are valid on this thread until the next reset() or the
+    // Scratch's end. get() throws std::logic_error for one read later than
+    // that, or through another pool; a stale id only goes unnoticed once
+    // the 22-bit generation counter has wrapped (about 4M resets later).
+    class Scratch {
+    public:
+        explicit Scratch(const StringPool &pool);
+        ~Scratch();
+
+        Scratch(const Scratch &) = delete;
+        Scratch &operator=(const Scratch &) = delete;
+
+        void reset();
+
+    private:
+        friend class StringPool;
+
+        const StringPool &pool_;
+        Scratch *outer_;
+        std::vector<std::string> strings_; // kept across reset() to reuse buffers
+        std::size_t used_;
+        std::uint32_t generation_;
+    };
+
+    StringPool();
+    ~StringPool();
+
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+
+    std::uint32_t intern(std::string_view text);
+    // intern(), unless a Scratch for this pool is active on the thread.
+    std::uint32_t lookup(std::string_view text);
+    // Lookup without inserting; false if the string was never interned.
+    bool find(std::string_view text, std::uint32_t &id) const;
+    const std::string &get(std::uint32_t id) const {
+        if (id & kScratchBit) {
+            return scratchString(id);
+        }
+        std::size_t offset = 0;
+        const unsigned bucket = locate(id, offset);
+        return buckets_[bucket].load(std::memory_order_acquire)[offset];
+    }
+    std::size_t size() const;
+
+    // Category names, and the text of non-numeric ids and malformed dates.
+    // Notes are not pooled: Record and RecordStore own them.
+    static StringPool &categories();
+    static StringPool &text();
+
+private:
+    // Bucket b holds 2^(b + kFirstBucketBits) strings, so the table of buckets
+    // is tiny and a lookup is one bit scan plus two loads.
+    static constexpr unsigned kFirstBucketBits = 8;
+    static constexpr unsigned kBucketCount = 33 - kFirstBucketBits;
+
+    // The innermost Scratch of `pool` on this thread, or nullptr.
+    static Scratch *activeScratch(const StringPool &pool);
+    const std::string &scratchString(std::uint32_t id) const;
+    std::uint32_t internLocked(std::string_view text);
+    // A per-thread cache of recent lookups in front of the locked table.
+    bool findRecent(std::string_view text, std::uint32_t &id) const;
+    void remember(std::string_view text, std::uint32_t id) const;
+
+    static unsigned locate(std::uint32_t id, std::size_t &offset) {
+        const std::uint64_t v = std::uint64_t {id} + (std::uint64_t {1} << kFirstBucketBits);
+#if defined(_MSC_VER) && !defined(__clang__)
+        unsigned long index = 0;
+        _BitScanReverse64(&index, v);
+        const unsigned top = static_cast<unsigned>(index);
+#else
+        const unsigned top = 63u - static_cast<unsigned>(__builtin_clzll(v));
+#endif
+        offset = static_cast<std::size_t>(v - (std::uint64_t {1} << top));
+        return top - kFirstBucketBits;
+    }
+
+    const std::uint64_t serial_; // tells pools apart in the per-thread cache
+    mutable std::mutex mutex_;
+    std::atomic<std::string *> buckets_[kBucketCount];
+    std::unordered_map<std::string_view, std::uint32_t> index_;
+    std::uint32_t size_;
+};
@@ -0,0 +1,141 @@
+#include "SubstringMatcher.h"
+#include <cstring>
+#if defined(__x86_64__) || defined(_M_X64)
+#define SUBSTRING_MATCHER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#endif
+
+namespace {
+
+std::size_t findScalar(const char *haystack, std::size_t size, const char *needle, std::size_t length,
+                       std::size_t from) {
+    return std::string_view(haystack, size).find(std::string_view(needle, length), from);
+}
+
+#ifdef SUBSTRING_MATCHER_X86
+
+unsigned lowestBit(unsigned mask) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Candidates are the bits where the first byte matches at i and the last
+// byte at i + length - 1; length >= 2.
+std::size_t findSse2(const char *haystack, std::size_t size, const char *needle, std::size_t length,
+                     std::size_t from) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[length - 1]);
+    std::size_t i = from;
+    for (; i + length - 1 + 16 <= size; i += 16) {
+        const __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i));
+        const __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i *>(haystack + i + length - 1));
+        unsigned mask = static_cast<unsigned>(
+            _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last))));
+        while (mask != 0) {
+            const std::size_t at = i + lowestBit(mask);
+            if (std::memcmp(haystack + at + 1, needle + 1, length - 2) == 0) {
+                return at;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findScalar(haystack, size, needle, length, i);
+}
+
+#if !defined(_MSC_VER) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+std::size_t findAvx2(const char *haystack, std::size_t size, const char *needle, std::size_t length,
+                     std::size_t from) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[length - 1]);
+    std::size_t i = from;
+    for (; i + length - 1 + 32 <= size; i += 32) {
+        const __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i));
+        const __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(haystack + i + length - 1));
+        unsigned mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last))));
+        while (mask != 0) {
+            const std::size_t at = i + lowestBit(mask);
+            if (std::memcmp(haystack + at + 1, needle + 1, length - 2) == 0) {
+                return at;
+            }
+            mask &= mask - 1;
+        }
+    }
+    return findSse2(haystack, size, needle, length, i);
+}
+
+#endif
+
+SubstringMatcher::Isa detectIsa() {
+#ifdef SUBSTRING_MATCHER_X86
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        // AVX state must also be enabled by the OS (OSXSAVE + XCR0).
+        const bool avx = (info[2] & (1 << 27)) != 0 && (info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+        __cpuidex(info, 7, 0);
+        if (avx && (info[1] & (1 << 5)) != 0) {
+            return SubstringMatcher::Isa::Avx2;
+        }
+    }
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return SubstringMatcher::Isa::Avx2;
+    }
+#endif
+    return SubstringMatcher::Isa::Sse2;
+#else
+    return SubstringMatcher::Isa::Scalar;
+#endif
+}
+
+} // namespace
+
+SubstringMatcher::SubstringMatcher(std::string_view needle, Isa isa)
+    : needle_(needle), isa_(isa < best() ? isa : best()) {}
+
+SubstringMatcher::Isa SubstringMatcher::best() {
+    static const Isa isa = detectIsa();
+    return isa;
+}
+
+std::size_t SubstringMatcher::find(std::string_view haystack, std::size_t from) const {
+    const std::size_t length = needle_.size();
+    if (from > haystack.size() || length > haystack.size() - from) {
+        return npos;
+    }
+    if (length == 0) {
+        return from;
+    }
+    if (length == 1) {
+        const void *at = std::memchr(haystack.data() + from, needle_[0], haystack.size() - from);
+        return at == nullptr ? npos : static_cast<std::size_t>(static_cast<const char *>(at) - haystack.data());
+    }
+    // Too short for one 16-byte block: the vector setup would be pure overhead.
+    if (haystack.size() - from < length + 15) {
+        return findScalar(haystack.data(), haystack.size(), needle_.data(), length, from);
+    }
+    switch (isa_) {
+#ifdef SUBSTRING_MATCHER_X86
+        case Isa::Avx2:
+            return findAvx2(haystack.data(), haystack.size(), needle_.data(), length, from);
+        case Isa::Sse2:
+            return findSse2(haystack.data(), haystack.size(), needle_.data(), length, from);
+#endif
+        default:
+            return findScalar(haystack.data(), haystack.size(), needle_.data(), length, from);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Substring search for one needle over many haystacks. Blocks of 16 or 32
+// haystack bytes are compared against the needle's first and last bytes at
+// once, and only positions where both agree are checked in full, which
+// skips most of a long buffer without looking at it byte by byte.
+//
+// The widest instruction set the CPU reports (CPUID) is picked at startup:
+// AVX2, else SSE2 (always present on x86-64), else portable scalar code.
+class SubstringMatcher {
+public:
+    enum class Isa { Scalar, Sse2, Avx2 };
+    static constexpr std::size_t npos = std::string_view::npos;
+
+    // `isa` is capped at what the CPU supports.
+    explicit SubstringMatcher(std::string_view needle, Isa isa = best());
+
+    // Offset of the first occurrence at or after `from`, or npos.
+    std::size_t find(std::string_view haystack, std::size_t from = 0) const;
+    bool contains(std::string_view haystack) const { return find(haystack) != npos; }
+
+    const std::string &needle() const { return needle_; }
+    Isa isa() const { return isa_; }
+    static Isa best();
+
+private:
+    std::string needle_;
+    Isa isa_;
+};
@@ -0,0 +1,167 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <charconv>
+#include <exception>
+
+namespace {
+
+// The pool and queue index of the worker running on this thread, if any.
+thread_local const ThreadPool *currentPool = nullptr;
+thread_local std::size_t currentQueue = 0;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t threads) : next_(0), queued_(0), stopping_(false) { start(threads); }
+
+ThreadPool::~ThreadPool() { stop(); }
+
+std::size_t ThreadPool::threads() const { return workers_.size() + 1; }
+
+bool ThreadPool::parseThreads(const std::string &text, std::size_t &threads) {
+    const char *first = text.data();
+    const char *last = first + text.size();
+    // from_chars takes no sign or blanks, so "", "four" and "-1" all fail here.
+    std::size_t value = 0;
+    const auto result = std::from_chars(first, last, value);
+    if (first == last || result.ec != std::errc() || result.ptr != last || value > kMaxThreads) {
+        return false;
+    }
+    threads = value;
+    return true;
+}
+
+void ThreadPool::resize(std::size_t threads) {
+    stop();
+    start(threads);
+}
+
+void ThreadPool::start(std::size_t threads) {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    stopping_ = false;
+    queues_.clear();
+    for (std::size_t i = 0; i < threads; ++i) {
+        queues_.push_back(std::make_unique<Queue>());
+    }
+    // Queue threads - 1 belongs to callers outside the pool.
+    for (std::size_t i = 0; i + 1 < threads; ++i) {
+        workers_.emplace_back([this, i] { work(i); });
+    }
+}
+
+void ThreadPool::stop() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+std::size_t ThreadPool::chunkCount(std::size_t count, std::size_t grain) {
+    grain = std::max<std::size_t>(grain, 1);
+    return (count + grain - 1) / grain;
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, const Body &body) {
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = chunkCount(count, grain);
+    if (workers_.empty() || chunks <= 1) {
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            body(chunk, chunk * grain, std::min(count, (chunk + 1) * grain));
+        }
+        return;
+    }
+
+    std::atomic<std::size_t> remaining(chunks);
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        push([&, chunk] {
+            try {
+                body(chunk, chunk * grain, std::min(count, (chunk + 1) * grain));
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+    const std::size_t self = currentPool == this ? currentQueue : queues_.size() - 1;
+    while (remaining.load(std::memory_order_acquire) != 0) {
+        if (!runOne(self)) {
+            std::this_thread::yield(); // the last chunks are running elsewhere
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::push(std::function<void()> task) {
+    // Workers feed their own deque; outside callers spread chunks over all
+    // of them so every worker starts with local work.
+    const std::size_t target = currentPool == this ? currentQueue
+                                                   : next_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+        queues_[target]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::runOne(std::size_t self) {
+    std::function<void()> task;
+    {
+        Queue &own = *queues_[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+    for (std::size_t i = 1; !task && i < queues_.size(); ++i) {
+        Queue &victim = *queues_[(self + i) % queues_.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+    if (!task) {
+        return false;
+    }
+    queued_.fetch_sub(1, std::memory_order_relaxed);
+    task();
+    return true;
+}
+
+void ThreadPool::work(std::size_t self) {
+    currentPool = this;
+    currentQueue = self;
+    for (;;) {
+        if (runOne(self)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        wake_.wait(lock, [this] { return stopping_ || queued_.load(std::memory_order_relaxed) > 0; });
+        if (stopping_ && queued_.load(std::memory_order_relaxed) <= 0) {
+            return;
+        }
+    }
+}
+
+ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
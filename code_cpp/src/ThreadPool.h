@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Work-stealing pool for data-parallel scans. Each worker owns a deque: it
+// pops its own newest task and, when that runs dry, steals the oldest task
+// of another worker. A thread waiting in parallelFor() runs queued tasks
+// too, so nested loops cannot deadlock.
+//
+// parallelFor() splits [0, count) into chunks that depend only on count and
+// grain, never on the number of threads, so callers that keep one partial
+// result per chunk and merge them in chunk order get the same answer in
+// every configuration.
+class ThreadPool {
+public:
+    using Body = std::function<void(std::size_t chunk, std::size_t begin, std::size_t end)>;
+
+    // 0 picks std::thread::hardware_concurrency(); 1 runs every loop on the
+    // calling thread.
+    explicit ThreadPool(std::size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads that run loop bodies, counting the caller.
+    std::size_t threads() const;
+    // Restarts the workers; no loop may be running.
+    void resize(std::size_t threads);
+
+    // Runs body once per chunk and returns when all chunks are done. The
+    // first exception thrown by a body is rethrown here.
+    void parallelFor(std::size_t count, std::size_t grain, const Body &body);
+    static std::size_t chunkCount(std::size_t count, std::size_t grain);
+
+    // The pool used by Search and Statistics.
+    static ThreadPool &shared();
+    // A thread count for resize() as accepted from LEDGER_THREADS: decimal
+    // digits only, 0 (all hardware threads) up to kMaxThreads.
+    static constexpr std::size_t kMaxThreads = 256;
+    static bool parseThreads(const std::string &text, std::size_t &threads);
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    void start(std::size_t threads);
+    void stop();
+    void push(std::function<void()> task);
+    bool runOne(std::size_t self); // false if every queue was empty
+    void work(std::size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues_; // one per worker, plus one for outside callers
+    std::vector<std::thread> workers_;
+    std::atomic<std::size_t> next_;    // round robin for outside callers
+    std::atomic<std::ptrdiff_t> queued_;
+    std::mutex sleepMutex_;
+    std::condition_variable wake_;
+    bool stopping_;
+};
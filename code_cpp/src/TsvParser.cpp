@@ -0,0 +1,208 @@
+#include "TsvParser.h"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "Record.h"
+#include "RecordStore.h"
+#include "StringPool.h"
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LEDGER_TSV_SSE2 1
+#endif
+
+const char *TsvParser::findDelimiter(const char *p, const char *end) {
+#ifdef LEDGER_TSV_SSE2
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, tab),
+                                                        _mm_cmpeq_epi8(block, newline)));
+        if (mask != 0) {
+#if defined(_MSC_VER) && !defined(__clang__)
+            unsigned long index = 0;
+            _BitScanForward(&index, static_cast<unsigned long>(mask));
+            return p + index;
+#else
+            return p + __builtin_ctz(static_cast<unsigned>(mask));
+#endif
+        }
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '\t' && *p != '\n') {
+        ++p;
+    }
+    return p;
+}
+
+std::size_t TsvParser::splitLine(std::string_view line, Fields &fields) {
+    const char *p = line.data();
+    const char *end = p + line.size();
+    std::size_t count = 0;
+    while (true) {
+        const char *delim = p;
+        while (delim < end && *delim != '\t') {
+            ++delim;
+        }
+        if (count < kFieldCount) {
+            fields[count] = std::string_view(p, static_cast<std::size_t>(delim - p));
+        }
+        ++count;
+        if (delim == end) {
+            break;
+        }
+        p = delim + 1;
+    }
+    return count < kFieldCount ? count : kFieldCount;
+}
+
+bool TsvParser::parseAmount(std::string_view text, double &amount) {
+    const char *first = text.data();
+    const char *last = first + text.size();
+    if (first != last && *first == '+') {
+        ++first;
+    }
+    const auto result = std::from_chars(first, last, amount);
+    return result.ec == std::errc() && result.ptr == last;
+}
+
+bool TsvParser::parseCents(std::string_view text, std::int64_t &cents) {
+    const char *p = text.data();
+    const char *end = p + text.size();
+    bool negative = false;
+    if (p != end && (*p == '+' || *p == '-')) {
+        negative = *p == '-';
+        ++p;
+    }
+    std::int64_t whole = 0;
+    std::size_t wholeDigits = 0;
+    while (p != end && *p >= '0' && *p <= '9' && wholeDigits < 15) {
+        whole = whole * 10 + (*p - '0');
+        ++wholeDigits;
+        ++p;
+    }
+    std::int64_t fraction = 0;
+    std::size_t fractionDigits = 0;
+    bool roundUp = false;
+    if (p != end && *p == '.') {
+        ++p;
+        for (; p != end && *p >= '0' && *p <= '9'; ++p, ++fractionDigits) {
+            if (fractionDigits < 2) {
+                fraction = fraction * 10 + (*p - '0');
+            } else if (fractionDigits == 2) {
+                roundUp = *p >= '5';
+            }
+        }
+    }
+    if (p != end || wholeDigits + fractionDigits == 0) {
+        double amount = 0.0;
+        if (!parseAmount(text, amount) || !std::isfinite(amount)) {
+            return false;
+        }
+        cents = std::llround(amount * 100.0);
+        return true;
+    }
+    if (fractionDigits == 1) {
+        fraction *= 10;
+    }
+    cents = whole * 100 + fraction + (roundUp ? 1 : 0);
+    if (negative) {
+        cents = -cents;
+    }
+    return true;
+}
+
+namespace {
+
+// Calls onFields(fields) for every well-formed line; stops when it returns false.
+template <typename F>
+std::size_t scanLines(std::string_view data, F &&onFields) {
+    const char *p = data.data();
+    const char *end = p + data.size();
+    std::size_t rejected = 0;
+    TsvParser::Fields fields;
+    while (p < end) {
+        // One pass over the line: every delimiter hit is either a field or the line end.
+        std::size_t count = 0;
+        const char *fieldStart = p;
+        const char *lineEnd = end;
+        while (true) {
+            const char *delim = TsvParser::findDelimiter(fieldStart, end);
+            const bool lastField = delim == end || *delim == '\n';
+            if (count < TsvParser::kFieldCount) {
+                const char *fieldEnd = delim;
+                if (lastField && fieldEnd > fieldStart && fieldEnd[-1] == '\r') {
+                    --fieldEnd;
+                }
+                fields[count] = std::string_view(fieldStart, static_cast<std::size_t>(fieldEnd - fieldStart));
+            }
+            ++count;
+            if (lastField) {
+                lineEnd = delim;
+                break;
+            }
+            fieldStart = delim + 1;
+        }
+        const bool emptyLine = count == 1 && fields[0].empty();
+        p = lineEnd == end ? end : lineEnd + 1;
+        if (emptyLine) {
+            continue;
+        }
+        if (count < TsvParser::kFieldCount) {
+            std::cerr << "Warning: failed to parse record line: bad record line" << std::endl;
+            ++rejected;
+            continue;
+        }
+        if (!onFields(fields)) {
+            break;
+        }
+    }
+    return rejected;
+}
+
+} // namespace
+
+std::size_t TsvParser::countLines(std::string_view data) {
+    // memchr is vectorised by the C library; a plain std::count loop is
+    // several times slower on a large ledger.
+    const char *p = data.data();
+    const char *end = p + data.size();
+    std::size_t lines = 1;
+    while ((p = static_cast<const char *>(std::memchr(p, '\n', static_cast<std::size_t>(end - p)))) != nullptr) {
+        ++lines;
+        ++p;
+    }
+    return lines;
+}
+
+std::size_t TsvParser::parseRecords(std::string_view data, std::vector<Record> &out) {
+    out.reserve(out.size() + countLines(data));
+    return scanLines(data, [&out](const Fields &fields) {
+        out.push_back(Record::fromTSVFields(fields));
+        return true;
+    });
+}
+
+std::size_t TsvParser::parseRecords(std::string_view data, RecordStore &out) {
+    // The notes are part of the data, so its size bounds their bytes; the
+    // pages of the reserve that stay unused are never touched.
+    out.reserve(out.ids().size() + countLines(data), data.size());
+    std::string utf8;
+    return scanLines(data, [&out, &utf8](const Fields &fields) {
+        out.insert(Record::columnsFromTSV(fields, utf8));
+        return true;
+    });
+}
+
+bool TsvParser::forEachRecord(std::string_view data, const std::function<bool(const Record &)> &visit) {
+    StringPool::Scratch scratch(StringPool::text());
+    bool completed = true;
+    scanLines(data, [&](const Fields &fields) {
+        completed = visit(Record::fromTSVFields(fields));
+        scratch.reset();
+        return completed;
+    });
+    return completed;
+}
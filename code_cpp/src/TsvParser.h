@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string_view>
+#include <vector>
+
+class Record;
+class RecordStore;
+
+// Zero-copy scanner for the TSV ledger: fields are views into the input buffer
+// and only the strings a Record owns get materialised.
+class TsvParser {
+public:
+    static constexpr std::size_t kFieldCount = 6;
+    using Fields = std::array<std::string_view, kFieldCount>;
+
+    // Splits one line on tabs; returns the number of fields seen (extra fields are dropped).
+    static std::size_t splitLine(std::string_view line, Fields &fields);
+    // Locale-independent; accepts an optional leading '+'.
+    static bool parseAmount(std::string_view text, double &amount);
+    // Exact for plain decimals ("-12.34"); other forms go through parseAmount.
+    // Digits past the cents are rounded half away from zero.
+    static bool parseCents(std::string_view text, std::int64_t &cents);
+    // Parses every non-empty line of a whole file; returns the number of rejected lines.
+    static std::size_t parseRecords(std::string_view data, std::vector<Record> &out);
+    // Same, straight into the store's columns: notes are copied into its heap
+    // once and no Record is built.
+    static std::size_t parseRecords(std::string_view data, RecordStore &out);
+    // Streams the records of a whole file; returns false if the visitor stopped the scan.
+    // Text ids and malformed dates the text pool has not seen live in a
+    // StringPool::Scratch that is reset after each visit.
+    static bool forEachRecord(std::string_view data, const std::function<bool(const Record &)> &visit);
+
+    // Lines in `data`, counting a last line without a newline; an upper bound on its records.
+    static std::size_t countLines(std::string_view data);
+    // First '\t' or '\n' in [p, end), or end.
+    static const char *findDelimiter(const char *p, const char *end);
+};
@@ -1,77 +1,430 @@
 #include "User.h"
 #include <algorithm>
+#include <map>
+#include "Date.h"
+#include "StringPool.h"
 #include <utility>
 
-User::User(std::string userId, std::string username)
+User::User(std::string userId, std::string username, const std::string &dataDir)
     : userId_(std::move(userId)),
       username_(std::move(username)),
       records_(),
       categories_(Category::defaultCategories()),
-      storage_("data") {
+      writer_(dataDir),
+      allSegmentsLoaded_(true) {
     load();
 }
 
+namespace {
+
+ResultCache::SearchKind cacheKind(User::SearchMode mode) {
+    switch (mode) {
+        case User::SearchMode::Keyword:
+            return ResultCache::SearchKind::Keyword;
+        case User::SearchMode::Category:
+            return ResultCache::SearchKind::Category;
+        case User::SearchMode::Time:
+            break;
+    }
+    return ResultCache::SearchKind::Time;
+}
+
+// Past this many records a batch write flushes the cache instead of checking each entry.
+constexpr std::size_t kCacheInvalidateBatch = 256;
+
+} // namespace
+
 const std::string& User::getUserId() const { return userId_; }
 const std::string& User::getUsername() const { return username_; }
 
 void User::addRecord(const Record &record, bool autoSave) {
-    records_.push_back(record);
-    std::sort(records_.begin(), records_.end(), [](const Record &lhs, const Record &rhs) {
-        if (lhs.getDate() == rhs.getDate()) {
-            return lhs.getId() < rhs.getId();
+    if (isLazy()) {
+        markSegmentDirty(Storage::segmentOf(record));
+    }
+    records_.insert(record);
+    rollups_.add(record);
+    balances_.add(record);
+    sketches_.add(record);
+    syncIndexes();
+    resultCache_.invalidate(record);
+    if (autoSave) {
+        writer_.append(record);
+    }
+}
+
+void User::addRecords(const std::vector<Record> &records, bool autoSave) {
+    if (isLazy()) {
+        std::set<std::string> segments;
+        for (const auto &record : records) {
+            segments.insert(Storage::segmentOf(record));
         }
-        return lhs.getDate() < rhs.getDate();
-    });
+        for (const auto &segment : segments) {
+            markSegmentDirty(segment);
+        }
+    }
+    records_.insert(records);
+    rollups_.add(records);
+    balances_.add(records);
+    sketches_.add(records);
+    syncIndexes();
+    if (records.size() > kCacheInvalidateBatch) {
+        resultCache_.clear();
+    } else {
+        for (const auto &record : records) {
+            resultCache_.invalidate(record);
+        }
+    }
     if (autoSave) {
-        save();
+        writer_.append(records);
     }
 }
 
-std::vector<Record> User::getRecords() const {
-    return records_;
+bool User::updateRecord(const std::string &id, const Record &record, bool autoSave) {
+    RecordStore::Slot slot = 0;
+    if (!findRecord(id, slot)) {
+        return false;
+    }
+    const auto from = records_.ids()[slot];
+    if (isLazy()) {
+        markSegmentDirty(Storage::segmentOf(record));
+    }
+    // Every copy of a duplicated id is replaced, as on journal replay, and so
+    // is any record that already has the new id.
+    auto replaced = copiesOf(from);
+    if (record.getIdValue() != from) {
+        const auto taken = copiesOf(record.getIdValue());
+        replaced.insert(replaced.end(), taken.begin(), taken.end());
+    }
+    const auto generation = records_.generation();
+    records_.update(from, record);
+    for (const auto &before : replaced) {
+        rollups_.remove(before);
+        balances_.remove(before);
+        sketches_.remove(before);
+    }
+    rollups_.add(record);
+    balances_.add(record);
+    sketches_.add(record);
+    syncIndexes();
+    invalidateCache(replaced, generation);
+    resultCache_.invalidate(record);
+    for (const auto &before : replaced) {
+        if (isLazy()) {
+            markSegmentDirty(Storage::segmentOf(before));
+        }
+        // A record that changes id or month is a tombstone in its old segment.
+        if (autoSave && (before.getIdValue() != record.getIdValue() ||
+                         Storage::segmentOf(before) != Storage::segmentOf(record))) {
+            writer_.erase(before);
+        }
+    }
+    if (autoSave) {
+        writer_.update(record);
+    }
+    return true;
 }
 
-std::vector<Record> User::getRecentRecords(std::size_t count) const {
-    std::vector<Record> recent;
-    if (records_.empty()) {
-        return recent;
+bool User::deleteRecord(const std::string &id, bool autoSave) {
+    RecordStore::Slot slot = 0;
+    if (!findRecord(id, slot)) {
+        return false;
+    }
+    // Drops every copy of a duplicated id, as the tombstone does on replay.
+    const auto erased = copiesOf(records_.ids()[slot]);
+    const auto generation = records_.generation();
+    records_.erase(records_.ids()[slot]);
+    for (const auto &before : erased) {
+        rollups_.remove(before);
+        balances_.remove(before);
+        sketches_.remove(before);
+    }
+    syncIndexes();
+    invalidateCache(erased, generation);
+    for (const auto &before : erased) {
+        if (isLazy()) {
+            markSegmentDirty(Storage::segmentOf(before));
+        }
+        if (autoSave) {
+            writer_.erase(before);
+        }
+    }
+    return true;
+}
+
+std::vector<Record> User::copiesOf(std::uint64_t id) const {
+    std::vector<Record> out;
+    for (const auto slot : records_.copies(id)) {
+        out.push_back(records_.get(slot));
     }
-    const auto startIndex = records_.size() > count ? records_.size() - count : 0;
-    for (std::size_t i = startIndex; i < records_.size(); ++i) {
-        recent.push_back(records_[i]);
+    return out;
+}
+
+void User::invalidateCache(const std::vector<Record> &written, std::uint64_t generation) const {
+    if (records_.generation() != generation) {
+        resultCache_.clear(); // the store compacted; cached slots are stale
+        return;
+    }
+    for (const auto &record : written) {
+        resultCache_.invalidate(record);
+    }
+}
+
+bool User::findRecord(const std::string &id, RecordStore::Slot &slot) const {
+    const auto value = Record::encodeId(id);
+    if (records_.find(value, slot)) {
+        return true;
+    }
+    // The record may live in a segment that is not resident yet.
+    if (!allSegmentsLoaded_) {
+        ensureAllSegmentsLoaded();
+        return records_.find(value, slot);
     }
-    return recent;
+    return false;
+}
+
+void User::syncIndexes() const {
+    keywords_.sync(records_);
+    categoryIndex_.sync(records_);
+}
+
+void User::markSegmentDirty(const std::string &segment) {
+    dirtySegments_.insert(segment);
+    if (!std::binary_search(segments_.begin(), segments_.end(), segment)) {
+        segments_.insert(std::upper_bound(segments_.begin(), segments_.end(), segment), segment);
+        loadedSegments_.insert(segment);
+        return;
+    }
+    // The writer may fold the journal into this segment's file at any time;
+    // load it before it takes writes, or a later load would add them twice.
+    ensureSegmentLoaded(segment);
+}
+
+RecordRange User::records() const {
+    ensureAllSegmentsLoaded();
+    const auto &order = records_.order();
+    return RecordRange(records_, order.data(), order.data() + order.size());
+}
+
+RecordRange User::recentRecords(std::size_t count) const {
+    if (isLazy()) {
+        // Walk back month by month until the newest `count` records are all resident.
+        for (auto it = segments_.rbegin(); it != segments_.rend(); ++it) {
+            if (*it == "undated") {
+                continue;
+            }
+            ensureSegmentLoaded(*it);
+            std::int32_t monthStart = 0;
+            Date::parsePacked(*it + "-01", monthStart);
+            if (records_.size() - records_.lowerBound(monthStart) >= count) {
+                break;
+            }
+        }
+    }
+    const auto &order = records_.order();
+    const auto start = order.size() > count ? order.size() - count : 0;
+    return RecordRange(records_, order.data() + start, order.data() + order.size());
+}
+
+std::size_t User::recordCount() const {
+    ensureAllSegmentsLoaded();
+    return records_.size();
+}
+
+std::vector<Record> User::getRecords() const {
+    return records().toRecords();
+}
+
+std::vector<Record> User::getRecentRecords(std::size_t count) const {
+    return recentRecords(count).toRecords();
 }
 
 Statistics::TimeSummary User::viewStatistics(const std::string &period,
                                              Statistics::Mode mode,
                                              std::vector<Statistics::CategorySummaryItem> *categoryItems) const {
+    // Without an output for the breakdown, category mode is the time summary.
+    const bool breakdown = mode == Statistics::Mode::Category && categoryItems != nullptr;
+    const auto cacheMode = breakdown ? Statistics::Mode::Category : Statistics::Mode::Time;
+    Statistics::TimeSummary summary;
+    if (resultCache_.findStatistics(period, cacheMode, summary, categoryItems)) {
+        return summary;
+    }
+    ensurePeriodLoaded(period);
     Statistics statistics(period, mode);
-    auto summary = statistics.generateByTime(records_);
-    if (mode == Statistics::Mode::Category && categoryItems != nullptr) {
-        *categoryItems = statistics.generateByCategory(records_);
-    } else if (mode == Statistics::Mode::Category) {
-        (void)statistics.generateByCategory(records_);
+    summary = statistics.generateByTime(rollups_);
+    std::vector<Statistics::CategorySummaryItem> items;
+    if (breakdown) {
+        items = statistics.generateByCategory(rollups_);
+    }
+    resultCache_.storeStatistics(period, cacheMode, summary, items);
+    if (categoryItems != nullptr) {
+        *categoryItems = std::move(items);
     }
     return summary;
 }
 
-std::vector<Record> User::searchRecords(const Search &searchCriteria, SearchMode mode) const {
+GroupBy::Table User::groupStatistics(const std::string &period, const GroupBy &groups) const {
+    ensurePeriodLoaded(period);
+    return Statistics(period).groupBy(records_, groups);
+}
+
+RecordList User::searchRecords(const Search &searchCriteria, SearchMode mode) const {
+    std::vector<RecordStore::Slot> cached;
+    if (resultCache_.findSearch(cacheKind(mode), searchCriteria, cached)) {
+        return RecordList(records_, std::move(cached));
+    }
+    auto results = runSearch(searchCriteria, mode);
+    resultCache_.storeSearch(cacheKind(mode), searchCriteria, results.slots());
+    return results;
+}
+
+RecordList User::runSearch(const Search &searchCriteria, SearchMode mode) const {
+    if (mode == SearchMode::Time) {
+        ensureRangeLoaded(searchCriteria.getTimeRange().first, searchCriteria.getTimeRange().second);
+    } else {
+        ensureAllSegmentsLoaded();
+    }
     switch (mode) {
         case SearchMode::Keyword:
-            return searchCriteria.searchByKeyword(records_);
+            syncIndexes(); // picks up segments loaded since the last write
+            return searchCriteria.searchByKeyword(records_, keywords_);
         case SearchMode::Category:
-            return searchCriteria.searchByCategory(records_);
+            syncIndexes();
+            return searchCriteria.searchByCategory(records_, categoryIndex_);
         case SearchMode::Time:
             return searchCriteria.searchByTime(records_);
         default:
-            return {};
+            return RecordList(records_, {});
     }
 }
 
+RecordCursor User::searchCursor(const Search &searchCriteria, SearchMode mode, RecordCursor::Page page) const {
+    std::vector<RecordStore::Slot> cached;
+    if (resultCache_.findSearch(cacheKind(mode), searchCriteria, cached)) {
+        return RecordCursor(RecordList(records_, std::move(cached)), page);
+    }
+    if (mode == SearchMode::Time) {
+        ensureRangeLoaded(searchCriteria.getTimeRange().first, searchCriteria.getTimeRange().second);
+        return searchCriteria.cursorByTime(records_, page);
+    }
+    ensureAllSegmentsLoaded();
+    syncIndexes();
+    // With `hits` matches spread over the ledger, the walk finds the wanted
+    // rows after about wanted * size / hits rows; the index touches all hits.
+    const auto walkIsShorter = [&](std::size_t hits) {
+        if (page.limit == RecordCursor::kAll || hits == 0) {
+            return false;
+        }
+        const double wanted = static_cast<double>(page.offset) + static_cast<double>(page.limit);
+        return wanted * static_cast<double>(records_.size()) < static_cast<double>(hits) * static_cast<double>(hits);
+    };
+    if (mode == SearchMode::Keyword) {
+        if (walkIsShorter(keywords_.estimate(searchCriteria.getKeyword()))) {
+            return searchCriteria.cursorByKeyword(records_, page);
+        }
+        auto results = searchCriteria.searchByKeyword(records_, keywords_);
+        resultCache_.storeSearch(ResultCache::SearchKind::Keyword, searchCriteria, results.slots());
+        return RecordCursor(std::move(results), page);
+    }
+    std::uint32_t category = 0;
+    const Bitmap *slots = StringPool::categories().find(searchCriteria.getCategory(), category)
+                              ? categoryIndex_.category(category)
+                              : nullptr;
+    if (slots != nullptr && walkIsShorter(static_cast<std::size_t>(slots->cardinality()))) {
+        return searchCriteria.cursorByCategory(records_, page);
+    }
+    auto results = searchCriteria.searchByCategory(records_, categoryIndex_);
+    resultCache_.storeSearch(ResultCache::SearchKind::Category, searchCriteria, results.slots());
+    return RecordCursor(std::move(results), page);
+}
+
+RecordList User::query(const Query &query, Query::Plan *plan) const {
+    // Segments outside the date range (all of them if it is open) cannot match.
+    ensureRangeLoaded(query.getTimeRange().first, query.getTimeRange().second);
+    syncIndexes();
+    return query.run(records_, keywords_, categoryIndex_, plan);
+}
+
+const ResultCache::Counters &User::cacheCounters() const { return resultCache_.counters(); }
+
+Statistics::Distribution User::viewDistribution(const std::string &period, const std::string &category,
+                                                Record::Type type) const {
+    ensurePeriodLoaded(period);
+    const Statistics statistics(period);
+    if (!statistics.coversWholeMonths()) {
+        return statistics.generateDistribution(records_, category, type);
+    }
+    refreshSketches();
+    return statistics.generateDistribution(sketches_, category, type);
+}
+
+Statistics::TimeSummary User::rangeTotals(const std::string &from, const std::string &to) const {
+    Statistics::TimeSummary summary;
+    summary.period = from + " ~ " + to;
+    ensureRangeLoaded(from, to);
+    std::int32_t first = 0;
+    std::int32_t last = 0;
+    BalanceIndex::Totals totals;
+    if ((from.empty() || Date::parsePacked(from, first)) && (to.empty() || Date::parsePacked(to, last))) {
+        // Open bounds become the extremes of the packed range.
+        totals = balances_.between(from.empty() ? 101 : first, to.empty() ? 99991231 : last);
+        balances_.forEachMalformed([&](std::int32_t date, const BalanceIndex::Totals &cell) {
+            if (Search::between(Record::decodeDate(date), from, to)) {
+                totals.income += cell.income;
+                totals.expense += cell.expense;
+                totals.count += cell.count;
+            }
+        });
+    } else {
+        Search search;
+        search.setTimeRange(from, to);
+        const auto matches = search.searchByTime(records_);
+        for (const auto slot : matches.slots()) {
+            const Record record = records_.get(slot);
+            (record.getType() == Record::Type::Income ? totals.income : totals.expense) += record.getCents();
+            ++totals.count;
+        }
+    }
+    summary.income = static_cast<double>(totals.income) / 100.0;
+    summary.expense = static_cast<double>(totals.expense) / 100.0;
+    summary.balance = static_cast<double>(totals.balance()) / 100.0;
+    summary.count = static_cast<std::size_t>(totals.count);
+    return summary;
+}
+
+double User::balanceAsOf(const std::string &date) const { return rangeTotals("", date).balance; }
+
+std::vector<std::pair<std::string, double>> User::balanceCurve(const std::string &from, const std::string &to,
+                                                               int stepDays) const {
+    std::vector<std::pair<std::string, double>> points;
+    std::int32_t first = 0;
+    std::int32_t last = 0;
+    if (!Date::parsePacked(from, first) || !Date::parsePacked(to, last) || first > last) {
+        return points;
+    }
+    ensureRangeLoaded("", to);
+    std::vector<std::pair<std::string, std::int64_t>> malformed;
+    balances_.forEachMalformed([&](std::int32_t date, const BalanceIndex::Totals &cell) {
+        malformed.emplace_back(Record::decodeDate(date), cell.balance());
+    });
+    const auto totals = balances_.curve(first, last, stepDays);
+    std::int32_t day = Date::packedToDayNumber(first);
+    for (const auto &point : totals) {
+        std::string date = Date::format(day);
+        std::int64_t cents = point.balance();
+        for (const auto &entry : malformed) {
+            if (entry.first <= date) {
+                cents += entry.second;
+            }
+        }
+        points.emplace_back(std::move(date), static_cast<double>(cents) / 100.0);
+        day += std::max(stepDays, 1);
+    }
+    return points;
+}
+
 void User::addCustomCategory(const std::string &name) {
     Category::addCustomCategory(categories_, name);
-    save();
+    writer_.saveCategories(categories_);
 }
 
 const std::vector<Category>& User::getCategories() const {
@@ -79,8 +432,57 @@ const std::vector<Category>& User::getCategories() const {
 }
 
 bool User::load() {
-    records_ = storage_.loadRecords();
-    auto custom = storage_.loadCategories();
+    resultCache_.clear();
+    keywords_.clear();
+    categoryIndex_.clear();
+    segments_.clear();
+    loadedSegments_.clear();
+    dirtySegments_.clear();
+    allSegmentsLoaded_ = true;
+    if (storage().getLayout() == Storage::Layout::MonthSharded) {
+        // Start with the journal, undated records and the current month only.
+        allSegmentsLoaded_ = false;
+        segments_ = storage().listSegments();
+        journalIds_.clear();
+        for (const auto &entry : storage().loadJournalEntries()) {
+            dirtySegments_.insert(Storage::segmentOf(entry.record));
+            journalIds_.insert(entry.record.getIdValue());
+        }
+        records_.clear();
+        rollups_.clear();
+        balances_.clear();
+        sketches_.clear();
+        const auto journal = storage().loadJournal();
+        records_.insert(journal);
+        rollups_.add(journal);
+        balances_.add(journal);
+        sketches_.add(journal);
+        ensureSegmentLoaded("undated");
+        ensureSegmentLoaded(Date::format(Date::today()).substr(0, 7));
+    } else {
+        // Journal entries are replayed in arrival order; the store sorts them.
+        storage().loadRecords(records_);
+        // The indexes read only the numeric columns, so these copies skip the notes.
+        std::vector<Record> records;
+        records.reserve(records_.size());
+        const auto &live = records_.live();
+        const auto &incomes = records_.incomes();
+        for (RecordStore::Slot slot = 0; slot < live.size(); ++slot) {
+            if (live[slot]) {
+                const auto type = incomes[slot] ? Record::Type::Income : Record::Type::Expense;
+                records.push_back(Record::fromColumns(records_.ids()[slot], records_.dates()[slot],
+                                                      records_.cents()[slot], type, records_.categories()[slot],
+                                                      std::string_view()));
+            }
+        }
+        rollups_.clear();
+        balances_.clear();
+        sketches_.clear();
+        rollups_.add(records);
+        balances_.add(records);
+        sketches_.add(records);
+    }
+    auto custom = storage().loadCategories();
     categories_ = Category::defaultCategories();
     for (const auto &cat : custom) {
         bool exists = false;
@@ -98,9 +500,134 @@ bool User::load() {
 }
 
 bool User::save() const {
-    bool okRecords = storage_.saveRecords(records_);
-    bool okCategories = storage_.saveCategories(categories_);
-    return okRecords && okCategories;
+    if (isLazy()) {
+        // Only segments with new records are rewritten; each is completed from disk first.
+        std::map<std::string, std::vector<Record>> parts;
+        for (const auto &segment : dirtySegments_) {
+            ensureSegmentLoaded(segment);
+            parts[segment];
+        }
+        for (std::size_t i = 0; i < records_.size(); ++i) {
+            const auto r = records_.at(i);
+            auto it = parts.find(Storage::segmentOf(r));
+            if (it != parts.end()) {
+                it->second.push_back(r);
+            }
+        }
+        writer_.saveSegments(std::move(parts));
+    } else {
+        writer_.saveAll(records_.toRecords());
+    }
+    writer_.saveCategories(categories_);
+    const bool ok = writer_.flush();
+    if (ok) {
+        dirtySegments_.clear();
+        journalIds_.clear();
+    }
+    return ok;
+}
+
+bool User::flush() const {
+    return writer_.flush();
+}
+
+void User::setDurability(StorageWriter::Durability durability, std::chrono::milliseconds groupInterval) {
+    writer_.setDurability(durability, groupInterval);
+}
+
+StorageWriter::Durability User::getDurability() const {
+    return writer_.getDurability();
+}
+
+const Storage &User::storage() const {
+    writer_.drain();
+    return writer_.storage();
+}
+
+bool User::isLazy() const {
+    return writer_.storage().getLayout() == Storage::Layout::MonthSharded;
+}
+
+void User::refreshSketches() const {
+    const std::vector<std::int32_t> stale(sketches_.stale().begin(), sketches_.stale().end());
+    const auto &order = records_.order();
+    const auto &dates = records_.dates();
+    for (const auto month : stale) {
+        std::vector<Record> records;
+        if (month < 0) {
+            for (std::size_t i = 0; i < records_.lowerBound(0); ++i) {
+                if (dates[order[i]] == month) {
+                    records.push_back(records_.get(order[i]));
+                }
+            }
+        } else {
+            const std::size_t end = records_.lowerBound(month * 100 + 100);
+            for (std::size_t i = records_.lowerBound(month * 100 + 1); i < end; ++i) {
+                records.push_back(records_.get(order[i]));
+            }
+        }
+        sketches_.rebuild(month, records);
+    }
+}
+
+void User::ensureSegmentLoaded(const std::string &segment) const {
+    if (allSegmentsLoaded_ || loadedSegments_.count(segment) != 0) {
+        return;
+    }
+    loadedSegments_.insert(segment);
+    if (std::binary_search(segments_.begin(), segments_.end(), segment)) {
+        auto records = storage().loadSegment(segment);
+        if (!journalIds_.empty()) {
+            // The journal replay already holds the current version, or a tombstone.
+            records.erase(std::remove_if(records.begin(), records.end(),
+                                         [this](const Record &r) { return journalIds_.count(r.getIdValue()) != 0; }),
+                          records.end());
+        }
+        records_.insert(records);
+        rollups_.add(records);
+        balances_.add(records);
+        sketches_.add(records);
+    }
+}
+
+void User::ensureAllSegmentsLoaded() const {
+    if (allSegmentsLoaded_) {
+        return;
+    }
+    for (const auto &segment : segments_) {
+        ensureSegmentLoaded(segment);
+    }
+    allSegmentsLoaded_ = true;
+}
+
+void User::ensurePeriodLoaded(const std::string &period) const {
+    if (allSegmentsLoaded_) {
+        return;
+    }
+    if (period.empty()) {
+        ensureAllSegmentsLoaded();
+        return;
+    }
+    // "2025" needs every 2025-xx segment, "2025-03-15" needs 2025-03.
+    for (const auto &segment : segments_) {
+        if (segment.rfind(period, 0) == 0 || period.rfind(segment, 0) == 0) {
+            ensureSegmentLoaded(segment);
+        }
+    }
+}
+
+void User::ensureRangeLoaded(const std::string &from, const std::string &to) const {
+    if (allSegmentsLoaded_) {
+        return;
+    }
+    for (const auto &segment : segments_) {
+        // Every date in segment "YYYY-MM" sorts between "YYYY-MM" and "YYYY-MM-\x7f".
+        const bool beforeRange = !from.empty() && segment + "-\x7f" < from;
+        const bool afterRange = !to.empty() && to < segment;
+        if (!beforeRange && !afterRange) {
+            ensureSegmentLoaded(segment);
+        }
+    }
 }
 
 // [IMPLANTED FLAW #4: Use After Free]
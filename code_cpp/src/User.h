@@ -1,23 +1,49 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
+#include <set>
 #include <string>
+#include <unordered_set>
+#include <utility>
 #include <vector>
+#include "BalanceIndex.h"
 #include "Category.h"
+#include "CategoryIndex.h"
+#include "NgramIndex.h"
+#include "Query.h"
 #include "Record.h"
+#include "RecordStore.h"
+#include "RecordView.h"
+#include "ResultCache.h"
+#include "RollupCube.h"
 #include "Search.h"
+#include "SketchIndex.h"
 #include "Statistics.h"
 #include "Storage.h"
+#include "StorageWriter.h"
 
 class User {
 public:
     enum class SearchMode { Keyword, Category, Time };
 
-    User(std::string userId = "user001", std::string username = "默认用户");
+    User(std::string userId = "user001", std::string username = "默认用户", const std::string &dataDir = "data");
 
     const std::string& getUserId() const;
     const std::string& getUsername() const;
 
     void addRecord(const Record &record, bool autoSave = true);
+    // Bulk import: the batch is sorted once and merged into the ledger.
+    void addRecords(const std::vector<Record> &records, bool autoSave = true);
+    // Corrections by record id: O(1) through the ledger's id index, persisted
+    // as journal Update / Delete entries. False if there is no such record.
+    bool updateRecord(const std::string &id, const Record &record, bool autoSave = true);
+    bool deleteRecord(const std::string &id, bool autoSave = true);
+    // Views into the ledger, valid until the next write to this User.
+    RecordRange records() const;
+    RecordRange recentRecords(std::size_t count) const;
+    std::size_t recordCount() const;
+    // Copying adapters over the views above.
     std::vector<Record> getRecords() const;
     std::vector<Record> getRecentRecords(std::size_t count) const;
 
@@ -25,20 +51,88 @@ public:
                                            Statistics::Mode mode,
                                            std::vector<Statistics::CategorySummaryItem> *categoryItems = nullptr) const;
 
-    std::vector<Record> searchRecords(const Search &searchCriteria, SearchMode mode) const;
+    RecordList searchRecords(const Search &searchCriteria, SearchMode mode) const;
+    // Paged and lazy: a limited page is read by walking the ledger when that
+    // is expected to touch fewer rows than collecting every indexed match.
+    RecordCursor searchCursor(const Search &searchCriteria, SearchMode mode, RecordCursor::Page page) const;
+    // Any conjunction of predicates; `plan` receives the access path taken.
+    RecordList query(const Query &query, Query::Plan *plan = nullptr) const;
+
+    // One pass over the period for any combination of GroupBy dimensions.
+    GroupBy::Table groupStatistics(const std::string &period, const GroupBy &groups) const;
+    // Median, p90 and p99 amount of one type, optionally of one category.
+    // Periods of whole months merge per-month sketches; others are exact.
+    Statistics::Distribution viewDistribution(const std::string &period, const std::string &category,
+                                              Record::Type type) const;
+    // Income, expense and balance of the records dated in [from, to] ("YYYY-MM-DD",
+    // an empty bound is open), in O(log D) through the balance index. Other
+    // bounds are compared as text over a scan, as in SearchMode::Time.
+    Statistics::TimeSummary rangeTotals(const std::string &from, const std::string &to) const;
+    double balanceAsOf(const std::string &date) const;
+    // Running balance on `from` and every `stepDays` after it up to `to`; empty
+    // unless both dates are YYYY-MM-DD.
+    std::vector<std::pair<std::string, double>> balanceCurve(const std::string &from, const std::string &to,
+                                                             int stepDays) const;
+
+    // Hit/miss counters of the statistics and search result cache.
+    const ResultCache::Counters &cacheCounters() const;
 
     void addCustomCategory(const std::string &name);
     const std::vector<Category>& getCategories() const;
 
     bool load();
+    // Queues a full save and waits for it; returns false if any write failed.
     bool save() const;
+    // Durability barrier for records added since the last save.
+    bool flush() const;
+    // When journalled writes are fsynced; see StorageWriter::Durability.
+    void setDurability(StorageWriter::Durability durability,
+                       std::chrono::milliseconds groupInterval = std::chrono::milliseconds(20));
+    StorageWriter::Durability getDurability() const;
     void processUserData();
 
 private:
     std::string userId_;
     std::string username_;
-    std::vector<Record> records_;
+    // With a month-sharded Storage only some segments are resident; the
+    // read paths below pull in the segments they need on first use.
+    mutable RecordStore records_;
+    // Indexes over records_, caught up on writes and before the reads that use them.
+    mutable NgramIndex keywords_;
+    mutable CategoryIndex categoryIndex_;
+    // Per (day, category, type) totals of the resident records, for statistics.
+    mutable RollupCube rollups_;
+    // Per-day income and expense prefix sums, for date ranges and running balances.
+    mutable BalanceIndex balances_;
+    // Amount sketches per (month, category, type), for distributions.
+    mutable SketchIndex sketches_;
+    // Repeated statistics and searches; writes drop the entries they touch.
+    mutable ResultCache resultCache_;
     std::vector<Category> categories_;
-    Storage storage_;
+    // Owns the Storage; all writes go through its background thread.
+    mutable StorageWriter writer_;
+    mutable std::vector<std::string> segments_;
+    mutable std::set<std::string> loadedSegments_;
+    mutable std::set<std::string> dirtySegments_;
+    mutable bool allSegmentsLoaded_;
+    // Ids with journal entries; their copies in the segment files are stale.
+    mutable std::unordered_set<std::uint64_t> journalIds_;
+
+    const Storage &storage() const; // drains pending writes first, without an fsync
+    void markSegmentDirty(const std::string &segment); // call before the segment takes writes
+    bool findRecord(const std::string &id, RecordStore::Slot &slot) const;
+    std::vector<Record> copiesOf(std::uint64_t id) const; // resident records with this id
+    // Drops the cache entries `written` can change, or all of them if the
+    // store compacted since `generation`.
+    void invalidateCache(const std::vector<Record> &written, std::uint64_t generation) const;
+    RecordList runSearch(const Search &searchCriteria, SearchMode mode) const; // uncached
+    void syncIndexes() const;
+    bool isLazy() const;
+    // Rebuilds the sketch months that corrections have made stale.
+    void refreshSketches() const;
+    void ensureSegmentLoaded(const std::string &segment) const;
+    void ensureAllSegmentsLoaded() const;
+    void ensurePeriodLoaded(const std::string &period) const;
+    void ensureRangeLoaded(const std::string &from, const std::string &to) const;
 };
 
@@ -1,4 +1,7 @@
+#include <cstdlib>
+#include <iostream>
 #include "MainUI.h"
+#include "ThreadPool.h"
 #ifdef _WIN32
 #include <windows.h>
 #endif
@@ -14,7 +17,26 @@ void configureConsole() {
 
 int main() {
     configureConsole();
+    // LEDGER_THREADS=1 keeps searches and reports on the calling thread.
+    if (const char *threads = std::getenv("LEDGER_THREADS")) {
+        std::size_t count = 0;
+        if (ThreadPool::parseThreads(threads, count)) {
+            ThreadPool::shared().resize(count);
+        } else {
+            std::cerr << "Warning: ignoring LEDGER_THREADS=" << threads << " (expected a number from 0 to "
+                      << ThreadPool::kMaxThreads << ")" << std::endl;
+        }
+    }
     User user("user001", "记账达人");
+    // LEDGER_FSYNC=every|group|exit picks when journalled writes are fsynced.
+    if (const char *fsync = std::getenv("LEDGER_FSYNC")) {
+        StorageWriter::Durability durability = StorageWriter::Durability::GroupCommit;
+        if (StorageWriter::parseDurability(fsync, durability)) {
+            user.setDurability(durability);
+        } else {
+            std::cerr << "Warning: ignoring LEDGER_FSYNC=" << fsync << " (expected every, group or exit)" << std::endl;
+        }
+    }
     MainUI ui(user);
     ui.run();
     return 0;
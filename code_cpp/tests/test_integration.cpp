@@ -1,11 +1,26 @@
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include "../src/BalanceIndex.h"
+#include "../src/Date.h"
+#include "../src/GroupBy.h"
+#include "../src/QuantileSketch.h"
+#include "../src/RecordStore.h"
+#include "../src/SketchIndex.h"
 #include "../src/Storage.h"
+#include "../src/StorageWriter.h"
 #include "../src/Search.h"
 #include "../src/Record.h"
 #include "../src/Category.h"
 #include "../src/Statistics.h"
+#include "../src/ThreadPool.h"
+#include "../src/User.h"
 
 // 集成测试1: Storage + Search 集成
 class StorageSearchIntegrationTest : public ::testing::Test {
@@ -178,6 +193,324 @@ TEST_F(StorageStatisticsIntegrationTest, SaveLoadAndGenerateCategorySummary) {
     EXPECT_TRUE(foundFood);
 }
 
+TEST_F(StorageStatisticsIntegrationTest, StoreStatisticsMatchRecordStatistics) {
+    ASSERT_TRUE(storage->saveRecords(records));
+    auto loaded = storage->loadRecords();
+    RecordStore store;
+    store.insert(loaded);
+
+    Statistics stats("2025-01", Statistics::Mode::Category);
+    auto fromStore = stats.generateByTime(store);
+    auto fromRecords = stats.generateByTime(loaded);
+    EXPECT_EQ(fromStore.count, fromRecords.count);
+    EXPECT_EQ(fromStore.income, fromRecords.income);
+    EXPECT_EQ(fromStore.expense, fromRecords.expense);
+
+    auto itemsFromStore = stats.generateByCategory(store);
+    auto itemsFromRecords = stats.generateByCategory(loaded);
+    ASSERT_EQ(itemsFromStore.size(), itemsFromRecords.size());
+    for (std::size_t i = 0; i < itemsFromStore.size(); ++i) {
+        EXPECT_EQ(itemsFromStore[i].category, itemsFromRecords[i].category);
+        EXPECT_EQ(itemsFromStore[i].amount, itemsFromRecords[i].amount);
+    }
+
+    // 已排序的输入按二分查找截取统计区间
+    auto sorted = loaded;
+    std::sort(sorted.begin(), sorted.end(), Record::less);
+    for (const std::string period : {"2025-01", "2025", "2025-01-15", "2024", ""}) {
+        stats.setPeriod(period);
+        auto expected = stats.generateByTime(loaded, RecordOrder::Unsorted);
+        auto narrowed = stats.generateByTime(sorted, RecordOrder::Sorted);
+        EXPECT_EQ(narrowed.count, expected.count) << period;
+        EXPECT_EQ(narrowed.income, expected.income) << period;
+        EXPECT_EQ(stats.generateByTime(store).count, expected.count) << period;
+        EXPECT_EQ(stats.generateByCategory(sorted, RecordOrder::Sorted).size(),
+                  stats.generateByCategory(loaded).size()) << period;
+    }
+}
+
+TEST_F(StorageStatisticsIntegrationTest, ParallelResultsMatchSingleThreaded) {
+    // 足够多的记录才会拆成多个分块
+    std::vector<Record> many;
+    const char *categories[] = {"餐饮", "交通", "工资"};
+    for (int i = 0; i < 60000; ++i) {
+        const std::string date = i % 997 == 0 ? "2025/06/01"
+                                              : "2025-0" + std::to_string(i % 9 + 1) + "-1" + std::to_string(i % 10);
+        many.emplace_back("p" + std::to_string(i), date, (i % 1000) / 100.0 + 0.01,
+                          i % 4 ? Record::Type::Expense : Record::Type::Income, categories[i % 3],
+                          i % 13 ? "日常" : "午餐");
+    }
+    auto sorted = many;
+    std::sort(sorted.begin(), sorted.end(), Record::less);
+    RecordStore store;
+    store.insert(many);
+
+    const auto snapshot = [&] {
+        std::vector<std::string> out;
+        Search search;
+        search.setKeyword("午餐");
+        search.setCategory("交通");
+        search.setTimeRange("2025-03-01", "2025-06-30");
+        for (const auto &list : {search.searchByKeyword(store), search.searchByCategory(store), search.searchByTime(store)}) {
+            out.push_back(std::to_string(list.size()) + (list.empty() ? "" : list[list.size() / 2].getId()));
+        }
+        for (const auto &list : {search.searchByKeyword(many), search.searchByTime(sorted, RecordOrder::Sorted)}) {
+            out.push_back(std::to_string(list.size()) + list.front().getId() + list.back().getId());
+        }
+        for (const std::string period : {"", "2025-04", "2025/06"}) {
+            Statistics stats(period, Statistics::Mode::Time);
+            for (const auto &summary : {stats.generateByTime(store), stats.generateByTime(sorted, RecordOrder::Sorted)}) {
+                std::ostringstream oss;
+                oss.precision(17);
+                oss << summary.count << ' ' << summary.income << ' ' << summary.expense;
+                out.push_back(oss.str());
+            }
+            for (const auto &item : stats.generateByCategory(store)) {
+                std::ostringstream oss;
+                oss.precision(17);
+                oss << item.category << ' ' << item.amount << ' ' << item.percentage;
+                out.push_back(oss.str());
+            }
+        }
+        return out;
+    };
+
+    ThreadPool &pool = ThreadPool::shared();
+    const std::size_t threads = pool.threads();
+    pool.resize(1);
+    const auto single = snapshot();
+    pool.resize(4);
+    const auto parallel = snapshot();
+    pool.resize(threads);
+    EXPECT_EQ(parallel, single);
+    // 与逐条判断的结果一致
+    const auto inRange = std::count_if(many.begin(), many.end(), [](const Record &record) {
+        return record.getDate() >= "2025-03-01" && record.getDate() <= "2025-06-30";
+    });
+    EXPECT_EQ(single[2].substr(0, single[2].find('p')), std::to_string(inRange));
+}
+
+TEST_F(StorageStatisticsIntegrationTest, RollupCubeMatchesRecordScans) {
+    std::vector<Record> ledger = records;
+    for (int i = 0; i < 300; ++i) {
+        const std::string date = i % 37 == 0 ? "2025-02-3x" : "202" + std::to_string(4 + i % 2) + "-0" +
+                                 std::to_string(1 + i % 3) + "-1" + std::to_string(i % 10);
+        ledger.emplace_back("u" + std::to_string(i), date, 0.01 * (i * 7 % 1000), i % 5 ? Record::Type::Expense
+                                                                                        : Record::Type::Income,
+                            i % 2 ? "餐饮" : "交通", "");
+    }
+    RollupCube cube;
+    cube.add(ledger);
+    // 增删改之后，立方体仍与逐条扫描一致
+    for (std::size_t i = 0; i < ledger.size(); i += 3) {
+        cube.remove(ledger[i]);
+        if (i % 2 == 0) {
+            ledger[i] = Record(ledger[i].getId(), "2025-03-0" + std::to_string(1 + i % 9), 1.5, Record::Type::Income,
+                               "工资", "");
+            cube.add(ledger[i]);
+        } else {
+            ledger[i] = ledger.back();
+            ledger.pop_back();
+        }
+    }
+    for (const std::string period : {"", "2025", "2024", "2025-02", "2025-03", "2025-01-01", "2025-02-3", "2025-0", "1999"}) {
+        Statistics stats(period, Statistics::Mode::Category);
+        const auto expected = stats.generateByTime(ledger);
+        const auto fromCube = stats.generateByTime(cube);
+        EXPECT_EQ(fromCube.count, expected.count) << period;
+        EXPECT_EQ(fromCube.income, expected.income) << period;
+        EXPECT_EQ(fromCube.expense, expected.expense) << period;
+        const auto items = stats.generateByCategory(cube);
+        const auto expectedItems = stats.generateByCategory(ledger);
+        ASSERT_EQ(items.size(), expectedItems.size()) << period;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            EXPECT_EQ(items[i].category, expectedItems[i].category) << period;
+            EXPECT_EQ(items[i].amount, expectedItems[i].amount) << period;
+        }
+    }
+}
+
+TEST_F(StorageStatisticsIntegrationTest, BalanceIndexMatchesRangeScans) {
+    // 日期先向后、再向前（补记旧账）跨越多年，迫使树在两个方向上扩容
+    std::vector<Record> ledger;
+    BalanceIndex index;
+    for (int i = 0; i < 400; ++i) {
+        const std::int32_t day = Date::fromCivil(2025, 1, 1) + (i < 200 ? i * 7 : (200 - i) * 11);
+        ledger.emplace_back("b" + std::to_string(i), Date::format(day), 0.01 * (i * 37 % 5000),
+                            i % 3 ? Record::Type::Expense : Record::Type::Income, "其他", "");
+        index.add(ledger.back());
+    }
+    for (std::size_t i = 0; i < ledger.size(); i += 5) {
+        index.remove(ledger[i]);
+        ledger[i] = ledger.back();
+        ledger.pop_back();
+    }
+    auto scan = [&](const std::string &from, const std::string &to) {
+        BalanceIndex::Totals totals;
+        for (const auto &record : ledger) {
+            if (record.getDate() >= from && record.getDate() <= to) {
+                (record.getType() == Record::Type::Income ? totals.income : totals.expense) += record.getCents();
+                ++totals.count;
+            }
+        }
+        return totals;
+    };
+    for (const auto &range : std::vector<std::pair<std::string, std::string>> {
+             {"2025-01-01", "2025-01-01"}, {"2019-06-01", "2025-12-31"}, {"2000-01-01", "2099-12-31"},
+             {"2026-03-01", "2024-01-01"}, {"2023-02-28", "2023-03-01"}}) {
+        std::int32_t from = 0;
+        std::int32_t to = 0;
+        ASSERT_TRUE(Date::parsePacked(range.first, from) && Date::parsePacked(range.second, to));
+        const auto expected = scan(range.first, range.second);
+        const auto totals = index.between(from, to);
+        EXPECT_EQ(totals.income, expected.income) << range.first;
+        EXPECT_EQ(totals.expense, expected.expense) << range.first;
+        EXPECT_EQ(totals.count, expected.count) << range.first;
+        EXPECT_EQ(index.asOf(to).balance(), scan("", range.second).balance()) << range.second;
+    }
+}
+
+TEST_F(StorageStatisticsIntegrationTest, GroupByMatchesPerPeriodReports) {
+    std::vector<Record> ledger = records;
+    for (int i = 0; i < 500; ++i) {
+        const std::string date = i % 41 == 0 ? "2025-0x-01" : Date::format(Date::fromCivil(2024, 11, 1) + i);
+        ledger.emplace_back("g" + std::to_string(i), date, 0.01 * (i * 13 % 900 + 1),
+                            i % 4 ? Record::Type::Expense : Record::Type::Income, i % 3 ? "餐饮" : "交通", "");
+    }
+    std::sort(ledger.begin(), ledger.end(), Record::less);
+    const GroupBy groups({GroupBy::Dimension::Month, GroupBy::Dimension::Category, GroupBy::Dimension::Type});
+    // 一次扫描得到全年十二个月，与逐月报表一致
+    const auto table = Statistics("2025").groupBy(ledger, RecordOrder::Sorted, groups);
+    const auto pivot = groups.pivot(table, GroupBy::Dimension::Month, GroupBy::Dimension::Category);
+    ASSERT_EQ(pivot.rows.size(), 13); // 十二个月加上文本匹配 "2025" 的非标准日期
+    EXPECT_EQ(pivot.rows[0], 0);
+    for (std::size_t r = 1; r < pivot.rows.size(); ++r) {
+        const std::string month = GroupBy::label(GroupBy::Dimension::Month, pivot.rows[r]);
+        const auto summary = Statistics(month).generateByTime(ledger);
+        std::int64_t income = 0;
+        std::int64_t expense = 0;
+        std::size_t count = 0;
+        for (std::size_t c = 0; c < pivot.columns.size(); ++c) {
+            income += pivot.at(r, c).income;
+            expense += pivot.at(r, c).expense;
+            count += pivot.at(r, c).count;
+        }
+        EXPECT_EQ(count, summary.count) << month;
+        EXPECT_EQ(static_cast<double>(income) / 100.0, summary.income) << month;
+        EXPECT_EQ(static_cast<double>(expense) / 100.0, summary.expense) << month;
+    }
+    std::size_t total = 0;
+    for (const auto &row : groups.rows(table)) {
+        total += row.cell.count;
+    }
+    EXPECT_EQ(total, Statistics("2025").generateByTime(ledger).count);
+
+    // 列存储上的结果与向量相同
+    RecordStore store;
+    store.insert(ledger);
+    EXPECT_EQ(Statistics("2025").groupBy(store, groups).size(), table.size());
+
+    // ISO 周与星期
+    const GroupBy weeks({GroupBy::Dimension::IsoWeek, GroupBy::Dimension::Weekday});
+    EXPECT_EQ(GroupBy::label(GroupBy::Dimension::IsoWeek, static_cast<std::int64_t>(weeks.timeKey(20241230) & 0xfffff)),
+              "2025-W01");
+    EXPECT_EQ(weeks.timeKey(20210103) & 0xfffff, 202053);
+    EXPECT_EQ(weeks.timeKey(20210103) >> 20, 7);
+    EXPECT_THROW(GroupBy({GroupBy::Dimension::Day, GroupBy::Dimension::Category, GroupBy::Dimension::Month}),
+                 std::invalid_argument);
+    EXPECT_THROW(GroupBy({GroupBy::Dimension::Type, GroupBy::Dimension::Type}), std::invalid_argument);
+}
+
+TEST_F(StorageStatisticsIntegrationTest, QuantileSketchesMatchSortedAmounts) {
+    std::mt19937 rng(7);
+    std::vector<std::int64_t> values;
+    QuantileSketch whole;
+    QuantileSketch halves[2];
+    for (int i = 0; i < 100000; ++i) {
+        // 长尾分布：大部分小额，少量大额
+        const std::int64_t cents = static_cast<std::int64_t>(std::exp(rng() % 1000 / 100.0)) + rng() % 100;
+        values.push_back(cents);
+        whole.add(cents);
+        halves[i % 2].add(cents);
+    }
+    halves[0].merge(halves[1]);
+    std::sort(values.begin(), values.end());
+    // 返回值在排序数组中的名次与目标名次相差不超过 2%
+    auto rankError = [&](std::int64_t value, double q) {
+        const auto low = std::lower_bound(values.begin(), values.end(), value) - values.begin();
+        const auto high = std::upper_bound(values.begin(), values.end(), value) - values.begin();
+        const double target = q * static_cast<double>(values.size());
+        if (target >= low && target <= high) {
+            return 0.0;
+        }
+        return std::min(std::abs(target - low), std::abs(target - high)) / static_cast<double>(values.size());
+    };
+    for (const double q : {0.01, 0.5, 0.9, 0.99}) {
+        EXPECT_LE(rankError(whole.quantile(q), q), 0.02) << q;
+        EXPECT_LE(rankError(halves[0].quantile(q), q), 0.02) << q;
+    }
+    EXPECT_EQ(halves[0].count(), values.size());
+    EXPECT_EQ(halves[0].max(), values.back());
+    EXPECT_LT(whole.retained(), 2000);
+
+    // 少于 k 个值时是精确的
+    QuantileSketch small;
+    for (int i = 100; i >= 1; --i) {
+        small.add(i);
+    }
+    EXPECT_EQ(small.quantile(0.5), 50);
+    EXPECT_EQ(small.quantile(0.9), 90);
+    EXPECT_EQ(small.quantile(0.99), 99);
+}
+
+TEST_F(StorageStatisticsIntegrationTest, SketchDistributionMatchesExactOverMonths) {
+    std::vector<Record> ledger;
+    for (int i = 0; i < 6000; ++i) {
+        const std::string date = i % 500 == 0 ? "2025-xx" : Date::format(Date::fromCivil(2025, 1, 1) + i % 365);
+        ledger.emplace_back("q" + std::to_string(i), date, 0.01 * (i * 7919 % 20000 + 1),
+                            i % 10 ? Record::Type::Expense : Record::Type::Income, i % 3 ? "餐饮" : "购物", "");
+    }
+    RecordStore store;
+    store.insert(ledger);
+    SketchIndex index;
+    index.add(ledger);
+    for (const std::string period : {"", "2025", "2025-03", "2025-1", "2025-x"}) {
+        for (const std::string category : {"", "餐饮"}) {
+            const Statistics stats(period);
+            ASSERT_TRUE(stats.coversWholeMonths());
+            const auto exact = stats.generateDistribution(store, category, Record::Type::Expense);
+            const auto sketched = stats.generateDistribution(index, category, Record::Type::Expense);
+            EXPECT_EQ(sketched.count, exact.count) << period;
+            EXPECT_DOUBLE_EQ(sketched.mean, exact.mean) << period;
+            EXPECT_EQ(sketched.max, exact.max) << period;
+            // 金额近似均匀分布在 0.01..200 之间，名次误差 2% 约合 4 元
+            EXPECT_NEAR(sketched.median, exact.median, 4.0) << period << category;
+            EXPECT_NEAR(sketched.p90, exact.p90, 4.0) << period << category;
+        }
+    }
+    EXPECT_FALSE(Statistics("2025-03-01").coversWholeMonths());
+    EXPECT_EQ(Statistics("2025-03").generateDistribution(store, "不存在", Record::Type::Expense).count, 0);
+}
+
+TEST_F(StorageStatisticsIntegrationTest, PeriodRangesAndExactSums) {
+    std::vector<Record> cents;
+    for (int i = 0; i < 10; ++i) {
+        cents.emplace_back("c" + std::to_string(i), "2024-12-31", 0.1, Record::Type::Expense, "其他", "");
+    }
+    cents.emplace_back("c10", "2024/12/31", 0.2, Record::Type::Expense, "其他", "非标准日期");
+    ASSERT_TRUE(storage->saveRecords(cents));
+    auto loaded = storage->loadRecords();
+
+    // 按分累加：十个 0.1 恰好等于 1
+    Statistics year("2024", Statistics::Mode::Time);
+    auto summary = year.generateByTime(loaded);
+    EXPECT_EQ(summary.count, 11);
+    EXPECT_EQ(summary.expense, 1.2);
+
+    Statistics day("2024-12-31", Statistics::Mode::Time);
+    EXPECT_EQ(day.generateByTime(loaded).count, 10);
+}
+
 TEST_F(StorageStatisticsIntegrationTest, SaveLoadAndGenerateFullPeriodSummary) {
     // 保存记录
     ASSERT_TRUE(storage->saveRecords(records));
@@ -217,3 +550,348 @@ TEST_F(StorageStatisticsIntegrationTest, SaveLoadCategoriesAndUseInStatistics) {
     EXPECT_TRUE(foundCustom);
 }
 
+
+// 集成测试3: User + 按月分片存储（懒加载）
+class UserShardedStorageIntegrationTest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        testDir = "tmp_test_integration3";
+        std::filesystem::remove_all(testDir);
+        Storage storage(testDir);
+        storage.setLayout(Storage::Layout::MonthSharded);
+        std::vector<Record> records;
+        records.emplace_back("r1", "2024-12-31", 10.0, Record::Type::Expense, "餐饮", "去年");
+        records.emplace_back("r2", "2025-01-01", 100.0, Record::Type::Income, "工资", "一月工资");
+        records.emplace_back("r3", "2025-01-15", 50.0, Record::Type::Expense, "餐饮", "午餐");
+        records.emplace_back("r4", "2025-02-01", 200.0, Record::Type::Income, "奖金", "年终奖");
+        ASSERT_TRUE(storage.saveRecords(records));
+    }
+
+    void TearDown() override {
+        std::filesystem::remove_all(testDir);
+    }
+
+    std::string testDir;
+};
+
+TEST_F(UserShardedStorageIntegrationTest, StatisticsLoadOnlyRequestedMonth) {
+    User user("u1", "测试", testDir);
+    auto summary = user.viewStatistics("2025-01", Statistics::Mode::Time);
+    EXPECT_DOUBLE_EQ(summary.income, 100.0);
+    EXPECT_DOUBLE_EQ(summary.expense, 50.0);
+    EXPECT_EQ(summary.count, 2);
+
+    auto year = user.viewStatistics("2025", Statistics::Mode::Time);
+    EXPECT_EQ(year.count, 3);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, RecentRecordsAndTimeSearchLoadOnDemand) {
+    User user("u1", "测试", testDir);
+    auto recent = user.getRecentRecords(2);
+    ASSERT_EQ(recent.size(), 2);
+    EXPECT_EQ(recent[0].getId(), "r3");
+    EXPECT_EQ(recent[1].getId(), "r4");
+
+    Search search;
+    search.setTimeRange("2024-12-01", "2025-01-01");
+    auto results = user.searchRecords(search, User::SearchMode::Time);
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0].getId(), "r1");
+    EXPECT_EQ(user.getRecords().size(), 4);
+    EXPECT_EQ(user.recordCount(), 4);
+    auto view = user.recentRecords(3);
+    ASSERT_EQ(view.size(), 3);
+    EXPECT_EQ(view[0].getId(), "r2");
+    EXPECT_EQ(view[2].getNote(), "年终奖");
+}
+
+TEST_F(UserShardedStorageIntegrationTest, SearchCursorPagesNewestFirst) {
+    User user("u1", "测试", testDir);
+    Search search;
+    search.setCategory("餐饮");
+    RecordCursor::Page page;
+    page.newestFirst = true;
+    page.limit = 1;
+    // 最近的一条餐饮记录
+    auto cursor = user.searchCursor(search, User::SearchMode::Category, page);
+    auto latest = cursor.take();
+    ASSERT_EQ(latest.size(), 1);
+    EXPECT_EQ(latest[0].getId(), "r3");
+    EXPECT_TRUE(cursor.done());
+
+    search.setTimeRange("2024-12-01", "2025-01-31");
+    page.offset = 1;
+    page.limit = RecordCursor::kAll;
+    auto older = user.searchCursor(search, User::SearchMode::Time, page).take();
+    ASSERT_EQ(older.size(), 2);
+    EXPECT_EQ(older[0].getId(), "r2");
+    EXPECT_EQ(older[1].getId(), "r1");
+}
+
+TEST_F(UserShardedStorageIntegrationTest, ResultCacheInvalidatesOnlyTouchedEntries) {
+    User user("u1", "测试", testDir);
+    const auto january = user.viewStatistics("2025-01", Statistics::Mode::Time);
+    user.viewStatistics("2025-01", Statistics::Mode::Time);
+    EXPECT_EQ(user.cacheCounters().hits, 1);
+    EXPECT_EQ(user.cacheCounters().misses, 1);
+
+    Search dining;
+    dining.setCategory("餐饮");
+    ASSERT_EQ(user.searchRecords(dining, User::SearchMode::Category).size(), 2);
+    Search lunch;
+    lunch.setKeyword("午餐");
+    ASSERT_EQ(user.searchRecords(lunch, User::SearchMode::Keyword).size(), 1);
+
+    // 二月的工资记录既不在一月，也不是餐饮或午餐：三个结果都保留
+    user.addRecord(Record("r5", "2025-02-20", 300.0, Record::Type::Income, "工资", "二月工资"), false);
+    EXPECT_EQ(user.cacheCounters().invalidations, 0);
+    EXPECT_EQ(user.viewStatistics("2025-01", Statistics::Mode::Time).income, january.income);
+    EXPECT_EQ(user.searchRecords(dining, User::SearchMode::Category).size(), 2);
+    EXPECT_EQ(user.cacheCounters().hits, 3);
+
+    // 一月的餐饮记录改金额：一月统计和餐饮搜索失效，重新计算后结果正确
+    ASSERT_TRUE(user.updateRecord("r3", Record("r3", "2025-01-15", 80.0, Record::Type::Expense, "餐饮", "午餐"), false));
+    EXPECT_EQ(user.cacheCounters().invalidations, 3);
+    EXPECT_DOUBLE_EQ(user.viewStatistics("2025-01", Statistics::Mode::Time).expense, 80.0);
+    ASSERT_TRUE(user.deleteRecord("r1", false));
+    const auto remaining = user.searchRecords(dining, User::SearchMode::Category);
+    ASSERT_EQ(remaining.size(), 1);
+    EXPECT_EQ(remaining[0].getId(), "r3");
+    user.searchCursor(dining, User::SearchMode::Category, RecordCursor::Page());
+    EXPECT_EQ(user.cacheCounters().hits, 4);
+
+    // 重新加载后全部作废
+    ASSERT_TRUE(user.load());
+    const auto misses = user.cacheCounters().misses;
+    user.searchRecords(dining, User::SearchMode::Category);
+    EXPECT_EQ(user.cacheCounters().misses, misses + 1);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, RangeTotalsAndRunningBalance) {
+    User user("u1", "测试", testDir);
+    auto january = user.rangeTotals("2025-01-01", "2025-01-31");
+    EXPECT_DOUBLE_EQ(january.income, 100.0);
+    EXPECT_DOUBLE_EQ(january.expense, 50.0);
+    EXPECT_EQ(january.count, 2);
+    EXPECT_DOUBLE_EQ(user.balanceAsOf("2025-01-31"), 40.0);
+
+    // 补记一笔旧账和一条非标准日期：之后的余额都随之变化
+    user.addRecord(Record("r5", "2024-06-01", 5.0, Record::Type::Income, "其他", "补记"), false);
+    user.addRecord(Record("r6", "2025-01-1x", 1.0, Record::Type::Expense, "其他", "手写日期"), false);
+    EXPECT_DOUBLE_EQ(user.balanceAsOf("2025-01-31"), 44.0);
+    EXPECT_EQ(user.rangeTotals("", "").count, 6);
+    // 非 YYYY-MM-DD 的边界按文本比较
+    EXPECT_EQ(user.rangeTotals("2025-01", "2025-01-2").count, 3);
+
+    const auto curve = user.balanceCurve("2024-12-30", "2025-02-03", 7);
+    ASSERT_EQ(curve.size(), 6);
+    EXPECT_EQ(curve[0].first, "2024-12-30");
+    EXPECT_DOUBLE_EQ(curve[0].second, 5.0);
+    EXPECT_DOUBLE_EQ(curve[1].second, 95.0);
+    EXPECT_DOUBLE_EQ(curve[5].second, 244.0);
+    ASSERT_TRUE(user.deleteRecord("r4", false));
+    EXPECT_DOUBLE_EQ(user.balanceCurve("2025-02-03", "2025-02-03", 1)[0].second, 44.0);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, DistributionFollowsCorrections) {
+    User user("u1", "测试", testDir);
+    user.addRecord(Record("r5", "2025-01-20", 20.0, Record::Type::Expense, "餐饮", "早餐"), false);
+    user.addRecord(Record("r6", "2025-01-25", 30.0, Record::Type::Expense, "餐饮", "晚餐"), false);
+    auto january = user.viewDistribution("2025-01", "餐饮", Record::Type::Expense);
+    EXPECT_EQ(january.count, 3);
+    EXPECT_DOUBLE_EQ(january.median, 30.0);
+    EXPECT_DOUBLE_EQ(january.max, 50.0);
+    EXPECT_DOUBLE_EQ(january.mean, 100.0 / 3);
+
+    // 修改和删除让一月的草图失效，查询前从账本重建
+    ASSERT_TRUE(user.updateRecord("r3", Record("r3", "2025-01-15", 5.0, Record::Type::Expense, "餐饮", "午餐"), false));
+    ASSERT_TRUE(user.deleteRecord("r6", false));
+    january = user.viewDistribution("2025-01", "餐饮", Record::Type::Expense);
+    EXPECT_EQ(january.count, 2);
+    EXPECT_DOUBLE_EQ(january.median, 5.0);
+    EXPECT_DOUBLE_EQ(january.max, 20.0);
+
+    // 单日期间不是整月，走精确路径
+    const auto day = user.viewDistribution("2025-01-20", "", Record::Type::Expense);
+    EXPECT_EQ(day.count, 1);
+    EXPECT_DOUBLE_EQ(day.p99, 20.0);
+    EXPECT_EQ(user.viewDistribution("", "", Record::Type::Expense).count, 3);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, SaveRewritesOnlyTouchedSegments) {
+    {
+        User user("u1", "测试", testDir);
+        user.addRecord(Record("r5", "2025-01-20", 5.0, Record::Type::Expense, "交通", "地铁"), true);
+        EXPECT_TRUE(user.save());
+    }
+    Storage storage(testDir);
+    EXPECT_EQ(storage.loadSegment("2025-01").size(), 3);
+    EXPECT_EQ(storage.loadSegment("2025-02").size(), 1);
+    EXPECT_EQ(storage.journalSize(), 0u);
+
+    User reloaded("u1", "测试", testDir);
+    EXPECT_EQ(reloaded.getRecords().size(), 5);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, BatchAddRecordsMergesAndPersists) {
+    {
+        User user("u1", "测试", testDir);
+        // 批量导入的顺序与账本顺序无关
+        user.addRecords({Record("r7", "2025-03-02", 7.0, Record::Type::Expense, "交通", ""),
+                         Record("r0", "2024-11-30", 1.0, Record::Type::Expense, "餐饮", ""),
+                         Record("r6", "2025-01-10", 6.0, Record::Type::Expense, "交通", "")});
+        auto all = user.getRecords();
+        ASSERT_EQ(all.size(), 7);
+        EXPECT_EQ(all.front().getId(), "r0");
+        EXPECT_EQ(all[3].getId(), "r6");
+        EXPECT_EQ(all.back().getId(), "r7");
+        EXPECT_TRUE(user.save());
+    }
+    Storage storage(testDir);
+    EXPECT_EQ(storage.loadSegment("2024-11").size(), 1);
+    EXPECT_EQ(storage.loadSegment("2025-03").size(), 1);
+    EXPECT_EQ(storage.loadSegment("2025-01").size(), 3);
+
+    User reloaded("u1", "测试", testDir);
+    EXPECT_EQ(reloaded.getRecords().size(), 7);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, CompactionIntoUnloadedSegmentKeepsCount) {
+    {
+        User user("u1", "测试", testDir);
+        // 追加到尚未加载的 2024-12 分片，日志超过阈值后会被写线程压缩进该分片
+        std::vector<Record> batch;
+        for (int i = 0; i < 90000; ++i) {
+            batch.emplace_back("c" + std::to_string(i), "2024-12-" + std::string(i % 28 < 9 ? "0" : "") +
+                                                            std::to_string(i % 28 + 1),
+                               1.0, Record::Type::Expense, "餐饮", "批量导入的备注");
+        }
+        user.addRecords(batch);
+        ASSERT_TRUE(user.flush());
+        EXPECT_EQ(Storage(testDir).journalSize(), 0u);
+        EXPECT_EQ(user.recordCount(), 90004);
+        EXPECT_EQ(user.viewStatistics("2024-12", Statistics::Mode::Time).count, 90001);
+    }
+    User reloaded("u1", "测试", testDir);
+    EXPECT_EQ(reloaded.recordCount(), 90004);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, DurabilityPolicyIsSetThroughUser) {
+    // 与 main.cpp 中的 LEDGER_FSYNC 取值一致
+    const char *names[] = {"every", "group", "exit"};
+    int n = 0;
+    for (const char *name : names) {
+        StorageWriter::Durability durability = StorageWriter::Durability::GroupCommit;
+        ASSERT_TRUE(StorageWriter::parseDurability(name, durability));
+        {
+            User user("u1", "测试", testDir);
+            user.setDurability(durability, std::chrono::milliseconds(5));
+            EXPECT_EQ(user.getDurability(), durability);
+            user.addRecord(Record("d" + std::to_string(n++), "2025-02-03", 1.0, Record::Type::Expense, "交通", name));
+            EXPECT_TRUE(user.flush());
+        }
+        User reloaded("u1", "测试", testDir);
+        EXPECT_EQ(reloaded.recordCount(), 4u + n);
+    }
+    StorageWriter::Durability durability = StorageWriter::Durability::OnExit;
+    EXPECT_FALSE(StorageWriter::parseDurability("sometimes", durability));
+    EXPECT_EQ(durability, StorageWriter::Durability::OnExit);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, DuplicateIdsStayConsistentAcrossReload) {
+    {
+        // 账本里 r3 有两份副本
+        Storage storage(testDir);
+        auto records = storage.loadRecords();
+        records.emplace_back("r3", "2025-01-20", 60.0, Record::Type::Expense, "餐饮", "重复");
+        ASSERT_TRUE(storage.saveRecords(records));
+    }
+    {
+        User user("u1", "测试", testDir);
+        EXPECT_EQ(user.recordCount(), 5);
+        ASSERT_TRUE(user.updateRecord("r3", Record("r3", "2025-01-15", 70.0, Record::Type::Expense, "餐饮", "午餐")));
+        EXPECT_EQ(user.recordCount(), 4);
+        EXPECT_DOUBLE_EQ(user.viewStatistics("2025-01", Statistics::Mode::Time).expense, 70.0);
+        ASSERT_TRUE(user.flush());
+    }
+    {
+        User reloaded("u1", "测试", testDir);
+        EXPECT_EQ(reloaded.recordCount(), 4);
+        EXPECT_DOUBLE_EQ(reloaded.viewStatistics("2025-01", Statistics::Mode::Time).expense, 70.0);
+        ASSERT_TRUE(reloaded.deleteRecord("r3"));
+        EXPECT_EQ(reloaded.recordCount(), 3);
+        ASSERT_TRUE(reloaded.flush());
+    }
+    User reloaded("u1", "测试", testDir);
+    EXPECT_EQ(reloaded.recordCount(), 3);
+}
+
+TEST_F(UserShardedStorageIntegrationTest, UpdateAndDeleteAreJournalledTombstones) {
+    {
+        User user("u1", "测试", testDir);
+        EXPECT_TRUE(user.updateRecord("r3", Record("r3", "2025-01-15", 55.0, Record::Type::Expense, "餐饮", "午餐")));
+        // r1 所在的 2024-12 分段尚未加载，按 id 查找时才补齐
+        EXPECT_TRUE(user.deleteRecord("r1"));
+        EXPECT_TRUE(user.updateRecord("r4", Record("r4", "2025-03-01", 200.0, Record::Type::Income, "奖金", "年终奖")));
+        EXPECT_FALSE(user.deleteRecord("r9"));
+        EXPECT_TRUE(user.flush());
+
+        auto summary = user.viewStatistics("2025-01", Statistics::Mode::Time);
+        EXPECT_DOUBLE_EQ(summary.expense, 55.0);
+        // 分类统计走位图索引，同样看到修改后的结果
+        std::vector<Statistics::CategorySummaryItem> items;
+        user.viewStatistics("2025", Statistics::Mode::Category, &items);
+        ASSERT_EQ(items.size(), 3);
+        EXPECT_EQ(items[0].category, "奖金");
+        EXPECT_DOUBLE_EQ(items[2].amount, 55.0);
+        user.viewStatistics("2025-03", Statistics::Mode::Category, &items);
+        ASSERT_EQ(items.size(), 1);
+        EXPECT_EQ(user.recordCount(), 3);
+        EXPECT_EQ(user.recentRecords(1).toRecords()[0].getDate(), "2025-03-01");
+    }
+    // 修改和删除只写日志，不重写分段
+    Storage storage(testDir);
+    EXPECT_GT(storage.journalSize(), 0u);
+    EXPECT_EQ(storage.loadSegment("2024-12").size(), 1);
+
+    User reloaded("u1", "测试", testDir);
+    auto all = reloaded.getRecords();
+    ASSERT_EQ(all.size(), 3);
+    EXPECT_EQ(all[0].getId(), "r2");
+    EXPECT_DOUBLE_EQ(all[1].getAmount(), 55.0);
+    EXPECT_EQ(all[2].getDate(), "2025-03-01");
+    EXPECT_DOUBLE_EQ(reloaded.viewStatistics("2025-02", Statistics::Mode::Time).income, 0.0);
+
+    EXPECT_TRUE(reloaded.save());
+    EXPECT_EQ(Storage(testDir).loadRecords(), all);
+}
+
+// 集成测试4: 流式扫描 + Search/Statistics（不把账本整体加载进内存）
+TEST_F(StorageStatisticsIntegrationTest, StreamingStatisticsMatchVectorResults) {
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    Statistics stats("2025-01", Statistics::Mode::Category);
+    auto streamed = stats.generateByTime(storage->recordSource());
+    auto loaded = stats.generateByTime(storage->loadRecords());
+    EXPECT_DOUBLE_EQ(streamed.income, loaded.income);
+    EXPECT_DOUBLE_EQ(streamed.expense, loaded.expense);
+    EXPECT_EQ(streamed.count, loaded.count);
+
+    auto categories = stats.generateByCategory(storage->recordSource());
+    ASSERT_EQ(categories.size(), 2);
+    EXPECT_EQ(categories[0].category, "工资");
+    EXPECT_DOUBLE_EQ(categories[1].amount, 80.0);
+}
+
+TEST_F(StorageSearchIntegrationTest, StreamingSearchStopsEarly) {
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    search->setCategory("餐饮");
+    std::vector<std::string> ids;
+    search->searchByCategory(storage->recordSource(), [&ids](const Record &r) {
+        ids.push_back(r.getId());
+        return false;
+    });
+    ASSERT_EQ(ids.size(), 1);
+    EXPECT_EQ(ids[0], "r2");
+}
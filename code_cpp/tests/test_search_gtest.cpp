@@ -1,7 +1,16 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <memory>
+#include <random>
+#include <set>
+#include "../src/Query.h"
 #include "../src/Search.h"
 #include "../src/Record.h"
+#include "../src/Date.h"
+#include "../src/StringArena.h"
+#include "../src/StringPool.h"
+#include "../src/SubstringMatcher.h"
+#include "../src/ThreadPool.h"
 
 class SearchTest : public ::testing::Test {
 protected:
@@ -250,3 +259,501 @@ TEST_F(SearchTest, SearchByKeywordWithVeryLongKeyword) {
     EXPECT_EQ(results.size(), 0);
 }
 
+// 测试紧凑记录上的比较：格式不规范的日期按文本回退
+TEST_F(SearchTest, SearchByTimeWithMalformedDates) {
+    records.emplace_back("r7", "2025/01/05", 10.0, Record::Type::Expense, "餐饮", "斜杠日期");
+    search->setTimeRange("2025-01-01", "2025-01-31");
+    auto results = search->searchByTime(records);
+    EXPECT_EQ(results.size(), 2);
+
+    search->setTimeRange("2025-01-01", "2025/12/31");
+    results = search->searchByTime(records);
+    EXPECT_EQ(results.size(), 7);
+}
+
+// 已排序输入走二分查找，结果与未排序输入的线性扫描一致
+TEST_F(SearchTest, SortedTimeSearchUsesBinarySearch) {
+    records.emplace_back("r7", "2025/01/05", 10.0, Record::Type::Expense, "餐饮", "斜杠日期");
+    records.emplace_back("r8", "2025-01-31", 10.0, Record::Type::Expense, "餐饮", "月末");
+    auto sorted = records;
+    std::sort(sorted.begin(), sorted.end(), Record::less);
+    RecordStore store;
+    store.insert(records);
+
+    const std::pair<std::string, std::string> ranges[] = {
+        {"2025-01-01", "2025-01-31"}, {"2025-01-01", "2025/12/31"}, {"2025-02-01", "2025-02-10"},
+        {"2025-03-21", "2025-12-31"}, {"2025-02-01", "2025-01-01"}, {"2024-12-01", "2025-01-01"}};
+    for (const auto &range : ranges) {
+        search->setTimeRange(range.first, range.second);
+        auto expected = search->searchByTime(records, RecordOrder::Unsorted);
+        std::sort(expected.begin(), expected.end(), Record::less);
+        EXPECT_EQ(search->searchByTime(sorted, RecordOrder::Sorted), expected) << range.first << " " << range.second;
+        EXPECT_EQ(search->searchByTime(store).toRecords(), expected) << range.first << " " << range.second;
+    }
+    search->setTimeRange("2025-01-01", "2025-01-31");
+    EXPECT_EQ(search->searchByTime(store).size(), 3);
+}
+
+TEST_F(SearchTest, SearchByCategoryNeverSeenName) {
+    search->setCategory("从未出现过的分类名");
+    auto results = search->searchByCategory(records);
+    EXPECT_EQ(results.size(), 0);
+}
+
+// 列式存储上的查询结果应与逐条记录的查询一致
+TEST_F(SearchTest, StoreSearchMatchesRecordSearch) {
+    RecordStore store;
+    store.insert(records);
+
+    search->setKeyword("工资");
+    EXPECT_EQ(search->searchByKeyword(store).toRecords(), search->searchByKeyword(records));
+    search->setCategory("餐饮");
+    EXPECT_EQ(search->searchByCategory(store).toRecords(), search->searchByCategory(records));
+    search->setTimeRange("2025-01-10", "2025-02-28");
+    EXPECT_EQ(search->searchByTime(store).toRecords(), search->searchByTime(records));
+    EXPECT_EQ(search->searchByTime(store).size(), 3);
+}
+
+// 存储压缩作废槽位后，n-gram 索引按新槽位重排，分类索引重建
+TEST_F(SearchTest, IndexesFollowStoreCompaction) {
+    const char *categories[] = {"餐饮", "交通", "工资"};
+    const char *notes[] = {"午餐", "地铁", "打车", "晚餐", ""};
+    RecordStore store;
+    for (int i = 0; i < 10000; ++i) {
+        store.insert(Record("k" + std::to_string(i), "2025-01-" + std::string(i % 28 < 9 ? "0" : "") +
+                                                         std::to_string(i % 28 + 1),
+                            1.0, Record::Type::Expense, categories[i % 3], notes[i % 5]));
+    }
+    NgramIndex keywords;
+    CategoryIndex byCategory;
+    keywords.sync(store);
+    byCategory.sync(store);
+    // 压缩前还有尚未编入索引的新槽位
+    store.insert(Record("k-new", "2025-02-01", 1.0, Record::Type::Expense, "交通", "新的晚餐"));
+    const auto generation = store.generation();
+    for (int i = 0; i < 10000; i += 2) {
+        ASSERT_TRUE(store.erase(Record::encodeId("k" + std::to_string(i))));
+    }
+    ASSERT_TRUE(store.update(Record::encodeId("k1"), Record("k1", "2025-01-02", 2.0, Record::Type::Income, "工资", "改")));
+    EXPECT_NE(store.generation(), generation);
+    EXPECT_LT(store.ids().size(), 10001u);
+    EXPECT_EQ(store.size(), 5001u);
+
+    keywords.sync(store);
+    byCategory.sync(store);
+    EXPECT_EQ(keywords.indexedSlots(), store.ids().size());
+    for (const auto &keyword : {"餐", "晚餐", "地铁", "新的", "改", "打"}) {
+        search->setKeyword(keyword);
+        EXPECT_EQ(search->searchByKeyword(store, keywords).slots(), search->searchByKeyword(store).slots()) << keyword;
+    }
+    for (const auto &category : categories) {
+        search->setCategory(category);
+        EXPECT_EQ(search->searchByCategory(store, byCategory).slots(), search->searchByCategory(store).slots())
+            << category;
+    }
+}
+
+// 测试 n-gram 倒排索引：结果与逐条扫描一致
+TEST_F(SearchTest, NgramIndexMatchesColumnScan) {
+    RecordStore store;
+    store.insert(records);
+    store.insert(Record("r7", "2025-01-02", 9.0, Record::Type::Expense, "交通", "Taxi 打车回家 午餐后"));
+    NgramIndex index;
+    index.sync(store);
+    EXPECT_EQ(index.indexedSlots(), 7u);
+
+    const std::string keywords[] = {"餐", "午餐", "工资", "一月工资", "Taxi", "xi 打", "餐后", "不存在", "资工", "饮"};
+    for (const auto &keyword : keywords) {
+        search->setKeyword(keyword);
+        EXPECT_EQ(search->searchByKeyword(store, index).slots(), search->searchByKeyword(store).slots()) << keyword;
+    }
+
+    // 增量追加、修改文本和删除后，索引追上存储即可
+    store.insert(Record("r8", "2024-12-31", 1.0, Record::Type::Expense, "餐饮", "夜宵"));
+    ASSERT_TRUE(store.update(Record::encodeId("r2"), Record("r2", "2025-01-15", 50.0, Record::Type::Expense, "餐饮", "早餐")));
+    ASSERT_TRUE(store.erase(Record::encodeId("r4")));
+    index.sync(store);
+    for (const auto &keyword : {"餐", "午餐", "早餐", "夜宵", "晚餐"}) {
+        search->setKeyword(keyword);
+        EXPECT_EQ(search->searchByKeyword(store, index).toRecords(), search->searchByKeyword(store).toRecords())
+            << keyword;
+    }
+    search->setKeyword("餐");
+    const auto results = search->searchByKeyword(store, index).toRecords();
+    ASSERT_EQ(results.size(), 3); // r8、r7、r2
+    EXPECT_EQ(results.front().getId(), "r8");
+}
+
+TEST(NgramIndexTest, DecodesUtf8CodePoints) {
+    std::vector<char32_t> codepoints;
+    NgramIndex::decode("a餐😀", codepoints);
+    EXPECT_EQ(codepoints, (std::vector<char32_t> {U'a', U'餐', U'😀'}));
+    // 非法或截断的序列按 U+FFFD 处理
+    NgramIndex::decode(std::string("\xE9\xA4") + "x\xFF", codepoints);
+    EXPECT_EQ(codepoints, (std::vector<char32_t> {0xFFFD, U'x', 0xFFFD}));
+}
+
+// 测试压缩位图：数组、位图、游程三种容器
+TEST(BitmapTest, ContainersAgreeOnContentsAndIntersections) {
+    Bitmap sparse;
+    Bitmap dense;
+    std::set<std::uint32_t> sparseSet;
+    std::set<std::uint32_t> denseSet;
+    for (std::uint32_t v = 0; v < 200000; v += 37) {
+        sparse.add(v);
+        sparseSet.insert(v);
+    }
+    for (std::uint32_t v = 60000; v < 140000; ++v) {
+        if (v % 3 != 0) {
+            dense.add(v);
+            denseSet.insert(v);
+        }
+    }
+    dense.add(7);
+    denseSet.insert(7);
+    dense.remove(60001);
+    denseSet.erase(60001);
+    EXPECT_EQ(sparse.cardinality(), sparseSet.size());
+    EXPECT_EQ(dense.cardinality(), denseSet.size());
+
+    std::vector<std::uint32_t> expected;
+    for (const auto v : sparseSet) {
+        if (denseSet.count(v) != 0) {
+            expected.push_back(v);
+        }
+    }
+    const auto check = [&](const Bitmap &a, const Bitmap &b) {
+        std::vector<std::uint32_t> both;
+        (a & b).forEach([&both](std::uint32_t v) { both.push_back(v); });
+        EXPECT_EQ(both, expected);
+        EXPECT_EQ(a.andCardinality(b), expected.size());
+    };
+    check(sparse, dense);
+    check(dense, sparse);
+
+    // 连续区间压缩成游程后结果不变，且更省空间
+    Bitmap runs;
+    for (std::uint32_t v = 100000; v < 180000; ++v) {
+        runs.add(v);
+    }
+    const auto before = runs.sizeInBytes();
+    runs.runOptimize();
+    EXPECT_LT(runs.sizeInBytes(), before / 100);
+    EXPECT_TRUE(runs.contains(150000));
+    EXPECT_FALSE(runs.contains(99999));
+    const auto inRun = static_cast<std::uint64_t>(std::distance(sparseSet.lower_bound(100000), sparseSet.lower_bound(180000)));
+    EXPECT_EQ(runs.andCardinality(sparse), inRun);
+    EXPECT_EQ((sparse & runs).cardinality(), inRun);
+    Bitmap merged = sparse;
+    merged |= runs;
+    EXPECT_EQ(merged.cardinality(), sparse.cardinality() + runs.cardinality() - sparse.andCardinality(runs));
+}
+
+TEST_F(SearchTest, CategoryIndexMatchesColumnScan) {
+    RecordStore store;
+    store.insert(records);
+    CategoryIndex index;
+    index.sync(store);
+    for (const std::string category : {"工资", "餐饮", "购物", "奖金", "从未出现"}) {
+        search->setCategory(category);
+        EXPECT_EQ(search->searchByCategory(store, index).slots(), search->searchByCategory(store).slots()) << category;
+    }
+
+    // 删除和改分类之后同步，位图随之更新
+    ASSERT_TRUE(store.erase(Record::encodeId("r2")));
+    ASSERT_TRUE(store.update(Record::encodeId("r6"), Record("r6", "2025-03-20", 80.0, Record::Type::Expense, "餐饮", "买衣服")));
+    index.sync(store);
+    search->setCategory("餐饮");
+    const auto results = search->searchByCategory(store, index).toRecords();
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0].getId(), "r4");
+    EXPECT_EQ(results[1].getId(), "r6");
+    EXPECT_EQ(index.category(StringPool::categories().intern("购物")), nullptr);
+
+    Bitmap january;
+    std::int32_t first = 0;
+    std::int32_t last = 0;
+    ASSERT_TRUE(Date::parsePacked("2025-01-01", first));
+    ASSERT_TRUE(index.monthRange(first, first + 30, january));
+    EXPECT_EQ(january.cardinality(), 1u); // r2 已删除
+    ASSERT_TRUE(Date::parsePacked("2025-01-15", last));
+    EXPECT_FALSE(index.monthRange(first, last, january));
+}
+
+TEST_F(SearchTest, QueryPlannerPicksMostSelectiveIndex) {
+    RecordStore store;
+    store.insert(records);
+    NgramIndex keywords;
+    keywords.sync(store);
+    CategoryIndex categories;
+    categories.sync(store);
+
+    Query query;
+    EXPECT_EQ(query.plan(store, keywords, categories).driver, Query::Plan::Driver::FullScan);
+
+    // 时间范围只覆盖一条，比“餐饮”位图（两条）更窄
+    query.setCategory("餐饮");
+    query.setTimeRange("2025-02-01", "2025-02-05");
+    auto plan = query.plan(store, keywords, categories);
+    EXPECT_EQ(plan.driver, Query::Plan::Driver::DateRange);
+    EXPECT_EQ(plan.estimate, 1u);
+    EXPECT_EQ(plan.filters, std::vector<std::string>({"category"}));
+    EXPECT_TRUE(query.run(store, keywords, categories).empty());
+
+    query.setTimeRange("2025-01-01", "");
+    query.setKeyword("晚餐");
+    query.setAmountRange(10.0, 40.0);
+    query.setType(Record::Type::Expense);
+    const auto results = query.run(store, keywords, categories, &plan);
+    EXPECT_EQ(plan.driver, Query::Plan::Driver::Keyword);
+    EXPECT_EQ(plan.filters, std::vector<std::string>({"keyword", "category", "date", "amount", "type"}));
+    EXPECT_EQ(plan.matched, 1u);
+    ASSERT_EQ(results.size(), 1);
+    EXPECT_EQ(results[0].getId(), "r4");
+    EXPECT_NE(plan.explain().find("n-gram"), std::string::npos);
+
+    query.setCategory("从未出现");
+    EXPECT_EQ(query.plan(store, keywords, categories).estimate, 0u);
+    EXPECT_TRUE(query.run(store, keywords, categories).empty());
+}
+
+TEST_F(SearchTest, QueryMatchesBruteForceForEveryDriver) {
+    const char *names[] = {"工资", "餐饮", "购物", "交通"};
+    for (int i = 0; i < 400; ++i) {
+        const std::string date = i % 50 == 0 ? "bad-date" : "2025-" + std::string(i % 12 < 9 ? "0" : "") +
+                                 std::to_string(i % 12 + 1) + "-" + std::to_string(10 + i % 19);
+        records.emplace_back("q" + std::to_string(i), date, (i * 37) % 500, i % 3 ? Record::Type::Expense : Record::Type::Income,
+                             names[i % 4], i % 7 ? "日常" : "午餐聚会");
+    }
+    RecordStore store;
+    store.insert(records);
+    ASSERT_TRUE(store.erase(Record::encodeId("q14")));
+    NgramIndex keywords;
+    keywords.sync(store);
+    CategoryIndex categories;
+    categories.sync(store);
+
+    // 每种组合的结果都必须和逐条过滤的结果一致，且按账本顺序排列
+    const auto bruteForce = [&](const std::string &keyword, const std::string &category, const std::string &from,
+                                const std::string &to, double minAmount, double maxAmount) {
+        std::vector<std::string> ids;
+        for (const auto &ref : RecordList(store, store.order())) {
+            if (!store.live()[ref.slot()]) {
+                continue;
+            }
+            const bool keywordOk = keyword.empty() || ref.getNote().find(keyword) != std::string::npos ||
+                                   ref.getCategory().find(keyword) != std::string::npos;
+            const bool categoryOk = category.empty() || ref.getCategory() == category;
+            const bool dateOk = (from.empty() || ref.getDate() >= from) && (to.empty() || ref.getDate() <= to);
+            const bool amountOk = ref.getAmount() >= minAmount && ref.getAmount() <= maxAmount;
+            if (keywordOk && categoryOk && dateOk && amountOk && ref.getType() == Record::Type::Expense) {
+                ids.push_back(ref.getId());
+            }
+        }
+        return ids;
+    };
+    struct Case { const char *keyword, *category, *from, *to; Query::Plan::Driver driver; };
+    const Case cases[] = {
+        {"", "", "", "", Query::Plan::Driver::FullScan},
+        {"", "餐饮", "", "", Query::Plan::Driver::Category},
+        {"聚会", "", "", "", Query::Plan::Driver::Keyword},
+        {"", "", "2025-03-01", "2025-03-31", Query::Plan::Driver::DateRange},
+        {"", "工资", "2025-01", "2025-06", Query::Plan::Driver::Category},
+        {"聚会", "交通", "", "2025-05-31", Query::Plan::Driver::Keyword},
+    };
+    for (const auto &c : cases) {
+        Query query;
+        query.setKeyword(c.keyword);
+        query.setCategory(c.category);
+        query.setTimeRange(c.from, c.to);
+        query.setAmountRange(50.0, 450.0);
+        query.setType(Record::Type::Expense);
+        Query::Plan plan;
+        std::vector<std::string> ids;
+        for (const auto &ref : query.run(store, keywords, categories, &plan)) {
+            ids.push_back(ref.getId());
+        }
+        EXPECT_EQ(plan.driver, c.driver) << plan.explain();
+        EXPECT_EQ(ids, bruteForce(c.keyword, c.category, c.from, c.to, 50.0, 450.0)) << plan.explain();
+        EXPECT_LE(plan.examined, std::max<std::size_t>(plan.estimate, 1) + store.lowerBound(0));
+    }
+}
+
+TEST(SubstringMatcherTest, EveryIsaAgreesWithStdFind) {
+    std::mt19937 rng(3);
+    std::string haystack;
+    for (int i = 0; i < 300; ++i) {
+        haystack += static_cast<char>("abcab\0"[rng() % 6]);
+    }
+    haystack += "needle";
+    // 覆盖块边界、尾部不足一个块、空串和越界起点
+    const std::string needles[] = {"", "a", "ab", "abc", "cab", "aab", std::string("b\0a", 3), "needle", "zz",
+                                   haystack.substr(17, 40)};
+    for (const auto isa : {SubstringMatcher::Isa::Scalar, SubstringMatcher::Isa::Sse2, SubstringMatcher::Isa::Avx2}) {
+        for (const auto &needle : needles) {
+            const SubstringMatcher matcher(needle, isa);
+            EXPECT_LE(matcher.isa(), SubstringMatcher::best());
+            for (std::size_t from = 0; from <= haystack.size() + 1; from += 7) {
+                ASSERT_EQ(matcher.find(haystack, from), haystack.find(needle, from)) << needle << " @" << from;
+            }
+            for (std::size_t cut = 0; cut < 70; ++cut) {
+                const std::string_view prefix(haystack.data(), cut);
+                ASSERT_EQ(matcher.find(prefix), prefix.find(needle)) << needle << " len " << cut;
+            }
+        }
+    }
+}
+
+TEST(StringArenaTest, MarksEveryStringContainingTheNeedle) {
+    StringPool pool;
+    StringArena arena(pool);
+    const std::uint32_t lunch = pool.intern("午餐外卖");
+    const std::uint32_t taxi = pool.intern("打车");
+    std::vector<std::uint8_t> hits;
+    arena.match(SubstringMatcher("外卖"), hits);
+    ASSERT_EQ(hits.size(), pool.size());
+    EXPECT_EQ(hits[lunch], 1);
+    EXPECT_EQ(hits[taxi], 0);
+    EXPECT_EQ(hits[0], 0);
+
+    // 新加入的字符串在下次匹配时增量复制；匹配不会跨越分隔符
+    const std::uint32_t late = pool.intern("外卖晚餐外卖");
+    const std::uint32_t edge = pool.intern("卖");
+    arena.match(SubstringMatcher("外卖"), hits);
+    ASSERT_EQ(hits.size(), pool.size());
+    EXPECT_EQ(hits[late], 1);
+    EXPECT_EQ(hits[edge], 0);
+    arena.match(SubstringMatcher("卖打"), hits);
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), 0);
+    arena.match(SubstringMatcher(""), hits);
+    EXPECT_EQ(std::count(hits.begin(), hits.end(), 1), static_cast<long>(pool.size()));
+}
+
+TEST(ThreadPoolTest, ParsesThreadCounts) {
+    std::size_t threads = 7;
+    EXPECT_TRUE(ThreadPool::parseThreads("4", threads));
+    EXPECT_EQ(threads, 4u);
+    EXPECT_TRUE(ThreadPool::parseThreads("0", threads)); // 0 表示全部硬件线程
+    EXPECT_EQ(threads, 0u);
+    EXPECT_TRUE(ThreadPool::parseThreads("256", threads));
+    EXPECT_EQ(threads, ThreadPool::kMaxThreads);
+    // 拼写错误、负数和越界都被拒绝，且不改动原值
+    threads = 7;
+    for (const char *bad : {"", "four", "4x", " 4", "-1", "+4", "257", "99999999999999999999"}) {
+        EXPECT_FALSE(ThreadPool::parseThreads(bad, threads)) << bad;
+        EXPECT_EQ(threads, 7u) << bad;
+    }
+}
+
+TEST(ThreadPoolTest, ChunksCoverRangeNestAndRethrow) {
+    for (const std::size_t threads : {1u, 4u}) {
+        ThreadPool pool(threads);
+        EXPECT_EQ(pool.threads(), threads);
+        // 分块只由 count 和 grain 决定，与线程数无关
+        std::vector<int> seen(1000, 0);
+        std::vector<std::pair<std::size_t, std::size_t>> chunks(ThreadPool::chunkCount(seen.size(), 64));
+        pool.parallelFor(seen.size(), 64, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            chunks[chunk] = {begin, end};
+            for (std::size_t i = begin; i < end; ++i) {
+                ++seen[i];
+            }
+        });
+        EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), 1000);
+        ASSERT_EQ(chunks.size(), 16u);
+        EXPECT_EQ(chunks[15], std::make_pair(std::size_t {960}, std::size_t {1000}));
+
+        // 任务内部再次 parallelFor 不会死锁
+        std::atomic<int> inner(0);
+        pool.parallelFor(8, 1, [&](std::size_t, std::size_t, std::size_t) {
+            pool.parallelFor(8, 1, [&](std::size_t, std::size_t, std::size_t) { ++inner; });
+        });
+        EXPECT_EQ(inner.load(), 64);
+
+        EXPECT_THROW(pool.parallelFor(100, 1, [](std::size_t chunk, std::size_t, std::size_t) {
+            if (chunk == 37) {
+                throw std::runtime_error("chunk failed");
+            }
+        }), std::runtime_error);
+        pool.parallelFor(0, 16, [](std::size_t, std::size_t, std::size_t) { FAIL(); });
+    }
+}
+
+TEST_F(SearchTest, CursorPagesNewestFirstAndStopsEarly) {
+    for (int i = 0; i < 1000; ++i) {
+        const std::string day = std::to_string(10 + i % 18);
+        records.emplace_back("c" + std::to_string(i), "2025-04-" + day, 10.0, Record::Type::Expense,
+                             i % 2 ? "餐饮" : "交通", i % 3 ? "地铁" : "午餐");
+    }
+    records.emplace_back("bad", "2025-04-15晚", 10.0, Record::Type::Expense, "餐饮", "午餐");
+    RecordStore store;
+    store.insert(records);
+    const auto ids = [&](auto &&cursor) {
+        std::vector<std::string> out;
+        RecordStore::Slot slot = 0;
+        while (cursor.next(slot)) {
+            out.push_back(RecordRef(cursor.store(), slot).getId());
+        }
+        return out;
+    };
+    const auto reversed = [](const RecordList &list) {
+        std::vector<std::string> out;
+        for (const auto &ref : list) {
+            out.insert(out.begin(), ref.getId());
+        }
+        return out;
+    };
+
+    // 最新 20 条“午餐”：从账本末尾倒着走，拿够就停
+    search->setKeyword("午餐");
+    RecordCursor::Page page;
+    page.newestFirst = true;
+    page.limit = 20;
+    auto latest = search->cursorByKeyword(store, page);
+    const auto all = reversed(search->searchByKeyword(store));
+    EXPECT_EQ(ids(latest), std::vector<std::string>(all.begin(), all.begin() + 20));
+    EXPECT_LT(latest.examined(), 200u); // 共 1001 条
+    EXPECT_TRUE(latest.done());
+
+    // 偏移分页与一次取完的结果拼接一致
+    page.offset = 20;
+    page.limit = 15;
+    EXPECT_EQ(ids(search->cursorByKeyword(store, page)), std::vector<std::string>(all.begin() + 20, all.begin() + 35));
+    EXPECT_EQ(ids(RecordCursor(search->searchByKeyword(store), page)),
+              std::vector<std::string>(all.begin() + 20, all.begin() + 35));
+    page.offset = all.size() - 3;
+    EXPECT_EQ(ids(search->cursorByKeyword(store, page)).size(), 3u);
+
+    // 时间游标只走二分出的区间和非标准日期前缀，升序时也不扫区间之外
+    search->setTimeRange("2025-04-15", "2025-04-16");
+    page = RecordCursor::Page();
+    auto window = search->cursorByTime(store, page);
+    const auto list = window.take();
+    EXPECT_EQ(list.toRecords().size(), search->searchByTime(store).size());
+    EXPECT_EQ(list[0].getId(), "bad");
+    EXPECT_EQ(window.examined(), list.size());
+    search->setCategory("交通");
+    page.newestFirst = true;
+    page.limit = 5;
+    const auto transport = ids(search->cursorByCategory(store, page));
+    ASSERT_EQ(transport.size(), 5u);
+    EXPECT_EQ(transport.front(), reversed(search->searchByCategory(store)).front());
+}
+
+TEST_F(SearchTest, StoreSearchReturnsViewsIntoStore) {
+    RecordStore store;
+    store.insert(records);
+    search->setKeyword("餐");
+    auto results = search->searchByKeyword(store);
+    ASSERT_EQ(results.size(), 2);
+    // 结果只保存槽位，备注直接引用存储的备注堆，不复制
+    EXPECT_EQ(results[0].getNote(), records[1].getNote());
+    EXPECT_EQ(results[0].getNote().data(), store.notes().get(results[0].slot()).data());
+    EXPECT_EQ(results[1].getId(), "r4");
+    std::size_t seen = 0;
+    for (const auto &ref : results) {
+        EXPECT_EQ(ref.getCategory(), "餐饮");
+        ++seen;
+    }
+    EXPECT_EQ(seen, 2);
+}
+
@@ -1,10 +1,20 @@
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <filesystem>
 #include <fstream>
 #include <memory>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
 #include "../src/Storage.h"
 #include "../src/Record.h"
 #include "../src/Category.h"
+#include "../src/StorageWriter.h"
+#include "../src/BinaryLedger.h"
+#include "../src/RecordStore.h"
+#include "../src/Date.h"
+#include "../src/IdGenerator.h"
+#include "../src/StringPool.h"
 
 class StorageTest : public ::testing::Test {
 protected:
@@ -223,3 +233,805 @@ TEST_F(StorageTest, SaveRecordsWithVeryLongStrings) {
     EXPECT_EQ(loaded[0].getCategory().length(), 1000);
 }
 
+
+// 测试追加日志（journal）
+TEST_F(StorageTest, AppendRecordIsReplayedOnLoad) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "基础文件");
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    EXPECT_TRUE(storage->appendRecord(Record("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "日志1")));
+    EXPECT_TRUE(storage->appendRecord(Record("r3", "2025-01-03", 30.0, Record::Type::Expense, "交通", "日志2")));
+    EXPECT_GT(storage->journalSize(), 0u);
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 3);
+    EXPECT_EQ(loaded[1].getId(), "r2");
+    EXPECT_EQ(loaded[2].getNote(), "日志2");
+}
+
+TEST_F(StorageTest, AppendRecordWithoutBaseFile) {
+    EXPECT_TRUE(storage->appendRecord(Record("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "仅日志")));
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].getId(), "r1");
+}
+
+TEST_F(StorageTest, SaveRecordsCompactsJournal) {
+    Record r1("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    Record r2("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "b");
+    ASSERT_TRUE(storage->appendRecord(r1));
+    ASSERT_TRUE(storage->appendRecord(r2));
+
+    ASSERT_TRUE(storage->saveRecords({r1, r2}));
+    EXPECT_EQ(storage->journalSize(), 0u);
+    EXPECT_EQ(storage->loadRecords().size(), 2);
+}
+
+TEST_F(StorageTest, TornJournalTailIsIgnored) {
+    ASSERT_TRUE(storage->appendRecord(Record("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "完整")));
+    ASSERT_TRUE(storage->appendRecord(Record("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "被截断")));
+
+    // 模拟写入过程中崩溃：截掉最后一帧的末尾
+    auto journal = std::filesystem::path(testDir) / "records.journal";
+    std::filesystem::resize_file(journal, std::filesystem::file_size(journal) - 3);
+    const auto tornSize = std::filesystem::file_size(journal);
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].getId(), "r1");
+    // 只读加载不改动磁盘上的日志，坏尾留给下一次追加去修复
+    EXPECT_EQ(Storage(testDir).loadRecords().size(), 1);
+    EXPECT_EQ(std::filesystem::file_size(journal), tornSize);
+}
+
+TEST_F(StorageTest, AppendAfterTornTailIsReplayed) {
+    ASSERT_TRUE(storage->appendRecord(Record("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "完整")));
+    ASSERT_TRUE(storage->appendRecord(Record("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "被截断")));
+    auto journal = std::filesystem::path(testDir) / "records.journal";
+    std::filesystem::resize_file(journal, std::filesystem::file_size(journal) - 3);
+
+    // 崩溃后重启：新的 Storage 先截掉坏尾再追加，新记录不会被坏帧挡住
+    Storage restarted(testDir);
+    ASSERT_TRUE(restarted.appendRecord(Record("r3", "2025-01-03", 30.0, Record::Type::Expense, "餐饮", "重启后")));
+    // 同一个实例写入途中被截断，下一次追加同样先修复
+    std::filesystem::resize_file(journal, std::filesystem::file_size(journal) - 1);
+    ASSERT_TRUE(restarted.appendRecord(Record("r4", "2025-01-04", 40.0, Record::Type::Expense, "餐饮", "再次追加")));
+
+    auto loaded = Storage(testDir).loadRecords();
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_EQ(loaded[0].getId(), "r1");
+    EXPECT_EQ(loaded[1].getId(), "r4");
+}
+
+// 测试崩溃安全的原子保存
+TEST_F(StorageTest, SaveRecordsLeavesNoTempFile) {
+    ASSERT_TRUE(storage->saveRecords({Record("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "")}));
+    ASSERT_TRUE(storage->saveCategories({Category("c1", "自定义", true)}));
+    for (const auto &entry : std::filesystem::directory_iterator(testDir)) {
+        EXPECT_NE(entry.path().extension(), ".tmp") << entry.path();
+    }
+}
+
+TEST_F(StorageTest, InterruptedSaveKeepsPreviousLedger) {
+    ASSERT_TRUE(storage->saveRecords({Record("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "旧")}));
+    // 模拟写临时文件时崩溃：半截的临时文件不影响已有账本
+    std::ofstream(std::filesystem::path(testDir) / "records.txt.tmp") << "r2\t2025-01";
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0].getNote(), "旧");
+}
+
+TEST_F(StorageTest, JournalAlreadyInBaseIsNotReplayedTwice) {
+    Record r1("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    Record r2("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "b");
+    ASSERT_TRUE(storage->saveRecords({r1, r2}));
+    // 模拟重写基础文件后、删除日志前崩溃：日志里的记录已在基础文件中
+    ASSERT_TRUE(storage->appendRecord(r2));
+    ASSERT_TRUE(storage->appendRecord(Record("r3", "2025-01-03", 30.0, Record::Type::Expense, "餐饮", "c")));
+
+    EXPECT_EQ(storage->loadRecords().size(), 3);
+    std::size_t scanned = 0;
+    storage->scanRecords([&scanned](const Record &) {
+        ++scanned;
+        return true;
+    });
+    EXPECT_EQ(scanned, 3);
+}
+
+
+TEST_F(StorageTest, JournalTombstonesAmendTheBase) {
+    Record r1("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    Record r2("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "b");
+    ASSERT_TRUE(storage->saveRecords({r1, r2}));
+    Record fixed("r1", "2025-01-01", 12.0, Record::Type::Expense, "餐饮", "改");
+    Record r3("r3", "2025-01-03", 30.0, Record::Type::Expense, "餐饮", "c");
+    ASSERT_TRUE(storage->appendJournal({{Storage::JournalEntry::Op::Update, fixed},
+                                        {Storage::JournalEntry::Op::Delete, r2},
+                                        {Storage::JournalEntry::Op::Append, r3},
+                                        {Storage::JournalEntry::Op::Delete, r3}}));
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 1);
+    EXPECT_EQ(loaded[0], fixed);
+    std::vector<Record> scanned;
+    storage->scanRecords([&scanned](const Record &r) {
+        scanned.push_back(r);
+        return true;
+    });
+    EXPECT_EQ(scanned, loaded);
+
+    // 压缩后再重放同一份日志（模拟删除日志前崩溃），结果不变
+    const auto entries = storage->loadJournalEntries();
+    ASSERT_EQ(entries.size(), 4);
+    ASSERT_TRUE(storage->compactJournal());
+    EXPECT_EQ(storage->journalSize(), 0u);
+    ASSERT_TRUE(storage->appendJournal(entries));
+    EXPECT_EQ(storage->loadRecords(), loaded);
+}
+
+TEST_F(StorageTest, LoadIntoStoreMatchesLoadRecords) {
+    Record r1("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    Record r2("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "b");
+    Record r3("r3", "2025-01-03", 30.0, Record::Type::Income, "工资", "c");
+    ASSERT_TRUE(storage->saveRecords({r3, r1, r2}));
+    // 日志里有修改、删除、已在基础文件中的追加（崩溃残留）和新的追加
+    Record fixed("r1", "2025-01-05", 12.0, Record::Type::Expense, "餐饮", "改");
+    Record r4("r4", "2025-01-04", 40.0, Record::Type::Expense, "交通", "d");
+    ASSERT_TRUE(storage->appendJournal({{Storage::JournalEntry::Op::Update, fixed},
+                                        {Storage::JournalEntry::Op::Delete, r2},
+                                        {Storage::JournalEntry::Op::Append, r3},
+                                        {Storage::JournalEntry::Op::Append, r4}}));
+
+    auto expected = storage->loadRecords();
+    std::stable_sort(expected.begin(), expected.end(), Record::less);
+    RecordStore store;
+    store.insert(r2); // 原有内容被替换
+    storage->loadRecords(store);
+    EXPECT_EQ(store.toRecords(), expected);
+    ASSERT_EQ(store.size(), 3);
+    RecordStore::Slot slot = 0;
+    ASSERT_TRUE(store.find(fixed.getIdValue(), slot));
+    EXPECT_EQ(store.get(slot), fixed);
+    EXPECT_FALSE(store.find(r2.getIdValue(), slot));
+}
+
+TEST_F(StorageTest, ShardedCompactionAppliesTombstonesPerSegment) {
+    storage->setLayout(Storage::Layout::MonthSharded);
+    Record r1("r1", "2025-01-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    Record r2("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "b");
+    ASSERT_TRUE(storage->saveRecords({r1, r2}));
+    // 跨月修改：旧分段写墓碑，新分段写新版本
+    Record moved("r1", "2025-02-01", 10.0, Record::Type::Expense, "餐饮", "a");
+    ASSERT_TRUE(storage->appendJournal({{Storage::JournalEntry::Op::Delete, r1},
+                                        {Storage::JournalEntry::Op::Update, moved}}));
+    ASSERT_EQ(storage->loadRecords().size(), 2);
+
+    ASSERT_TRUE(storage->compactJournal());
+    auto january = storage->loadSegment("2025-01");
+    ASSERT_EQ(january.size(), 1);
+    EXPECT_EQ(january[0], r2);
+    auto february = storage->loadSegment("2025-02");
+    ASSERT_EQ(february.size(), 1);
+    EXPECT_EQ(february[0], moved);
+}
+
+
+// 测试紧凑记录表示
+TEST(RecordTest, CompactLayout) {
+    // 定长字段 32 字节，另加记录自己持有的备注
+    EXPECT_LE(sizeof(Record), 32u + sizeof(std::string));
+
+    Record r("REC1762949262636000", "2025-03-07", 12.5, Record::Type::Expense, "餐饮", "午餐");
+    EXPECT_EQ(r.getIdValue(), 1762949262636000ULL);
+    EXPECT_EQ(r.getDateValue(), 20250307);
+    EXPECT_EQ(r.getCents(), 1250);
+    EXPECT_EQ(r.getId(), "REC1762949262636000");
+    EXPECT_EQ(r.getDate(), "2025-03-07");
+    EXPECT_EQ(r.toTSV(), "REC1762949262636000\t2025-03-07\t12.5\tE\t餐饮\t午餐");
+
+    // 同名分类共享同一个 id
+    Record other("r2", "2025-03-08", 1.0, Record::Type::Expense, "餐饮", "");
+    EXPECT_EQ(other.getCategoryId(), r.getCategoryId());
+}
+
+TEST(RecordTest, TextIdsAndMalformedDatesRoundTrip) {
+    const std::string ids[] = {"r1", "", "REC", "REC007", "REC12a", "REC1234567890123456789"};
+    for (const auto &id : ids) {
+        Record r(id, "2025-01-01", 1.0, Record::Type::Income, "工资", "");
+        EXPECT_EQ(r.getId(), id);
+        EXPECT_EQ(Record::fromTSV(r.toTSV()), r);
+    }
+    const std::string dates[] = {"", "2025/01/01", "2025-02-30", "今天"};
+    for (const auto &date : dates) {
+        Record r("r1", date, 1.0, Record::Type::Income, "工资", "");
+        EXPECT_LT(r.getDateValue(), 0);
+        EXPECT_EQ(r.getDate(), date);
+    }
+}
+
+TEST(RecordTest, AmountsAreExactCents) {
+    EXPECT_EQ(Record::formatCents(0), "0");
+    EXPECT_EQ(Record::formatCents(-1050), "-10.5");
+    EXPECT_EQ(Record::formatCents(99999999), "999999.99");
+    EXPECT_EQ(Record::formatCents(5), "0.05");
+
+    std::int64_t cents = 0;
+    ASSERT_TRUE(TsvParser::parseCents("0.1", cents));
+    EXPECT_EQ(cents, 10);
+    ASSERT_TRUE(TsvParser::parseCents("-12.345", cents));
+    EXPECT_EQ(cents, -1235);
+    ASSERT_TRUE(TsvParser::parseCents("+3", cents));
+    EXPECT_EQ(cents, 300);
+    ASSERT_TRUE(TsvParser::parseCents("1e2", cents));
+    EXPECT_EQ(cents, 10000);
+    EXPECT_FALSE(TsvParser::parseCents("abc", cents));
+    EXPECT_FALSE(TsvParser::parseCents("", cents));
+}
+
+TEST(RecordTest, LedgerOrderIsDateThenId) {
+    Record undated("r9", "", 1.0, Record::Type::Expense, "餐饮", "");
+    Record early("REC2", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "");
+    Record sameDayText("a", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "");
+    Record later("REC1", "2025-01-02", 1.0, Record::Type::Expense, "餐饮", "");
+    EXPECT_TRUE(Record::less(undated, early));
+    EXPECT_TRUE(Record::less(early, sameDayText));
+    EXPECT_TRUE(Record::less(sameDayText, later));
+    EXPECT_FALSE(Record::less(later, later));
+}
+
+// 测试列式 RecordStore
+// 测试记录 id 生成器
+TEST(IdGeneratorTest, ConcurrentIdsAreUniqueAndIncreasing) {
+    IdGenerator generator(5);
+    constexpr int kThreads = 4;
+    constexpr int kPerThread = 50000; // 远超每毫秒 4096 个序号，会借用后续毫秒
+    std::vector<std::vector<std::uint64_t>> issued(kThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&generator, &issued, t] {
+            issued[t].reserve(kPerThread);
+            for (int i = 0; i < kPerThread; ++i) {
+                issued[t].push_back(generator.next());
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    std::unordered_set<std::uint64_t> all;
+    for (const auto &ids : issued) {
+        for (std::size_t i = 0; i < ids.size(); ++i) {
+            EXPECT_TRUE(IdGenerator::isGenerated(ids[i]));
+            if (i > 0) {
+                ASSERT_LT(ids[i - 1], ids[i]);
+            }
+            all.insert(ids[i]);
+        }
+    }
+    EXPECT_EQ(all.size(), static_cast<std::size_t>(kThreads * kPerThread));
+    EXPECT_EQ((issued[0][0] >> IdGenerator::kSequenceBits) & ((1u << IdGenerator::kNodeBits) - 1), 5u);
+    EXPECT_THROW(IdGenerator(1u << IdGenerator::kNodeBits), std::out_of_range);
+}
+
+TEST(IdGeneratorTest, TextFormRoundTripsThroughRecords) {
+    IdGenerator generator;
+    const auto first = generator.next();
+    const auto second = generator.next();
+    const auto text = IdGenerator::toString(first);
+    ASSERT_EQ(text.size(), IdGenerator::kTextLength);
+    EXPECT_EQ(text.compare(0, 2, "ID"), 0);
+    EXPECT_LT(text, IdGenerator::toString(second));
+    std::uint64_t parsed = 0;
+    ASSERT_TRUE(IdGenerator::parse(text, parsed));
+    EXPECT_EQ(parsed, first);
+    EXPECT_FALSE(IdGenerator::parse("ID" + std::string(13, 'U'), parsed)); // U 不在字母表中
+    EXPECT_FALSE(IdGenerator::parse("ID" + std::string(13, 'Z'), parsed)); // 超过 62 位
+
+    Record r(first, "2025-03-07", 1.0, Record::Type::Expense, "餐饮", "");
+    EXPECT_EQ(r.getIdValue(), first);
+    EXPECT_EQ(r.getId(), text);
+    EXPECT_EQ(Record::fromTSV(r.toTSV()), r);
+    // 与旧式 REC 编号同日时，生成的 id 排在后面
+    Record legacy("REC1762949262636000", "2025-03-07", 1.0, Record::Type::Expense, "餐饮", "");
+    EXPECT_TRUE(Record::less(legacy, r));
+    const auto millis = IdGenerator::unixMillisOf(first);
+    EXPECT_GT(millis, IdGenerator::kEpochMillis);
+}
+
+TEST(RecordStoreTest, KeepsLedgerOrderAcrossInserts) {
+    RecordStore store;
+    store.insert(Record("r3", "2025-03-01", 3.0, Record::Type::Expense, "餐饮", "c"));
+    store.insert(Record("r1", "2025-01-01", 1.0, Record::Type::Income, "工资", "a"));
+    store.insert({Record("r4", "2025-04-01", 4.0, Record::Type::Expense, "交通", "d"),
+                  Record("r2", "2025-02-01", 2.0, Record::Type::Expense, "餐饮", "b")});
+
+    ASSERT_EQ(store.size(), 4u);
+    const auto records = store.toRecords();
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        EXPECT_EQ(records[i].getId(), "r" + std::to_string(i + 1));
+        EXPECT_EQ(store.at(i), records[i]);
+    }
+    // 槽位按插入顺序分配，列与槽位一一对应
+    EXPECT_EQ(store.cents()[0], 300);
+    EXPECT_EQ(store.incomes()[1], 1);
+    EXPECT_EQ(store.get(3).getNote(), "b");
+
+    std::int32_t march = 0;
+    ASSERT_TRUE(Date::parsePacked("2025-03-01", march));
+    EXPECT_EQ(store.lowerBound(march), 2u);
+}
+
+TEST(RecordStoreTest, ReadsBetweenInsertsSeeMergedOrder) {
+    RecordStore store;
+    for (int day = 28; day >= 1; --day) {
+        const std::string date = "2025-01-" + std::string(day < 10 ? "0" : "") + std::to_string(day);
+        store.insert(Record("r" + std::to_string(day), date, 1.0, Record::Type::Expense, "餐饮", ""));
+        if (day % 7 == 0) {
+            // 中途读取会把待合并的记录并入有序序列
+            EXPECT_EQ(store.at(0).getDate(), date);
+        }
+    }
+    const auto &order = store.order();
+    ASSERT_EQ(order.size(), 28u);
+    for (std::size_t i = 1; i < order.size(); ++i) {
+        EXPECT_TRUE(store.dates()[order[i - 1]] < store.dates()[order[i]]);
+    }
+}
+
+TEST(RecordStoreTest, ShortRunsMatchTheMerge) {
+    // 每次操作后都读取（逐条二分插入/删除）与最后才读取（整体排序合并）结果一致，
+    // 包括同一 id 的重复记录（键相同，按到达顺序）
+    RecordStore eager;
+    RecordStore batched;
+    for (int i = 0; i < 200; ++i) {
+        const int day = (i * 7) % 28 + 1;
+        const std::string date = "2025-02-" + std::string(day < 10 ? "0" : "") + std::to_string(day);
+        const Record record("r" + std::to_string(i % 50), date, static_cast<double>(i), Record::Type::Expense,
+                            "餐饮", "备注" + std::to_string(i));
+        eager.insert(record);
+        batched.insert(record);
+        if (i % 9 == 8) {
+            const auto id = Record::encodeId("r" + std::to_string(i % 13));
+            eager.erase(id);
+            batched.erase(id);
+        }
+        eager.order();
+    }
+    ASSERT_EQ(eager.size(), batched.size());
+    EXPECT_EQ(eager.order(), batched.order());
+    EXPECT_EQ(eager.toRecords(), batched.toRecords());
+}
+
+TEST(RecordStoreTest, UpdateAndEraseById) {
+    RecordStore store;
+    store.insert({Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "a"),
+                  Record("r2", "2025-02-01", 2.0, Record::Type::Expense, "餐饮", "b"),
+                  Record("r3", "2025-03-01", 3.0, Record::Type::Expense, "餐饮", "c")});
+    const auto r2 = Record::encodeId("r2");
+    RecordStore::Slot slot = 0;
+    ASSERT_TRUE(store.find(r2, slot));
+    EXPECT_EQ(slot, 1u);
+
+    // 日期和文本不变：原地修改，槽位不变
+    ASSERT_TRUE(store.update(r2, Record("r2", "2025-02-01", 5.0, Record::Type::Income, "餐饮", "b")));
+    ASSERT_TRUE(store.find(r2, slot));
+    EXPECT_EQ(slot, 1u);
+    EXPECT_EQ(store.get(slot).getType(), Record::Type::Income);
+    // 文本改变：换到新槽位，便于文本索引按槽位追加
+    ASSERT_TRUE(store.update(r2, Record("r2", "2025-02-01", 5.0, Record::Type::Income, "工资", "改")));
+    ASSERT_TRUE(store.find(r2, slot));
+    EXPECT_EQ(slot, 3u);
+    EXPECT_EQ(store.get(slot).getCategory(), "工资");
+
+    // 日期改变：旧槽位作废，新槽位按账本顺序归位
+    ASSERT_TRUE(store.update(Record::encodeId("r1"), Record("r1", "2025-04-01", 1.0, Record::Type::Expense, "餐饮", "a")));
+    ASSERT_TRUE(store.erase(Record::encodeId("r3")));
+    EXPECT_FALSE(store.erase(Record::encodeId("r3")));
+    EXPECT_FALSE(store.update(Record::encodeId("r9"), Record()));
+    EXPECT_FALSE(store.find(Record::encodeId("r3"), slot));
+
+    ASSERT_EQ(store.size(), 2u);
+    const auto records = store.toRecords();
+    ASSERT_EQ(records.size(), 2u);
+    EXPECT_EQ(records[0].getId(), "r2");
+    EXPECT_EQ(records[1].getDate(), "2025-04-01");
+    EXPECT_EQ(store.live()[0], 0);
+    EXPECT_EQ(store.live()[1], 0);
+    EXPECT_EQ(store.live()[2], 0);
+}
+
+// 重复 id：修改和删除作用于所有副本，与日志重放一致
+TEST_F(StorageTest, DuplicateIdsMatchJournalReplay) {
+    const std::vector<Record> base = {Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "a"),
+                                      Record("r2", "2025-01-02", 2.0, Record::Type::Expense, "餐饮", "b"),
+                                      Record("r1", "2025-01-03", 3.0, Record::Type::Expense, "餐饮", "c")};
+    ASSERT_TRUE(storage->saveRecords(base));
+    RecordStore store;
+    store.insert(base);
+    const auto r1 = Record::encodeId("r1");
+    RecordStore::Slot slot = 0;
+    ASSERT_TRUE(store.find(r1, slot));
+    EXPECT_EQ(slot, 2u); // 最新的副本
+    EXPECT_EQ(store.copies(r1), (std::vector<RecordStore::Slot> {0, 2}));
+
+    const Record fixed("r1", "2025-01-03", 4.0, Record::Type::Income, "餐饮", "c");
+    const auto replayed = [this] {
+        auto records = storage->loadRecords();
+        std::sort(records.begin(), records.end(), Record::less);
+        return records;
+    };
+    ASSERT_TRUE(storage->appendJournal({{Storage::JournalEntry::Op::Update, fixed}}));
+    ASSERT_TRUE(store.update(r1, fixed));
+    EXPECT_EQ(store.toRecords(), replayed());
+    EXPECT_EQ(store.size(), 2u);
+
+    ASSERT_TRUE(storage->appendJournal({{Storage::JournalEntry::Op::Delete, fixed}}));
+    ASSERT_TRUE(store.erase(r1));
+    EXPECT_EQ(store.toRecords(), replayed());
+    EXPECT_FALSE(store.find(r1, slot));
+    EXPECT_TRUE(store.copies(r1).empty());
+}
+
+// 作废槽位超过阈值后压缩列，id 索引、账本顺序和备注堆随之更新
+TEST(RecordStoreTest, CompactsDeadSlots) {
+    RecordStore store;
+    for (int i = 0; i < 10000; ++i) {
+        store.insert(Record("k" + std::to_string(i), "2025-03-01", static_cast<double>(i), Record::Type::Expense,
+                            "餐饮", "旧备注-" + std::to_string(i)));
+    }
+    const auto generation = store.generation();
+    // 改日期会换槽位：第 10000 次修改时作废槽位与活跃槽位一样多，触发压缩
+    for (int i = 0; i < 11000; ++i) {
+        const std::string id = "k" + std::to_string(i % 10000);
+        ASSERT_TRUE(store.update(Record::encodeId(id), Record(id, i < 10000 ? "2025-02-01" : "2025-01-01",
+                                                              static_cast<double>(i % 10000), Record::Type::Expense,
+                                                              "餐饮", "新备注-" + id)));
+    }
+    EXPECT_EQ(store.generation(), generation + 1);
+    EXPECT_EQ(store.compaction().size(), 20000u);
+    EXPECT_EQ(store.compaction()[0], RecordStore::kNoSlot);
+    // 压缩后只剩活跃槽位和压缩之后作废的槽位
+    EXPECT_EQ(store.size(), 10000u);
+    EXPECT_EQ(store.ids().size(), 11000u);
+    EXPECT_EQ(store.erased().size(), 1000u);
+    // 被替换的旧备注随压缩释放
+    ASSERT_EQ(store.notes().size(), store.ids().size());
+    for (std::size_t i = 0; i < store.notes().size(); ++i) {
+        EXPECT_EQ(store.notes().get(i).rfind("新备注-", 0), 0u);
+    }
+
+    RecordStore::Slot slot = 0;
+    ASSERT_TRUE(store.find(Record::encodeId("k9999"), slot));
+    EXPECT_EQ(store.get(slot).getCents(), 999900);
+    const auto records = store.toRecords();
+    ASSERT_EQ(records.size(), 10000u);
+    EXPECT_EQ(records.front().getDate(), "2025-01-01");
+    EXPECT_EQ(records.back().getDate(), "2025-02-01");
+    EXPECT_TRUE(std::is_sorted(records.begin(), records.end(), Record::less));
+}
+
+// 测试二进制列式格式
+TEST_F(StorageTest, BinaryFormatRoundTrip) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "一月工资");
+    records.emplace_back("r2", "2024-02-29", 50.5, Record::Type::Expense, "餐饮", "");
+    records.emplace_back("r3", "不是日期", 999999.99, Record::Type::Expense, "餐饮", "异常日期");
+
+    storage->setFormat(Storage::Format::Binary);
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 3);
+    EXPECT_EQ(loaded[0].getId(), "r1");
+    EXPECT_EQ(loaded[0].getDate(), "2025-01-01");
+    EXPECT_EQ(loaded[0].getCategory(), "工资");
+    EXPECT_EQ(loaded[1].getDate(), "2024-02-29");
+    EXPECT_DOUBLE_EQ(loaded[1].getAmount(), 50.5);
+    EXPECT_EQ(loaded[1].getType(), Record::Type::Expense);
+    EXPECT_EQ(loaded[2].getDate(), "不是日期");
+    EXPECT_DOUBLE_EQ(loaded[2].getAmount(), 999999.99);
+    EXPECT_EQ(loaded[2].getNote(), "异常日期");
+}
+
+// id 列按 64 位整数存储；文本 id 进入 id 表，相同备注在堆里只存一份
+TEST_F(StorageTest, BinaryLedgerStoresIdColumnAndSharesNotes) {
+    const std::string note(200, 'x');
+    std::vector<Record> records;
+    for (int i = 0; i < 1000; ++i) {
+        records.emplace_back("REC" + std::to_string(i + 1), "2025-01-01", 1.0, Record::Type::Expense, "餐饮", note);
+    }
+    const auto generated = IdGenerator::shared().next();
+    records.emplace_back(generated, "2025-01-02", 2.0, Record::Type::Expense, "餐饮", "生成的 id");
+    records.emplace_back("文本id", "2025-01-03", 3.0, Record::Type::Income, "工资", "");
+    records.emplace_back("文本id", "2025-01-04", 4.0, Record::Type::Income, "工资", "同一个文本 id");
+
+    const auto path = (std::filesystem::path(testDir) / "ledger.bin").string();
+    ASSERT_TRUE(BinaryLedger::write(path, records));
+    EXPECT_LT(std::filesystem::file_size(path), 100000u);
+
+    std::ifstream ifs(path, std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(ifs)), std::istreambuf_iterator<char>());
+    std::vector<Record> loaded;
+    ASSERT_TRUE(BinaryLedger::read(bytes.data(), bytes.size(), loaded));
+    EXPECT_EQ(loaded, records);
+    EXPECT_EQ(loaded[1000].getIdValue(), generated);
+    EXPECT_EQ(loaded[1002].getId(), "文本id");
+}
+
+TEST_F(StorageTest, FormatIsDetectedFromHeader) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "测试");
+    storage->setFormat(Storage::Format::Binary);
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    Storage reopened(testDir);
+    EXPECT_EQ(reopened.getFormat(), Storage::Format::Binary);
+    ASSERT_TRUE(reopened.appendRecord(Record("r2", "2025-01-02", 1.0, Record::Type::Expense, "餐饮", "日志")));
+    EXPECT_EQ(reopened.loadRecords().size(), 2);
+}
+
+TEST_F(StorageTest, TSVImportExportWithBinaryLedger) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "测试");
+    records.emplace_back("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "午餐");
+    storage->setFormat(Storage::Format::Binary);
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    auto exportPath = (std::filesystem::path(testDir) / "export.tsv").string();
+    ASSERT_TRUE(storage->exportRecordsTSV(exportPath, storage->loadRecords()));
+    auto imported = storage->importRecordsTSV(exportPath);
+    ASSERT_EQ(imported.size(), 2);
+    EXPECT_EQ(imported[1].getNote(), "午餐");
+}
+
+// 测试零拷贝 TSV 解析
+TEST_F(StorageTest, LoadRecordsHandlesCRLFAndBadLines) {
+    {
+        std::ofstream ofs(std::filesystem::path(testDir) / "records.txt", std::ios::binary);
+        ofs << "r1\t2025-01-01\t+12.5\tI\t工资\t备注\r\n"
+            << "坏行\t缺少字段\n"
+            << "\n"
+            << "r2\t2025-01-02\tabc\tE\t餐饮\t\t多余字段";
+    }
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 2);
+    EXPECT_DOUBLE_EQ(loaded[0].getAmount(), 12.5);
+    EXPECT_EQ(loaded[0].getNote(), "备注");
+    EXPECT_DOUBLE_EQ(loaded[1].getAmount(), 0.0);
+    EXPECT_EQ(loaded[1].getCategory(), "餐饮");
+    EXPECT_TRUE(loaded[1].getNote().empty());
+}
+
+// 测试按月分片布局
+TEST_F(StorageTest, MonthShardedSaveAndLoad) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "一月");
+    records.emplace_back("r2", "2025-01-15", 20.0, Record::Type::Expense, "餐饮", "一月");
+    records.emplace_back("r3", "2025-03-02", 30.0, Record::Type::Expense, "交通", "三月");
+    records.emplace_back("r4", "某天", 5.0, Record::Type::Expense, "其他", "无日期");
+
+    storage->setLayout(Storage::Layout::MonthSharded);
+    ASSERT_TRUE(storage->saveRecords(records));
+    EXPECT_TRUE(std::filesystem::exists(std::filesystem::path(testDir) / "records" / "2025-01.tsv"));
+
+    auto segments = storage->listSegments();
+    ASSERT_EQ(segments.size(), 3);
+    EXPECT_EQ(segments[0], "2025-01");
+    EXPECT_EQ(segments[1], "2025-03");
+    EXPECT_EQ(segments[2], "undated");
+    EXPECT_EQ(storage->loadSegment("2025-01").size(), 2);
+    EXPECT_EQ(storage->loadSegment("2025-02").size(), 0);
+
+    Storage reopened(testDir);
+    EXPECT_EQ(reopened.getLayout(), Storage::Layout::MonthSharded);
+    EXPECT_EQ(reopened.loadRecords().size(), 4);
+}
+
+TEST_F(StorageTest, MonthShardedSaveRemovesStaleSegments) {
+    storage->setLayout(Storage::Layout::MonthSharded);
+    ASSERT_TRUE(storage->saveRecords({Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "")}));
+    ASSERT_TRUE(storage->saveRecords({Record("r2", "2025-02-01", 1.0, Record::Type::Expense, "餐饮", "")}));
+    auto segments = storage->listSegments();
+    ASSERT_EQ(segments.size(), 1);
+    EXPECT_EQ(segments[0], "2025-02");
+}
+
+// 测试流式扫描接口
+TEST_F(StorageTest, ScanRecordsStreamsBaseAndJournal) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "一月");
+    records.emplace_back("r2", "2025-01-02", 20.0, Record::Type::Expense, "餐饮", "午餐");
+    ASSERT_TRUE(storage->saveRecords(records));
+    ASSERT_TRUE(storage->appendRecord(Record("r3", "2025-01-03", 30.0, Record::Type::Expense, "餐饮", "晚餐")));
+
+    std::vector<std::string> ids;
+    storage->scanRecords([&ids](const Record &r) {
+        ids.push_back(r.getId());
+        return true;
+    });
+    ASSERT_EQ(ids.size(), 3);
+    EXPECT_EQ(ids[2], "r3");
+
+    // 访问者返回 false 时提前结束
+    std::size_t visited = 0;
+    storage->scanRecords([&visited](const Record &) { return ++visited < 2; });
+    EXPECT_EQ(visited, 2);
+}
+
+TEST_F(StorageTest, ScanRecordsDoesNotInternNotes) {
+    {
+        std::ofstream ofs(std::filesystem::path(testDir) / "records.txt", std::ios::binary);
+        for (int i = 0; i < 100; ++i) {
+            ofs << "REC" << (i + 1) << "\t2025-01-01\t1.5\tE\t餐饮\t只扫描一次的备注-" << i << "\n";
+        }
+    }
+    // 分类先入池，之后扫描和加载都不应再让字符串池增长
+    StringPool::categories().intern("餐饮");
+    const auto categories = StringPool::categories().size();
+    const auto notes = StringPool::text().size();
+
+    std::size_t matched = 0;
+    storage->scanRecords([&matched](const Record &r) {
+        if (r.getNote() == "只扫描一次的备注-" + std::to_string(r.getIdValue() - 1)) {
+            ++matched;
+        }
+        return true;
+    });
+    EXPECT_EQ(matched, 100);
+    // 备注由记录自己持有，带出访问回调后仍然有效
+    Record escaped;
+    storage->scanRecords([&escaped](const Record &r) {
+        escaped = r;
+        return false;
+    });
+    EXPECT_EQ(escaped.getNote(), "只扫描一次的备注-0");
+    EXPECT_EQ(StringPool::categories().size(), categories);
+    EXPECT_EQ(StringPool::text().size(), notes);
+
+    auto loaded = storage->loadRecords();
+    ASSERT_EQ(loaded.size(), 100);
+    EXPECT_EQ(loaded[7].getNote(), "只扫描一次的备注-7");
+    EXPECT_EQ(StringPool::text().size(), notes);
+}
+
+TEST_F(StorageTest, ScanRecordsKeepsTextIdsAndBadDatesInScratch) {
+    {
+        std::ofstream ofs(std::filesystem::path(testDir) / "records.txt", std::ios::binary);
+        for (int i = 0; i < 100; ++i) {
+            ofs << "扫描文本id-" << i << "\t坏日期-" << i << "\t1.5\tE\t餐饮\t备注\n";
+        }
+    }
+    StringPool::categories().intern("餐饮");
+    const auto texts = StringPool::text().size();
+
+    std::size_t matched = 0;
+    storage->scanRecords([&matched](const Record &r) {
+        const auto suffix = r.getId().substr(std::string("扫描文本id-").size());
+        if (r.getDate() == "坏日期-" + suffix) {
+            ++matched;
+        }
+        return true;
+    });
+    EXPECT_EQ(matched, 100);
+    EXPECT_EQ(StringPool::text().size(), texts);
+
+    // 带出访问回调的记录不能再读取暂存区里的 id 和日期
+    Record escaped;
+    storage->scanRecords([&escaped](const Record &r) {
+        escaped = r;
+        return false;
+    });
+    EXPECT_EQ(escaped.getNote(), "备注");
+    EXPECT_THROW(escaped.getId(), std::logic_error);
+    EXPECT_THROW(escaped.getDate(), std::logic_error);
+}
+
+TEST_F(StorageTest, ScratchIdsExpireOnReset) {
+    StringPool::Scratch scratch(StringPool::text());
+    const auto stale = StringPool::text().lookup("只在这一代有效");
+    ASSERT_NE(stale & StringPool::kScratchBit, 0u);
+    EXPECT_EQ(StringPool::text().get(stale), "只在这一代有效");
+
+    // 重置后同一下标存放的是另一条字符串，旧 id 必须报错而不是读到它
+    scratch.reset();
+    const auto fresh = StringPool::text().lookup("下一代的字符串");
+    EXPECT_NE(fresh, stale);
+    EXPECT_EQ(StringPool::text().get(fresh), "下一代的字符串");
+    EXPECT_THROW(StringPool::text().get(stale), std::logic_error);
+    // 暂存区只属于它的字符串池
+    EXPECT_THROW(StringPool::categories().get(fresh), std::logic_error);
+}
+
+TEST_F(StorageTest, ScanRecordsOverBinaryShards) {
+    std::vector<Record> records;
+    records.emplace_back("r1", "2025-01-01", 100.0, Record::Type::Income, "工资", "一月");
+    records.emplace_back("r2", "2025-02-02", 20.0, Record::Type::Expense, "餐饮", "二月");
+    storage->setLayout(Storage::Layout::MonthSharded);
+    storage->setFormat(Storage::Format::Binary);
+    ASSERT_TRUE(storage->saveRecords(records));
+
+    double total = 0.0;
+    storage->scanRecords([&total](const Record &r) {
+        total += r.getAmount();
+        return true;
+    });
+    EXPECT_DOUBLE_EQ(total, 120.0);
+}
+
+// 测试后台写线程
+TEST_F(StorageTest, StorageWriterCoalescesAppends) {
+    {
+        StorageWriter writer(testDir);
+        for (int i = 0; i < 100; ++i) {
+            writer.append(Record("r" + std::to_string(i), "2025-01-01", 1.0, Record::Type::Expense, "餐饮", ""));
+        }
+        EXPECT_TRUE(writer.flush());
+        EXPECT_EQ(writer.storage().loadRecords().size(), 100);
+    }
+    EXPECT_EQ(storage->loadRecords().size(), 100);
+}
+
+TEST_F(StorageTest, StorageWriterSnapshotSupersedesAppends) {
+    StorageWriter writer(testDir);
+    Record r1("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", "");
+    Record r2("r2", "2025-01-02", 2.0, Record::Type::Expense, "餐饮", "");
+    writer.append(r1);
+    writer.append(r2);
+    writer.saveAll({r1, r2});
+    ASSERT_TRUE(writer.flush());
+    EXPECT_EQ(storage->journalSize(), 0u);
+    EXPECT_EQ(storage->loadRecords().size(), 2);
+}
+
+TEST_F(StorageTest, StorageWriterCompactsLargeJournal) {
+    StorageWriter writer(testDir);
+    writer.setCompactThreshold(1);
+    writer.append(Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", ""));
+    ASSERT_TRUE(writer.flush());
+    EXPECT_EQ(storage->journalSize(), 0u);
+    EXPECT_EQ(storage->loadRecords().size(), 1);
+}
+
+TEST_F(StorageTest, DestructorDrainsPendingWrites) {
+    {
+        StorageWriter writer(testDir);
+        writer.append(Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", ""));
+        writer.saveCategories({Category("c1", "自定义", true)});
+    }
+    EXPECT_EQ(storage->loadRecords().size(), 1);
+    EXPECT_EQ(storage->loadCategories().size(), 1);
+}
+
+TEST_F(StorageTest, EveryDurabilityPolicyPersistsOnFlush) {
+    const StorageWriter::Durability policies[] = {StorageWriter::Durability::EveryWrite,
+                                                  StorageWriter::Durability::GroupCommit,
+                                                  StorageWriter::Durability::OnExit};
+    for (auto policy : policies) {
+        std::filesystem::remove_all(testDir);
+        StorageWriter writer(testDir);
+        writer.setDurability(policy, std::chrono::milliseconds(50));
+        EXPECT_EQ(writer.getDurability(), policy);
+        for (int i = 0; i < 10; ++i) {
+            writer.append(Record("r" + std::to_string(i), "2025-01-01", 1.0, Record::Type::Expense, "餐饮", ""));
+        }
+        ASSERT_TRUE(writer.flush());
+        EXPECT_EQ(storage->loadRecords().size(), 10);
+    }
+}
+
+TEST_F(StorageTest, DrainWritesQueuedOpsWithoutFlush) {
+    const StorageWriter::Durability policies[] = {StorageWriter::Durability::GroupCommit,
+                                                  StorageWriter::Durability::OnExit};
+    for (auto policy : policies) {
+        std::filesystem::remove_all(testDir);
+        StorageWriter writer(testDir);
+        // 等待一小时的组提交也不应拖住读屏障
+        writer.setDurability(policy, std::chrono::hours(1));
+        writer.append(Record("r1", "2025-01-01", 1.0, Record::Type::Expense, "餐饮", ""));
+        writer.drain();
+        EXPECT_EQ(writer.storage().loadRecords().size(), 1);
+        ASSERT_TRUE(writer.flush());
+    }
+}